@@ -0,0 +1,340 @@
+// Compare the drivers of lsl3d/ (LSL3D, LSL3D_Parallel, LSL3D_Bands, LSL3D_Pipeline,
+// LSL3D_Stream, LSL3D_OutOfCore) across foreground densities.
+// Usage: lsl3d-bench-drivers [width] [height] [depth] [threads] [repetitions]
+// Prints the number of cycles per voxel of each driver, with Unify_SM_Separate and UFPC, RLE and
+// relabeling included. LSL3D_Stream computes the features of the components instead of a label
+// volume, LSL3D_OutOfCore reads and writes temporary files. A last line runs the 6-connectivity
+// unification on a checkerboard (one component per foreground voxel).
+// Every driver is checked against LSL3D::Run: same partition of the voxels in components (same
+// components and bounding boxes for LSL3D_Stream). The bench fails on the first mismatch.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <random>
+#include <vector>
+#include <array>
+#include <string>
+#include <algorithm>
+#include <type_traits>
+
+#include <lsl3dlib/timer.hpp>
+#include <lsl3dlib/compat.hpp>
+#include <lsl3dlib/parallel.hpp>
+#include <lsl3dlib/features.hpp>
+#include <lsl3dlib/rle/rle.hpp>
+#include <lsl3dlib/solvers/union_find.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_ccl.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_parallel.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_bands.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_pipeline.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_stream.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_out_of_core.hpp>
+#include <lsl3dlib/lsl3d/unification_merge.hpp>
+#include <lsl3dlib/lsl3d/lsl_features.hpp>
+#include <lsl3dlib/lsl3d/relabeling.hpp>
+
+
+// Size and bounding box of a component: S, lo_col, lo_row, lo_slice, hi_col, hi_row, hi_slice
+using Component = std::array<uint32_t, 7>;
+
+static void generate_volume(MAT3D_ui8& image, int width, int height, int depth, double density,
+			    int seed) {
+    create_mat_with_border<uint8_t>(image, width, height, depth,
+				    rle::RLE_IMG_MARGIN_BEFORE, 0, 0, rle::RLE_IMG_MARGIN_AFTER, 0, 0);
+
+    std::mt19937 mt(seed);
+    std::bernoulli_distribution gen(density);
+    for (int slice = 0; slice < depth; slice++) {
+	for (int row = 0; row < height; row++) {
+	    uint8_t* line = image.ptr<uint8_t>(slice, row);
+	    for (int col = 0; col < width; col++) {
+		line[col] = gen(mt);
+	    }
+	}
+    }
+}
+
+static void generate_checkerboard(MAT3D_ui8& image, int width, int height, int depth) {
+    create_mat_with_border<uint8_t>(image, width, height, depth,
+				    rle::RLE_IMG_MARGIN_BEFORE, 0, 0, rle::RLE_IMG_MARGIN_AFTER, 0, 0);
+
+    for (int slice = 0; slice < depth; slice++) {
+	for (int row = 0; row < height; row++) {
+	    uint8_t* line = image.ptr<uint8_t>(slice, row);
+	    for (int col = 0; col < width; col++) {
+		line[col] = (col + row + slice) & 1;
+	    }
+	}
+    }
+}
+
+static std::vector<int32_t> label_volume(const MAT3D_i32& labels, int width, int height,
+					 int depth) {
+    std::vector<int32_t> volume;
+    volume.reserve((size_t)width * height * depth);
+    for (int slice = 0; slice < depth; slice++) {
+	for (int row = 0; row < height; row++) {
+	    const int32_t* line = labels.ptr<int32_t>(slice, row);
+	    volume.insert(volume.end(), line, line + width);
+	}
+    }
+    return volume;
+}
+
+// a and b label the same components: one to one mapping of their labels, background on background
+static bool same_partition(const std::vector<int32_t>& a, const std::vector<int32_t>& b,
+			   uint32_t label_count) {
+    if (a.size() != b.size()) {
+	return false;
+    }
+    std::vector<int32_t> a_to_b(label_count, -1);
+    std::vector<int32_t> b_to_a(label_count, -1);
+    for (size_t i = 0; i < a.size(); i++) {
+	if (a[i] < 0 || b[i] < 0 || (uint32_t)a[i] >= label_count
+	    || (uint32_t)b[i] >= label_count) {
+	    return false;
+	}
+	if ((a[i] == 0) != (b[i] == 0)) {
+	    return false;
+	}
+	if (a_to_b[a[i]] < 0 && b_to_a[b[i]] < 0) {
+	    a_to_b[a[i]] = b[i];
+	    b_to_a[b[i]] = a[i];
+	}
+	if (a_to_b[a[i]] != b[i] || b_to_a[b[i]] != a[i]) {
+	    return false;
+	}
+    }
+    return true;
+}
+
+// Sorted components of a label volume
+static std::vector<Component> components(const std::vector<int32_t>& volume, uint32_t label_count,
+					 int width, int height) {
+    std::vector<Component> comps(label_count, Component{0, UINT32_MAX, UINT32_MAX, UINT32_MAX,
+							0, 0, 0});
+    size_t i = 0;
+    for (uint32_t slice = 0; i < volume.size(); slice++) {
+	for (uint32_t row = 0; row < (uint32_t)height; row++) {
+	    for (uint32_t col = 0; col < (uint32_t)width; col++, i++) {
+		Component& c = comps[volume[i]];
+		c[0]++;
+		c[1] = std::min(c[1], col);
+		c[2] = std::min(c[2], row);
+		c[3] = std::min(c[3], slice);
+		c[4] = std::max(c[4], col + 1);
+		c[5] = std::max(c[5], row + 1);
+		c[6] = std::max(c[6], slice + 1);
+	    }
+	}
+    }
+    comps.erase(comps.begin()); // Background
+    std::sort(comps.begin(), comps.end());
+    return comps;
+}
+
+// Best (lowest) number of cycles of run() over all repetitions, per voxel
+template <typename Run>
+static double best_of(int repetitions, size_t voxels, Run run) {
+    double best = 1e30;
+    for (int r = 0; r < repetitions; r++) {
+	double t0 = dcycles();
+	run();
+	double t1 = dcycles();
+	best = std::min(best, t1 - t0);
+    }
+    return best / (double)voxels;
+}
+
+template <typename Unify>
+struct Drivers {
+
+    using RLE = typename std::conditional<Unify::Conf::ER, rle::STDZ_ER, rle::STDZ>::type;
+    using FC = FeatureComputation_None;
+    using RL = algo::Relabeling_Z_Border;
+    using Solver = solver::UFPC;
+
+    using L = algo::LSL3D<RLE, Unify, FC, RL, Solver>;
+    using Parallel = algo::LSL3D_Parallel<RLE, Unify, FC, RL, Solver>;
+    using Bands = algo::LSL3D_Bands<RLE, Unify, FC, RL>;
+    using Pipeline = algo::LSL3D_Pipeline<RLE, Unify, FC, RL, Solver>;
+    using Stream = algo::LSL3D_Stream<RLE, Unify, Solver, ConfFeatures3DAll>;
+    using OutOfCore = algo::LSL3D_OutOfCore<RLE, Unify, Solver>;
+
+    const MAT3D_ui8& image;
+    int width, height, depth, threads, repetitions;
+
+    // Result of LSL3D::Run
+    std::vector<int32_t> reference;
+    uint32_t label_count = 0;
+
+    // Checked against the reference. Returns the cycles per voxel, < 0 on mismatch.
+    template <typename Driver, typename... Args>
+    double Label(Args... args);
+    double LabelStream();
+    double LabelOutOfCore();
+
+    size_t Voxels() const { return (size_t)width * height * depth; }
+};
+
+template <typename Unify>
+template <typename Driver, typename... Args>
+double Drivers<Unify>::Label(Args... args) {
+    typename Driver::CCL ccl;
+    ccl.image = image;
+    create_mat_with_border<int32_t>(ccl.labels, width, height, depth, 0, 0, 0, 4, 0, 0);
+    Driver::Alloc(ccl, width, height, depth, args...);
+
+    Features features;
+    uint32_t n = 0;
+    double cycles = best_of(repetitions, Voxels(), [&]() {
+	n = Driver::template Run<ConfFeatures3DNone>(ccl, features);
+    });
+    std::vector<int32_t> volume = label_volume(ccl.labels, width, height, depth);
+    Driver::Free(ccl);
+
+    if (std::is_same<Driver, L>::value) {
+	reference = volume;
+	label_count = n;
+	return cycles;
+    }
+    return n == label_count && same_partition(reference, volume, n) ? cycles : -1;
+}
+
+template <typename Unify>
+double Drivers<Unify>::LabelStream() {
+    typename Stream::CCL ccl;
+    Stream::Alloc(ccl, width, height);
+    const size_t pitch = image.ptr<uint8_t>(0, 1) - image.ptr<uint8_t>(0, 0);
+
+    // Slices relative to ccl.base
+    std::vector<Component> comps;
+    const auto emit = [&](const Features& f, int32_t label) {
+	const uint32_t base = (uint32_t)ccl.base;
+	comps.push_back(Component{f.S[label], f.lo_col[label], f.lo_row[label],
+				  base + f.lo_slice[label], f.hi_col[label], f.hi_row[label],
+				  base + f.hi_slice[label]});
+    };
+    double cycles = best_of(repetitions, Voxels(), [&]() {
+	comps.clear();
+	for (int slice = 0; slice < depth; slice++) {
+	    Stream::PushSlice(ccl, image.ptr<uint8_t>(slice, 0), pitch, emit);
+	}
+	Stream::Finish(ccl, emit);
+    });
+    Stream::Free(ccl);
+
+    std::sort(comps.begin(), comps.end());
+    return comps == components(reference, label_count, width, height) ? cycles : -1;
+}
+
+template <typename Unify>
+double Drivers<Unify>::LabelOutOfCore() {
+    std::FILE* input = std::tmpfile();
+    std::FILE* output = std::tmpfile();
+    if (input == nullptr || output == nullptr) {
+	return -1;
+    }
+    for (int slice = 0; slice < depth; slice++) {
+	for (int row = 0; row < height; row++) {
+	    std::fwrite(image.ptr<uint8_t>(slice, row), 1, width, input);
+	}
+    }
+
+    // Slabs of a quarter of the volume
+    typename OutOfCore::CCL ccl;
+    OutOfCore::Alloc(ccl, width, height, depth,
+		     OutOfCore::SliceBytes(width, height) * std::max(1, depth / 4));
+
+    uint32_t n = 0;
+    double cycles = best_of(repetitions, Voxels(), [&]() {
+	std::rewind(input);
+	std::rewind(output);
+	n = OutOfCore::Run(ccl, input, output);
+    });
+    OutOfCore::Free(ccl);
+
+    std::vector<int32_t> volume(Voxels());
+    std::rewind(output);
+    const bool read = std::fread(volume.data(), sizeof(int32_t), volume.size(), output)
+	== volume.size();
+    std::fclose(input);
+    std::fclose(output);
+    return read && n == label_count && same_partition(reference, volume, n) ? cycles : -1;
+}
+
+// Cycles per voxel of each driver, LSL3D first
+template <typename Unify>
+static std::vector<double> bench(const MAT3D_ui8& image, int width, int height, int depth,
+				 int threads, int repetitions) {
+    using D = Drivers<Unify>;
+    D drivers{image, width, height, depth, threads, repetitions};
+
+    std::vector<double> results;
+    results.push_back(drivers.template Label<typename D::L>());
+    results.push_back(drivers.template Label<typename D::Parallel>(threads));
+    results.push_back(drivers.template Label<typename D::Bands>(threads));
+    results.push_back(drivers.template Label<typename D::Pipeline>(std::max(1, threads - 1)));
+    results.push_back(drivers.LabelStream());
+    results.push_back(drivers.LabelOutOfCore());
+    return results;
+}
+
+// Returns the number of mismatches
+static int print(const std::string& name, const std::vector<double>& results) {
+    int errors = 0;
+    std::cout << std::setw(12) << name;
+    for (double r: results) {
+	if (r < 0) {
+	    std::cout << std::setw(12) << "MISMATCH";
+	    errors++;
+	} else {
+	    std::cout << std::setw(12) << std::fixed << std::setprecision(2) << r;
+	}
+    }
+    std::cout << std::endl;
+    return errors;
+}
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 256;
+    int height = argc > 2 ? std::atoi(argv[2]) : 256;
+    int depth = argc > 3 ? std::atoi(argv[3]) : 64;
+    int threads = argc > 4 ? std::atoi(argv[4]) : parallel::hardware_threads();
+    int repetitions = argc > 5 ? std::atoi(argv[5]) : 5;
+
+    const std::vector<std::string> names = {"LSL3D", "Parallel", "Bands", "Pipeline", "Stream",
+					    "OutOfCore"};
+
+    std::cout << "width = " << width << ", height = " << height << ", depth = " << depth
+	      << ", threads = " << threads << " (cycles/voxel)\n";
+    std::cout << std::setw(12) << "density";
+    for (const auto& name: names) {
+	std::cout << std::setw(12) << name;
+    }
+    std::cout << "\n";
+
+    int errors = 0;
+    for (int d = 1; d < 20; d++) {
+	double density = d / 20.0;
+	MAT3D_ui8 image;
+	generate_volume(image, width, height, depth, density, d);
+
+	std::ostringstream name;
+	name << std::fixed << std::setprecision(2) << density;
+	errors += print(name.str(), bench<unify::Unify_SM_Separate>(image, width, height, depth,
+								      threads, repetitions));
+    }
+
+    MAT3D_ui8 image;
+    generate_checkerboard(image, width, height, depth);
+    errors += print("checker(6)", bench<unify::Unify_SM_Separate_Conn<6>>(image, width, height,
+									     depth, threads,
+									     repetitions));
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
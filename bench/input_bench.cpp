@@ -0,0 +1,202 @@
+// Label volumes that are not stored as uint8_t (rle::pixel_t) across foreground densities:
+// bit-packed rows (rle::bit::) and uint16_t grayscale rows thresholded by the encoder
+// (rle::STDZ_Threshold / rle::STDZ_ER_Threshold).
+// Usage: lsl3d-bench-input [width] [height] [depth] [repetitions]
+// Each encoder is run through LSL3D::Run and its label volume is compared with the one of the
+// same unification on the uint8_t volume (rle::STDZ / rle::STDZ_ER): the program fails if they
+// differ. Prints the number of cycles per voxel of each Run; the "bin+" columns are the binarize
+// pass of the grayscale volume followed by the Run on the uint8_t volume.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <lsl3dlib/timer.hpp>
+#include <lsl3dlib/compat.hpp>
+#include <lsl3dlib/features.hpp>
+#include <lsl3dlib/rle/rle.hpp>
+#include <lsl3dlib/rle/rle-bit.hpp>
+#include <lsl3dlib/rle/rle-threshold.hpp>
+#include <lsl3dlib/solvers/union_find.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_ccl.hpp>
+#include <lsl3dlib/lsl3d/unification_merge.hpp>
+#include <lsl3dlib/lsl3d/unification_er.hpp>
+#include <lsl3dlib/lsl3d/lsl_features.hpp>
+#include <lsl3dlib/lsl3d/relabeling.hpp>
+
+
+// Grayscale foreground: pixel >= GRAY_LEVEL
+constexpr uint16_t GRAY_LEVEL = 2048;
+using GrayThreshold = rle::Threshold<uint16_t, rle::Level<uint16_t, GRAY_LEVEL>>;
+
+struct Volume {
+    MAT3D_ui8 image;             // uint8_t, with the margins of the SIMD encoders
+    std::vector<uint64_t> bits;  // 1 bit per voxel, (width + 63) / 64 words per row
+    MAT3D_ui8 bit_image;         // Byte header over bits (create_byte_view)
+    std::vector<uint16_t> gray;  // [0, GRAY_LEVEL) background, [GRAY_LEVEL, 2 * GRAY_LEVEL) fg
+    MAT3D_ui8 gray_image;        // Byte header over gray (create_byte_view)
+    MAT3D_ui8 binary;            // Output of binarize(), same layout as image
+    int width;
+    int height;
+    int depth;
+};
+
+static void generate_volume(Volume& vol, int width, int height, int depth, double density,
+			    int seed) {
+    vol.width = width;
+    vol.height = height;
+    vol.depth = depth;
+    create_mat_with_border<uint8_t>(vol.image, width, height, depth,
+				    rle::RLE_IMG_MARGIN_BEFORE, 0, 0, rle::RLE_IMG_MARGIN_AFTER, 0, 0);
+
+    const int words = (width + 63) / 64;
+    vol.bits.assign((size_t)depth * height * words, 0);
+    vol.gray.assign((size_t)depth * height * width, 0);
+
+    std::mt19937 mt(seed);
+    std::bernoulli_distribution gen(density);
+    std::uniform_int_distribution<uint16_t> level(0, GRAY_LEVEL - 1);
+    for (int slice = 0; slice < depth; slice++) {
+	for (int row = 0; row < height; row++) {
+	    uint8_t* line = vol.image.ptr<uint8_t>(slice, row);
+	    uint64_t* bit_line = vol.bits.data() + ((size_t)slice * height + row) * words;
+	    uint16_t* gray_line = vol.gray.data() + ((size_t)slice * height + row) * width;
+	    for (int col = 0; col < width; col++) {
+		line[col] = gen(mt);
+		bit_line[col / 64] |= (uint64_t)line[col] << (col % 64);
+		gray_line[col] = level(mt) + (line[col] ? GRAY_LEVEL : 0);
+	    }
+	}
+    }
+    vol.bit_image = create_byte_view(vol.bits.data(), words, height, depth, words,
+				     (size_t)height * words);
+    vol.gray_image = create_byte_view(vol.gray.data(), width, height, depth, width,
+				      (size_t)height * width);
+    create_mat_with_border<uint8_t>(vol.binary, width, height, depth,
+				    rle::RLE_IMG_MARGIN_BEFORE, 0, 0, rle::RLE_IMG_MARGIN_AFTER, 0, 0);
+}
+
+// Separate binarization of the grayscale volume, as done before an encoder on uint8_t rows
+static void binarize(Volume& vol) {
+    for (int slice = 0; slice < vol.depth; slice++) {
+	for (int row = 0; row < vol.height; row++) {
+	    const uint16_t* gray_line =
+		vol.gray.data() + ((size_t)slice * vol.height + row) * vol.width;
+	    uint8_t* line = vol.binary.ptr<uint8_t>(slice, row);
+	    for (int col = 0; col < vol.width; col++) {
+		line[col] = GrayThreshold::Test(gray_line[col]);
+	    }
+	}
+    }
+}
+
+// Best number of cycles per voxel of pre() followed by LSL3D::Run on `image`, the labels are
+// copied to `labels`
+template <typename RLE, typename Unify, typename Pre>
+static double run(const MAT3D_ui8& image, const Volume& vol, int repetitions,
+		  std::vector<int32_t>& labels, Pre pre) {
+    using L = algo::LSL3D<RLE, Unify, FeatureComputation_None, algo::Relabeling_Z_Border,
+			  solver::UFPC>;
+    typename L::CCL ccl;
+    ccl.image = image;
+    create_mat_with_border<int32_t>(ccl.labels, vol.width, vol.height, vol.depth, 0, 0, 0, 4, 0,
+				    0);
+    L::Alloc(ccl, vol.width, vol.height, vol.depth);
+
+    Features features;
+    double best = 1e30;
+    for (int r = 0; r < repetitions; r++) {
+	double t0 = dcycles();
+	pre();
+	L::template Run<ConfFeatures3DNone>(ccl, features);
+	best = std::min(best, dcycles() - t0);
+    }
+
+    labels.resize((size_t)vol.width * vol.height * vol.depth);
+    for (int slice = 0; slice < vol.depth; slice++) {
+	for (int row = 0; row < vol.height; row++) {
+	    const int32_t* line = ccl.labels.template ptr<int32_t>(slice, row);
+	    std::copy(line, line + vol.width,
+		      labels.data() + ((size_t)slice * vol.height + row) * vol.width);
+	}
+    }
+    L::Free(ccl);
+    return best / ((double)vol.width * vol.height * vol.depth);
+}
+
+template <typename RLE, typename Unify>
+static double run(const MAT3D_ui8& image, const Volume& vol, int repetitions,
+		  std::vector<int32_t>& labels) {
+    return run<RLE, Unify>(image, vol, repetitions, labels, [] {});
+}
+
+// Run of RLE on `image` checked against RefRLE on the uint8_t volume, same unification
+template <typename RLE, typename RefRLE, typename Unify>
+static double check(const MAT3D_ui8& image, const Volume& vol, int repetitions, bool& ok) {
+    std::vector<int32_t> expected, labels;
+    run<RefRLE, Unify>(vol.image, vol, 1, expected);
+    double cycles = run<RLE, Unify>(image, vol, repetitions, labels);
+    ok = ok && labels == expected;
+    return cycles;
+}
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 512;
+    int height = argc > 2 ? std::atoi(argv[2]) : 512;
+    int depth = argc > 3 ? std::atoi(argv[3]) : 64;
+    int repetitions = argc > 4 ? std::atoi(argv[4]) : 10;
+
+    const std::vector<std::string> names = {"STDZ", "bit::STDZ", "bin+STDZ", "STDZ_Threshold",
+					    "STDZ_ER", "bit::STDZ_ER", "bin+STDZ_ER",
+					    "STDZ_ER_Thresh"};
+
+    std::cout << "width = " << width << ", height = " << height << ", depth = " << depth
+	      << " (cycles/voxel)\n";
+    std::cout << std::setw(8) << "density";
+    for (const auto& name: names) {
+	std::cout << std::setw(16) << name;
+    }
+    std::cout << "\n";
+
+    bool ok = true;
+    for (int d = 1; d < 20; d++) {
+	double density = d / 20.0;
+	Volume vol;
+	generate_volume(vol, width, height, depth, density, d);
+
+	std::vector<int32_t> unused;
+	std::vector<double> results;
+	results.push_back(run<rle::STDZ, unify::Unify_SM_Separate>(vol.image, vol, repetitions,
+								   unused));
+	results.push_back(check<rle::bit::STDZ, rle::STDZ, unify::Unify_SM_Separate>(
+			      vol.bit_image, vol, repetitions, ok));
+	results.push_back(run<rle::STDZ, unify::Unify_SM_Separate>(
+			      vol.binary, vol, repetitions, unused, [&] { binarize(vol); }));
+	results.push_back(check<rle::STDZ_Threshold<GrayThreshold>, rle::STDZ,
+			  unify::Unify_SM_Separate>(vol.gray_image, vol, repetitions, ok));
+	results.push_back(run<rle::STDZ_ER, unify::Unify_ER>(vol.image, vol, repetitions, unused));
+	results.push_back(check<rle::bit::STDZ_ER, rle::STDZ_ER, unify::Unify_ER>(
+			      vol.bit_image, vol, repetitions, ok));
+	results.push_back(run<rle::STDZ_ER, unify::Unify_ER>(
+			      vol.binary, vol, repetitions, unused, [&] { binarize(vol); }));
+	results.push_back(check<rle::STDZ_ER_Threshold<GrayThreshold>, rle::STDZ_ER,
+			  unify::Unify_ER>(vol.gray_image, vol, repetitions, ok));
+
+	std::cout << std::setw(8) << std::fixed << std::setprecision(2) << density;
+	for (double r: results) {
+	    std::cout << std::setw(16) << std::setprecision(2) << r;
+	}
+	std::cout << "\n";
+	if (!ok) {
+	    std::cerr << "Labels differ from the uint8_t volume (density " << density << ")\n";
+	    return EXIT_FAILURE;
+	}
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+// Compare RLE encoders across foreground densities.
+// Usage: lsl3d-bench-rle [width] [height] [repetitions]
+// Prints the number of cycles per pixel for each encoder.
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <lsl3dlib/timer.hpp>
+#include <lsl3dlib/rle/rle.hpp>
+#include <lsl3dlib/rle/rle-sse.hpp>
+#include <lsl3dlib/rle/rle-avx2.hpp>
+#include <lsl3dlib/rle/rle-avx512.hpp>
+#include <lsl3dlib/rle/rle-bit.hpp>
+
+#if LSL_SIMD_DISPATCH
+#include <lsl3dlib/rle/rle-dispatch.hpp>
+#endif // LSL_SIMD_DISPATCH
+
+
+struct Image {
+    std::vector<uint8_t> data;
+    int width;
+    int height;
+    int stride;
+
+    // Same image, 1 bit per pixel (see rle::bit)
+    std::vector<uint64_t> bits;
+    int words;
+
+    uint8_t* Row(int row) {
+	return data.data() + row * stride + rle::RLE_IMG_MARGIN_BEFORE;
+    }
+
+    uint64_t* BitRow(int row) {
+	return bits.data() + row * words;
+    }
+};
+
+static Image generate_image(int width, int height, double density, int seed) {
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.stride = (width + rle::RLE_IMG_EXTRA_SPACE + 63) & ~63;
+    image.data.assign(image.stride * height + 64, 0);
+
+    std::mt19937 mt(seed);
+    std::bernoulli_distribution gen(density);
+    for (int row = 0; row < height; row++) {
+	uint8_t* line = image.Row(row);
+	for (int col = 0; col < width; col++) {
+	    line[col] = gen(mt);
+	}
+    }
+
+    image.words = (width + 63) / 64;
+    image.bits.assign(image.words * height, 0);
+    for (int row = 0; row < height; row++) {
+	const uint8_t* line = image.Row(row);
+	uint64_t* bitline = image.BitRow(row);
+	for (int col = 0; col < width; col++) {
+	    bitline[col / 64] |= (uint64_t)line[col] << (col % 64);
+	}
+    }
+    return image;
+}
+
+template <typename RLE, bool IsBitonal = RLE::Conf::IsBitonal>
+struct Input {
+    static const uint8_t* Row(Image& image, int row) { return image.Row(row); }
+};
+
+template <typename RLE>
+struct Input<RLE, true> {
+    static const uint64_t* Row(Image& image, int row) { return image.BitRow(row); }
+};
+
+// Returns the best (lowest) number of cycles per pixel over all repetitions
+template <typename RLE>
+static double bench(Image& image, int repetitions) {
+    const int width = image.width;
+    std::vector<int16_t> RLC(width + 64);
+    std::vector<int16_t> ER(width + 64);
+
+    double best = 1e30;
+    volatile int64_t sink = 0;
+    for (int r = 0; r < repetitions; r++) {
+	int64_t total = 0;
+	double t0 = dcycles();
+	for (int row = 0; row < image.height; row++) {
+	    total += RLE::template Line<1>(Input<RLE>::Row(image, row), RLC.data(), ER.data() + 1, width);
+	}
+	double t1 = dcycles();
+	sink = sink + total;
+	best = std::min(best, (t1 - t0) / ((double)width * image.height));
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 2048;
+    int height = argc > 2 ? std::atoi(argv[2]) : 1024;
+    int repetitions = argc > 3 ? std::atoi(argv[3]) : 20;
+
+    std::vector<std::string> names;
+    names.push_back("STDZ");
+    names.push_back("STDZ_ER");
+    names.push_back("bit::STDZ");
+    names.push_back("bit::STDZ_ER");
+#ifdef __SSE4_2__
+    names.push_back("sse::STDZ_V3");
+    names.push_back("sse::STDZ_ER");
+#endif // __SSE4_2__
+#ifdef __AVX2__
+    names.push_back("avx2::STDZ");
+    names.push_back("avx2::STDZ_ER");
+#endif // __AVX2__
+#if defined(__AVX512BW__) && defined(__AVX512VBMI2__)
+    names.push_back("avx512::STDZ");
+    names.push_back("avx512::STDZ_ER");
+#endif // __AVX512BW__ && __AVX512VBMI2__
+#if LSL_SIMD_DISPATCH
+    names.push_back("dispatch::STDZ");
+    names.push_back("dispatch::STDZ_ER");
+    std::cout << "dispatch: " << cpu::name(dispatch::kernels.level) << "\n";
+#endif // LSL_SIMD_DISPATCH
+
+    std::cout << "width = " << width << ", height = " << height << " (cycles/pixel)\n";
+    std::cout << std::setw(8) << "density";
+    for (const auto& name: names) {
+	std::cout << std::setw(18) << name;
+    }
+    std::cout << "\n";
+
+    for (int d = 0; d <= 20; d++) {
+	double density = d / 20.0;
+	Image image = generate_image(width, height, density, d);
+
+	std::vector<double> results;
+	results.push_back(bench<rle::STDZ>(image, repetitions));
+	results.push_back(bench<rle::STDZ_ER>(image, repetitions));
+	results.push_back(bench<rle::bit::STDZ>(image, repetitions));
+	results.push_back(bench<rle::bit::STDZ_ER>(image, repetitions));
+#ifdef __SSE4_2__
+	results.push_back(bench<rle::sse::STDZ_V3>(image, repetitions));
+	results.push_back(bench<rle::sse::STDZ_ER>(image, repetitions));
+#endif // __SSE4_2__
+#ifdef __AVX2__
+	results.push_back(bench<rle::avx2::STDZ>(image, repetitions));
+	results.push_back(bench<rle::avx2::STDZ_ER>(image, repetitions));
+#endif // __AVX2__
+#if defined(__AVX512BW__) && defined(__AVX512VBMI2__)
+	results.push_back(bench<rle::avx512::STDZ>(image, repetitions));
+	results.push_back(bench<rle::avx512::STDZ_ER>(image, repetitions));
+#endif // __AVX512BW__ && __AVX512VBMI2__
+#if LSL_SIMD_DISPATCH
+	results.push_back(bench<rle::dispatch::STDZ>(image, repetitions));
+	results.push_back(bench<rle::dispatch::STDZ_ER>(image, repetitions));
+#endif // LSL_SIMD_DISPATCH
+
+	std::cout << std::setw(8) << std::fixed << std::setprecision(2) << density;
+	for (double r: results) {
+	    std::cout << std::setw(18) << std::setprecision(3) << r;
+	}
+	std::cout << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,165 @@
+// Transitions of the merge state machine (unification_merge_first) and cost of the merge of two
+// rows, state machine vs predicated (lsl3d/unification_predicated.hpp), across foreground
+// densities.
+// Usage: lsl3d-bench-states [width] [rows] [repetitions]
+// For each density, `rows` pairs of random rows are merged. Printed:
+// - runs: runs per pixel of a row
+// - erb0: MAIN -> NEXT_ERB0 / MAIN, the run of the neighbour row is before the segment
+// - merge: MAIN -> MERGE / MAIN, the segment touches a run
+// - union: NEXT_ERB1 -> UNION / NEXT_ERB1, the segment touches the next run too
+// The closer to 0.5, the more mispredicted the branch. Then the number of overlaps found by both
+// merges (they must be equal) and their cycles per run of the row.
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <algorithm>
+
+#include <lsl3dlib/timer.hpp>
+#include <lsl3dlib/features.hpp>
+#include <lsl3dlib/rle/rle.hpp>
+#include <lsl3dlib/solvers/union_find.hpp>
+#include <lsl3dlib/lsl3d/unification_stats.hpp>
+#include <lsl3dlib/lsl3d/unification_merge.hpp>
+#include <lsl3dlib/lsl3d/unification_predicated.hpp>
+
+using namespace unify;
+
+struct Rows {
+    std::vector<int16_t> rlc;   // rows * pitch
+    std::vector<int16_t> len;
+    std::vector<int32_t> era;   // labels of the runs, rows * pitch / 2
+    size_t pitch;
+};
+
+static void generate_rows(Rows& rows, int width, int count, double density, int seed) {
+    std::mt19937 mt(seed);
+    std::bernoulli_distribution gen(density);
+    std::vector<uint8_t> line(width + rle::RLE_IMG_EXTRA_SPACE, 0);
+
+    rows.pitch = width + 2 + 2 * rle::RLE_IMG_MARGIN_AFTER;
+    rows.rlc.assign(count * rows.pitch, 0);
+    rows.len.assign(count, 0);
+    rows.era.assign(count * rows.pitch / 2, 0);
+
+    int32_t label = 1;
+    for (int r = 0; r < count; r++) {
+	uint8_t* pixels = line.data() + rle::RLE_IMG_MARGIN_BEFORE;
+	for (int x = 0; x < width; x++) {
+	    pixels[x] = gen(mt);
+	}
+	rows.len[r] = rle::rle_stdz<int16_t>(pixels, rows.rlc.data() + r * rows.pitch, width);
+	for (int i = 0; i < rows.len[r] / 2; i++) {
+	    rows.era[r * rows.pitch / 2 + i] = label++;
+	}
+    }
+}
+
+static void reset_labels(solver::UFPC& ET, int32_t labels) {
+    ET.Setup();
+    for (int32_t l = 1; l < labels; l++) {
+	ET.NewLabel();
+    }
+}
+
+static void reset_counters(StateCounters& counters) {
+    std::fill(counters.counters, counters.counters + LSL_STATE_COUNT * LSL_STATE_COUNT, 0);
+}
+
+// Merge of row 2k + 1 with row 2k, returns the number of cycles
+template <bool Predicated, bool Count>
+static double merge_rows(Rows& rows, std::vector<int32_t>& era_a, solver::UFPC& ET,
+			 StateCounters& counters) {
+    Features features;
+    const size_t pitch = rows.pitch;
+    double t0 = dcycles();
+    for (size_t r = 0; r + 1 < rows.len.size(); r += 2) {
+	const int16_t* rlc_b = rows.rlc.data() + r * pitch;
+	const int16_t* rlc_a = rlc_b + pitch;
+	int32_t* era_b = rows.era.data() + r * pitch / 2;
+	if (Predicated) {
+	    unification_merge_predicated<solver::UFPC, ConfFeatures3DNone, true, true, Count>(
+		rlc_a, rows.len[r + 1], rlc_b, era_a.data(), era_b, ET, features, 0, 0, counters);
+	} else {
+	    unification_merge_first<solver::UFPC, ConfFeatures3DNone, true, Count>(
+		rlc_a, rows.len[r + 1], rlc_b, rows.len[r], era_a.data(), era_b, ET, features, 0, 0,
+		counters);
+	}
+    }
+    return dcycles() - t0;
+}
+
+static double ratio(long num, long den) {
+    return den > 0 ? (double)num / den : 0.0;
+}
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 2048;
+    int count = argc > 2 ? std::atoi(argv[2]) : 2048;
+    int repetitions = argc > 3 ? std::atoi(argv[3]) : 10;
+
+    using S = UnificationState;
+
+    std::cout << "width = " << width << ", rows = " << count << "\n";
+    std::cout << std::setw(8) << "density" << std::setw(8) << "runs" << std::setw(8) << "erb0"
+	      << std::setw(8) << "merge" << std::setw(8) << "union" << std::setw(12) << "overlaps"
+	      << std::setw(12) << "(pred)" << std::setw(10) << "SM" << std::setw(12) << "Predicated"
+	      << "  (cycles/run)\n";
+
+    for (int d = 1; d < 20; d++) {
+	double density = d / 20.0;
+	Rows rows;
+	generate_rows(rows, width, count, density, d);
+
+	int32_t labels = 1;
+	long runs = 0;
+	for (int16_t len : rows.len) {
+	    labels += len / 2;
+	}
+	for (size_t r = 1; r < rows.len.size(); r += 2) {
+	    runs += rows.len[r] / 2;
+	}
+
+	std::vector<int32_t> era_a(rows.pitch / 2);
+	solver::UFPC ET;
+	ET.Alloc(labels);
+
+	StateCounters sm, pred;
+	reset_counters(sm);
+	reset_counters(pred);
+	reset_labels(ET, labels);
+	merge_rows<false, true>(rows, era_a, ET, sm);
+	reset_labels(ET, labels);
+	merge_rows<true, true>(rows, era_a, ET, pred);
+
+	double best_sm = 1e30, best_pred = 1e30;
+	for (int k = 0; k < repetitions; k++) {
+	    reset_labels(ET, labels);
+	    best_sm = std::min(best_sm, merge_rows<false, false>(rows, era_a, ET, sm));
+	    reset_labels(ET, labels);
+	    best_pred = std::min(best_pred, merge_rows<true, false>(rows, era_a, ET, pred));
+	}
+	ET.Dealloc();
+
+	const long main_out = sm.GetCounter(S::MAIN, S::NEXT_ERB0) +
+	    sm.GetCounter(S::MAIN, S::MERGE) + sm.GetCounter(S::MAIN, S::TEMP_LABEL);
+	const long erb1_out = sm.GetCounter(S::NEXT_ERB1, S::NEXT_ERA) +
+	    sm.GetCounter(S::NEXT_ERB1, S::UNION);
+	const long overlaps_sm = sm.GetCounter(S::MAIN, S::MERGE) +
+	    sm.GetCounter(S::NEXT_ERB1, S::UNION);
+	const long overlaps_pred = pred.GetCounter(S::MAIN, S::MERGE) +
+	    pred.GetCounter(S::MAIN, S::UNION);
+
+	std::cout << std::fixed << std::setprecision(2) << std::setw(8) << density
+		  << std::setw(8) << (double)runs / ((double)width * (count / 2))
+		  << std::setw(8) << ratio(sm.GetCounter(S::MAIN, S::NEXT_ERB0), main_out)
+		  << std::setw(8) << ratio(sm.GetCounter(S::MAIN, S::MERGE), main_out)
+		  << std::setw(8) << ratio(sm.GetCounter(S::NEXT_ERB1, S::UNION), erb1_out)
+		  << std::setw(12) << overlaps_sm << std::setw(12) << overlaps_pred
+		  << std::setw(10) << best_sm / runs << std::setw(12) << best_pred / runs << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+// Compare the union-find LabelsSolvers (solvers/union_find.hpp) across foreground densities.
+// Usage: lsl3d-bench-uf [width] [height] [depth] [repetitions]
+// Prints the number of cycles per merge (UpdateTable call) of the unification (UnifySlice) for each
+// solver and each unification. The RLE (EncodeSlice), Flatten and relabeling are not timed.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <lsl3dlib/timer.hpp>
+#include <lsl3dlib/compat.hpp>
+#include <lsl3dlib/features.hpp>
+#include <lsl3dlib/rle/rle.hpp>
+#include <lsl3dlib/solvers/union_find.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_ccl.hpp>
+#include <lsl3dlib/lsl3d/unification_merge.hpp>
+#include <lsl3dlib/lsl3d/unification_er.hpp>
+#include <lsl3dlib/lsl3d/lsl_features.hpp>
+#include <lsl3dlib/lsl3d/relabeling.hpp>
+
+
+// Number of merges of a unification, solver independent
+struct CountingUF : solver::UF {
+    uint64_t merges = 0;
+
+    inline int32_t UpdateTable(int32_t e0, int32_t e1) {
+	merges++;
+	return solver::UF::UpdateTable(e0, e1);
+    }
+};
+
+static void generate_volume(MAT3D_ui8& image, int width, int height, int depth, double density,
+			    int seed) {
+    create_mat_with_border<uint8_t>(image, width, height, depth,
+				    rle::RLE_IMG_MARGIN_BEFORE, 0, 0, rle::RLE_IMG_MARGIN_AFTER, 0, 0);
+
+    std::mt19937 mt(seed);
+    std::bernoulli_distribution gen(density);
+    for (int slice = 0; slice < depth; slice++) {
+	for (int row = 0; row < height; row++) {
+	    uint8_t* line = image.ptr<uint8_t>(slice, row);
+	    for (int col = 0; col < width; col++) {
+		line[col] = gen(mt);
+	    }
+	}
+    }
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver>
+using LSL = algo::LSL3D<RLE, Unify, FeatureComputation_None, algo::Relabeling_Nothing,
+			LabelsSolver>;
+
+// Returns the best (lowest) number of cycles of the unification over all repetitions: the slices
+// are encoded (EncodeSlice) outside of the timed regions, which only cover UnifySlice
+template <typename RLE, typename Unify, typename LabelsSolver>
+static double bench(const MAT3D_ui8& image, int width, int height, int depth, int repetitions) {
+    using L = LSL<RLE, Unify, LabelsSolver>;
+    typename L::CCL ccl;
+    ccl.image = image;
+    create_mat_with_border<int32_t>(ccl.labels, width, height, depth, 0, 0, 0, 4, 0, 0);
+    L::Alloc(ccl, width, height, depth);
+
+    Features features;
+    double best = 1e30;
+    volatile uint32_t sink = 0;
+    for (int r = 0; r < repetitions; r++) {
+	ccl.ET.Setup();
+	ccl.occupancy.Reset(height, depth);
+	double cycles = 0;
+	for (int slice = 0; slice < depth; slice++) {
+	    L::EncodeSlice(ccl, slice);
+	    double t0 = dcycles();
+	    L::template UnifySlice<ConfFeatures3DNone>(ccl, ccl.ET, features, slice, 0);
+	    cycles += dcycles() - t0;
+	}
+	sink = sink + ccl.ET.Flatten();
+	best = std::min(best, cycles);
+    }
+    L::Free(ccl);
+    return best;
+}
+
+template <typename RLE, typename Unify>
+static uint64_t count_merges(const MAT3D_ui8& image, int width, int height, int depth) {
+    using L = LSL<RLE, Unify, CountingUF>;
+    typename L::CCL ccl;
+    ccl.image = image;
+    create_mat_with_border<int32_t>(ccl.labels, width, height, depth, 0, 0, 0, 4, 0, 0);
+    L::Alloc(ccl, width, height, depth);
+
+    Features features;
+    L::template Run<ConfFeatures3DNone>(ccl, features);
+    const uint64_t merges = ccl.ET.merges;
+    L::Free(ccl);
+    return merges;
+}
+
+template <typename RLE, typename Unify>
+static void bench_solvers(const MAT3D_ui8& image, int width, int height, int depth,
+			  int repetitions, std::vector<double>& results) {
+    const double merges =
+	std::max<uint64_t>(1, count_merges<RLE, Unify>(image, width, height, depth));
+    results.push_back(merges);
+    results.push_back(bench<RLE, Unify, solver::UF>(image, width, height, depth, repetitions)
+		      / merges);
+    results.push_back(bench<RLE, Unify, solver::UFPC>(image, width, height, depth, repetitions)
+		      / merges);
+    results.push_back(bench<RLE, Unify, solver::UFPH>(image, width, height, depth, repetitions)
+		      / merges);
+    results.push_back(bench<RLE, Unify, solver::RemSP>(image, width, height, depth, repetitions)
+		      / merges);
+    results.push_back(bench<RLE, Unify, solver::UFSize>(image, width, height, depth, repetitions)
+		      / merges);
+    results.push_back(bench<RLE, Unify, solver::UFSliceFlatten>(image, width, height, depth,
+								repetitions) / merges);
+}
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 512;
+    int height = argc > 2 ? std::atoi(argv[2]) : 512;
+    int depth = argc > 3 ? std::atoi(argv[3]) : 64;
+    int repetitions = argc > 4 ? std::atoi(argv[4]) : 10;
+
+    const std::vector<std::string> unifications = {"SM_Separate", "SM_Separate_V2",
+						   "SM_Combined_Z", "ER"};
+    const std::vector<std::string> names = {"merges", "UF", "UFPC", "UFPH", "RemSP", "UFSize",
+					    "UFSliceFlatten"};
+
+    std::cout << "width = " << width << ", height = " << height << ", depth = " << depth
+	      << " (cycles/merge)\n";
+    std::cout << std::setw(8) << "density";
+    for (const auto& unification: unifications) {
+	for (const auto& name: names) {
+	    std::cout << std::setw(18) << (name == "merges" ? unification + " merges" : name);
+	}
+    }
+    std::cout << "\n";
+
+    for (int d = 1; d < 20; d++) {
+	double density = d / 20.0;
+	MAT3D_ui8 image;
+	generate_volume(image, width, height, depth, density, d);
+
+	std::vector<double> results;
+	bench_solvers<rle::STDZ, unify::Unify_SM_Separate>(image, width, height, depth, repetitions,
+							    results);
+	bench_solvers<rle::STDZ, unify::Unify_SM_Separate_V2>(image, width, height, depth,
+							       repetitions, results);
+	bench_solvers<rle::STDZ, unify::Unify_SM_Combined_Z>(image, width, height, depth,
+							      repetitions, results);
+	bench_solvers<rle::STDZ_ER, unify::Unify_ER>(image, width, height, depth, repetitions,
+						      results);
+
+	std::cout << std::setw(8) << std::fixed << std::setprecision(2) << density;
+	for (double r: results) {
+	    std::cout << std::setw(18) << std::setprecision(r >= 1000 ? 0 : 2) << r;
+	}
+	std::cout << "\n";
+    }
+    return 0;
+}
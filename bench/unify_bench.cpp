@@ -0,0 +1,182 @@
+// Compare the merge unifications (lsl3d/unification_merge.hpp, unification_batch.hpp,
+// unification_predicated.hpp, unification_noera.hpp) and the ER ones (unification_er.hpp) across
+// foreground densities.
+// Usage: lsl3d-bench-unify [width] [height] [depth] [repetitions]
+// Prints the number of cycles per voxel of LSL3D::Run for each unification, with UFPC. RLE and
+// relabeling are not unification dependent: the differences between the columns are the costs of
+// the unifications (number of passes over the rows, labels created, FindRoot calls, cache misses
+// of the table for large volumes). The "+Z" columns also relabel the volume (Relabeling_Z_Border,
+// Relabeling_Z_NOERA for the ERA-less unification). The ER unifications use rle::STDZ_ER (ER) or
+// build their compact ER rows after rle::STDZ (ER_Compact).
+// A last line checks the 6-connectivity unifications on a checkerboard: every foreground voxel
+// is a component, the worst case of unify::max_labels.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <type_traits>
+
+#include <lsl3dlib/timer.hpp>
+#include <lsl3dlib/compat.hpp>
+#include <lsl3dlib/features.hpp>
+#include <lsl3dlib/rle/rle.hpp>
+#include <lsl3dlib/solvers/union_find.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_ccl.hpp>
+#include <lsl3dlib/lsl3d/unification_merge.hpp>
+#include <lsl3dlib/lsl3d/unification_batch.hpp>
+#include <lsl3dlib/lsl3d/unification_predicated.hpp>
+#include <lsl3dlib/lsl3d/unification_noera.hpp>
+#include <lsl3dlib/lsl3d/unification_er.hpp>
+#include <lsl3dlib/lsl3d/lsl_features.hpp>
+#include <lsl3dlib/lsl3d/relabeling.hpp>
+
+
+static void generate_volume(MAT3D_ui8& image, int width, int height, int depth, double density,
+			    int seed) {
+    create_mat_with_border<uint8_t>(image, width, height, depth,
+				    rle::RLE_IMG_MARGIN_BEFORE, 0, 0, rle::RLE_IMG_MARGIN_AFTER, 0, 0);
+
+    std::mt19937 mt(seed);
+    std::bernoulli_distribution gen(density);
+    for (int slice = 0; slice < depth; slice++) {
+	for (int row = 0; row < height; row++) {
+	    uint8_t* line = image.ptr<uint8_t>(slice, row);
+	    for (int col = 0; col < width; col++) {
+		line[col] = gen(mt);
+	    }
+	}
+    }
+}
+
+// Foreground voxels of a 3D checkerboard
+static size_t generate_checkerboard(MAT3D_ui8& image, int width, int height, int depth) {
+    create_mat_with_border<uint8_t>(image, width, height, depth,
+				    rle::RLE_IMG_MARGIN_BEFORE, 0, 0, rle::RLE_IMG_MARGIN_AFTER, 0, 0);
+
+    size_t count = 0;
+    for (int slice = 0; slice < depth; slice++) {
+	for (int row = 0; row < height; row++) {
+	    uint8_t* line = image.ptr<uint8_t>(slice, row);
+	    for (int col = 0; col < width; col++) {
+		line[col] = (col + row + slice) & 1;
+		count += line[col];
+	    }
+	}
+    }
+    return count;
+}
+
+// Returns the best (lowest) number of cycles per voxel of LSL3D::Run over all repetitions
+template <typename Unify, typename Relabeling = algo::Relabeling_Nothing>
+static double bench(const MAT3D_ui8& image, int width, int height, int depth, int repetitions,
+		    uint32_t* label_count = nullptr) {
+    using RLE = typename std::conditional<Unify::Conf::ER, rle::STDZ_ER, rle::STDZ>::type;
+    using L = algo::LSL3D<RLE, Unify, FeatureComputation_None, Relabeling, solver::UFPC>;
+    typename L::CCL ccl;
+    ccl.image = image;
+    create_mat_with_border<int32_t>(ccl.labels, width, height, depth, 0, 0, 0, 4, 0, 0);
+    L::Alloc(ccl, width, height, depth);
+
+    Features features;
+    double best = 1e30;
+    volatile uint32_t sink = 0;
+    uint32_t n = 0;
+    for (int r = 0; r < repetitions; r++) {
+	double t0 = dcycles();
+	n = L::template Run<ConfFeatures3DNone>(ccl, features);
+	double t1 = dcycles();
+	sink = sink + n;
+	best = std::min(best, t1 - t0);
+    }
+    if (label_count) {
+	*label_count = n;
+    }
+    L::Free(ccl);
+    return best / ((double)width * height * depth);
+}
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 512;
+    int height = argc > 2 ? std::atoi(argv[2]) : 512;
+    int depth = argc > 3 ? std::atoi(argv[3]) : 64;
+    int repetitions = argc > 4 ? std::atoi(argv[4]) : 10;
+
+    const std::vector<std::string> names = {"SM_Separate", "SM_Separate_V2", "SM_Generalized",
+					    "SM_Third", "SM_Combined_Z", "SM_Batched",
+					    "SM_Predicated", "SM_NoERA", "SM_Separate+Z",
+					    "SM_NoERA+Z", "ER", "ER_Compact"};
+
+    std::cout << "width = " << width << ", height = " << height << ", depth = " << depth
+	      << " (cycles/voxel)\n";
+    std::cout << std::setw(8) << "density";
+    for (const auto& name: names) {
+	std::cout << std::setw(16) << name;
+    }
+    std::cout << "\n";
+
+    for (int d = 1; d < 20; d++) {
+	double density = d / 20.0;
+	MAT3D_ui8 image;
+	generate_volume(image, width, height, depth, density, d);
+
+	std::vector<double> results;
+	results.push_back(bench<unify::Unify_SM_Separate>(image, width, height, depth, repetitions));
+	results.push_back(bench<unify::Unify_SM_Separate_V2>(image, width, height, depth, repetitions));
+	results.push_back(bench<unify::Unify_SM_Generalized>(image, width, height, depth, repetitions));
+	results.push_back(bench<unify::Unify_SM_Third>(image, width, height, depth, repetitions));
+	results.push_back(bench<unify::Unify_SM_Combined_Z>(image, width, height, depth, repetitions));
+	results.push_back(bench<unify::Unify_SM_Batched>(image, width, height, depth, repetitions));
+	results.push_back(bench<unify::Unify_SM_Predicated>(image, width, height, depth, repetitions));
+	results.push_back(bench<unify::Unify_SM_NoERA>(image, width, height, depth, repetitions));
+	// With the relabeling, which also reads ERA
+	results.push_back(bench<unify::Unify_SM_Separate, algo::Relabeling_Z_Border>(
+			      image, width, height, depth, repetitions));
+	results.push_back(bench<unify::Unify_SM_NoERA, algo::Relabeling_Z_NOERA>(
+			      image, width, height, depth, repetitions));
+	results.push_back(bench<unify::Unify_ER>(image, width, height, depth, repetitions));
+	results.push_back(bench<unify::Unify_ER_Compact>(image, width, height, depth, repetitions));
+
+	std::cout << std::setw(8) << std::fixed << std::setprecision(2) << density;
+	for (double r: results) {
+	    std::cout << std::setw(16) << std::setprecision(2) << r;
+	}
+	std::cout << "\n";
+    }
+
+    // 6-connectivity checkerboard: labels of the components + background
+    MAT3D_ui8 image;
+    const size_t count = generate_checkerboard(image, width, height, depth);
+    const std::vector<std::string> names6 = {"SM_Separate", "SM_Batched", "SM_Predicated",
+					     "SM_NoERA", "ER"};
+    std::vector<double> results;
+    std::vector<uint32_t> labels(names6.size());
+    results.push_back(bench<unify::Unify_SM_Separate_Conn<6>>(image, width, height, depth,
+							       repetitions, &labels[0]));
+    results.push_back(bench<unify::Unify_SM_Batched_Conn<6>>(image, width, height, depth,
+							      repetitions, &labels[1]));
+    results.push_back(bench<unify::Unify_SM_Predicated_Conn<6>>(image, width, height, depth,
+								 repetitions, &labels[2]));
+    results.push_back(bench<unify::Unify_SM_NoERA_Conn<6>>(image, width, height, depth,
+							    repetitions, &labels[3]));
+    results.push_back(bench<unify::Unify_ER_Conn<6>>(image, width, height, depth, repetitions,
+						      &labels[4]));
+
+    std::cout << "6-connectivity checkerboard, " << count << " components (cycles/voxel)\n";
+    int errors = 0;
+    for (size_t i = 0; i < names6.size(); i++) {
+	std::cout << std::setw(16) << names6[i] << std::setw(16) << std::setprecision(2)
+		  << results[i];
+	if (labels[i] != count + 1) {
+	    std::cout << "  wrong count: " << labels[i];
+	    errors++;
+	}
+	std::cout << "\n";
+    }
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,241 @@
+// Label rows wider than 32k pixels with int32_t RLC rows (rle::STDZ_Generic<int32_t>), against
+// the int16_t path.
+// Usage: lsl3d-bench-wide [width] [height] [depth] [repetitions]
+// The column width / 2 of the volume is background: the two halves have no component in common.
+// The whole volume is labeled with the int32_t encoders, and each half separately with the
+// int16_t ones (rle::STDZ, rle::STDZ_ER): the halves must be narrower than 32k pixels. The
+// int32_t labels of each half must be the same partition as the int16_t ones, with no label
+// shared by the halves. Prints the number of cycles per voxel of LSL3D::Run with UFPC and
+// Relabeling_Z_Border (int16_t: both halves) across foreground densities. The bench fails on the
+// first mismatch.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <random>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <lsl3dlib/timer.hpp>
+#include <lsl3dlib/compat.hpp>
+#include <lsl3dlib/features.hpp>
+#include <lsl3dlib/rle/rle.hpp>
+#include <lsl3dlib/solvers/union_find.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_ccl.hpp>
+#include <lsl3dlib/lsl3d/unification_merge.hpp>
+#include <lsl3dlib/lsl3d/unification_er.hpp>
+#include <lsl3dlib/lsl3d/lsl_features.hpp>
+#include <lsl3dlib/lsl3d/relabeling.hpp>
+
+
+template <typename RLE, typename Unify>
+using Labeling = algo::LSL3D<RLE, Unify, FeatureComputation_None, algo::Relabeling_Z_Border,
+			     solver::UFPC>;
+
+// Columns [col0, col1) of a volume
+struct Columns {
+    int col0, col1, height, depth;
+
+    size_t Voxels() const { return (size_t)(col1 - col0) * height * depth; }
+};
+
+// Random volume, the column `empty` is background
+static void generate_volume(MAT3D_ui8& image, int width, int height, int depth, double density,
+			    int seed, int empty) {
+    create_mat_with_border<uint8_t>(image, width, height, depth, rle::RLE_IMG_MARGIN_BEFORE, 0, 0,
+				    rle::RLE_IMG_MARGIN_AFTER, 0, 0);
+
+    std::mt19937 mt(seed);
+    std::bernoulli_distribution gen(density);
+    for (int slice = 0; slice < depth; slice++) {
+	for (int row = 0; row < height; row++) {
+	    uint8_t* line = image.ptr<uint8_t>(slice, row);
+	    for (int col = 0; col < width; col++) {
+		line[col] = gen(mt);
+	    }
+	    line[empty] = 0;
+	}
+    }
+}
+
+// Labels the columns of image with L. `volume` gets the labels of the columns in raster order,
+// returns the number of labels (background included).
+template <typename L>
+static uint32_t label(const MAT3D_ui8& image, const Columns& cols, int repetitions,
+		      double& cycles, std::vector<int32_t>& volume) {
+    const int width = cols.col1 - cols.col0;
+    const int height = cols.height;
+    const int depth = cols.depth;
+
+    typename L::CCL ccl;
+    create_mat_with_border<uint8_t>(ccl.image, width, height, depth, rle::RLE_IMG_MARGIN_BEFORE,
+				    0, 0, rle::RLE_IMG_MARGIN_AFTER, 0, 0);
+    create_mat_with_border<int32_t>(ccl.labels, width, height, depth, 0, 0, 0, 4, 0, 0);
+    for (int slice = 0; slice < depth; slice++) {
+	for (int row = 0; row < height; row++) {
+	    std::memcpy(ccl.image.template ptr<uint8_t>(slice, row),
+			image.ptr<uint8_t>(slice, row) + cols.col0, width);
+	}
+    }
+    L::Alloc(ccl, width, height, depth);
+
+    Features features;
+    uint32_t n = 0;
+    cycles = 1e30;
+    for (int r = 0; r < repetitions; r++) {
+	double t0 = dcycles();
+	n = L::template Run<ConfFeatures3DNone>(ccl, features);
+	double t1 = dcycles();
+	cycles = std::min(cycles, t1 - t0);
+    }
+
+    volume.clear();
+    volume.reserve(cols.Voxels());
+    for (int slice = 0; slice < depth; slice++) {
+	for (int row = 0; row < height; row++) {
+	    const int32_t* line = ccl.labels.template ptr<int32_t>(slice, row);
+	    volume.insert(volume.end(), line, line + width);
+	}
+    }
+    L::Free(ccl);
+    return n;
+}
+
+// Labels of the columns [col0, col1) of a volume of `width` columns
+static std::vector<int32_t> crop(const std::vector<int32_t>& volume, int width,
+				 const Columns& cols) {
+    std::vector<int32_t> cropped;
+    cropped.reserve(cols.Voxels());
+    for (size_t line = 0; line < (size_t)cols.height * cols.depth; line++) {
+	const int32_t* src = volume.data() + line * width;
+	cropped.insert(cropped.end(), src + cols.col0, src + cols.col1);
+    }
+    return cropped;
+}
+
+// a and b label the same components: one to one mapping of their labels, background on background
+static bool same_partition(const std::vector<int32_t>& a, const std::vector<int32_t>& b,
+			   uint32_t label_count) {
+    if (a.size() != b.size()) {
+	return false;
+    }
+    std::vector<int32_t> a_to_b(label_count, -1);
+    std::vector<int32_t> b_to_a(label_count, -1);
+    for (size_t i = 0; i < a.size(); i++) {
+	if (a[i] < 0 || b[i] < 0 || (uint32_t)a[i] >= label_count
+	    || (uint32_t)b[i] >= label_count) {
+	    return false;
+	}
+	if ((a[i] == 0) != (b[i] == 0)) {
+	    return false;
+	}
+	if (a_to_b[a[i]] < 0 && b_to_a[b[i]] < 0) {
+	    a_to_b[a[i]] = b[i];
+	    b_to_a[b[i]] = a[i];
+	}
+	if (a_to_b[a[i]] != b[i] || b_to_a[b[i]] != a[i]) {
+	    return false;
+	}
+    }
+    return true;
+}
+
+// Cycles per voxel of the int16_t path (RLE16, both halves) and of the int32_t one (RLE32, whole
+// volume). Returns false on mismatch.
+template <typename RLE16, typename RLE32, typename Unify>
+static bool bench(const MAT3D_ui8& image, int width, int height, int depth, int repetitions,
+		  double& cycles16, double& cycles32) {
+    const Columns whole{0, width, height, depth};
+    const Columns halves[2] = {{0, width / 2, height, depth},
+			       {width / 2 + 1, width, height, depth}};
+
+    std::vector<int32_t> volume;
+    const uint32_t n = label<Labeling<RLE32, Unify>>(image, whole, repetitions, cycles32,
+						       volume);
+    cycles32 /= (double)whole.Voxels();
+
+    // Labels of the halves: disjoint, n - 1 of them
+    bool same = true;
+    uint32_t half_labels = 0;
+    std::vector<bool> used(n, false);
+    cycles16 = 0;
+    for (const Columns& half: halves) {
+	double cycles;
+	std::vector<int32_t> half_volume;
+	const uint32_t half_n = label<Labeling<RLE16, Unify>>(image, half, repetitions, cycles,
+							      half_volume);
+	cycles16 += cycles;
+	half_labels += half_n - 1;
+
+	const std::vector<int32_t> cropped = crop(volume, width, half);
+	same = same && same_partition(cropped, half_volume, std::max(n, half_n));
+
+	// Labels of the previous half are not reused
+	std::vector<bool> seen(n, false);
+	for (int32_t l: cropped) {
+	    if (l > 0 && (uint32_t)l < n) {
+		same = same && !used[l];
+		seen[l] = true;
+	    }
+	}
+	for (uint32_t l = 0; l < n; l++) {
+	    used[l] = used[l] || seen[l];
+	}
+    }
+    cycles16 /= (double)(halves[0].Voxels() + halves[1].Voxels());
+    return same && half_labels == n - 1;
+}
+
+// Returns the number of mismatches
+static int print(const std::string& name, const std::vector<double>& results, bool ok) {
+    std::cout << std::setw(12) << name;
+    for (double r: results) {
+	std::cout << std::setw(12) << std::fixed << std::setprecision(2) << r;
+    }
+    if (!ok) {
+	std::cout << std::setw(12) << "MISMATCH";
+    }
+    std::cout << std::endl;
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 40000;
+    int height = argc > 2 ? std::atoi(argv[2]) : 32;
+    int depth = argc > 3 ? std::atoi(argv[3]) : 16;
+    int repetitions = argc > 4 ? std::atoi(argv[4]) : 5;
+
+    if (width / 2 >= rle::rle_sentinel<int16_t>()) {
+	std::cerr << "The halves must be narrower than " << rle::rle_sentinel<int16_t>()
+		  << " pixels\n";
+	return EXIT_FAILURE;
+    }
+
+    std::cout << "width = " << width << ", height = " << height << ", depth = " << depth
+	      << " (cycles/voxel)\n";
+    std::cout << std::setw(12) << "density" << std::setw(12) << "Separate16"
+	      << std::setw(12) << "Separate32" << std::setw(12) << "ER16" << std::setw(12)
+	      << "ER32" << "\n";
+
+    int errors = 0;
+    for (int d = 1; d < 10; d++) {
+	double density = d / 10.0;
+	MAT3D_ui8 image;
+	generate_volume(image, width, height, depth, density, d, width / 2);
+
+	std::vector<double> results(4);
+	bool ok = bench<rle::STDZ, rle::STDZ_Generic<int32_t>, unify::Unify_SM_Separate>(
+	    image, width, height, depth, repetitions, results[0], results[1]);
+	ok = bench<rle::STDZ_ER, rle::STDZ_ER_Generic<int32_t>, unify::Unify_ER>(
+	    image, width, height, depth, repetitions, results[2], results[3]) && ok;
+
+	std::ostringstream name;
+	name << std::fixed << std::setprecision(2) << density;
+	errors += print(name.str(), results, ok);
+    }
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
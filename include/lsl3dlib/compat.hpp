@@ -174,6 +174,35 @@ void create_mat_with_border(cv::Mat& mat, int width, int height, int depth,
     }
 }
 
+// 3D header over memory that is not owned (mmap, tensor of another framework...): no copy and no
+// margin. Strides are in elements.
+// Only the kernels that do not read/write after the rows may be used on it: scalar encoders,
+// *_Unpadded encoders, rle::dispatch, Relabeling_Pixel_Unpadded.
+template <typename T>
+cv::Mat create_mat_view(T* data, int width, int height, int depth,
+			size_t rowstride, size_t slicestride) {
+    int sizes[3] = {depth, height, width};
+    size_t steps[2] = {slicestride * sizeof(T), rowstride * sizeof(T)};
+
+    if constexpr (std::is_signed<T>::value) {
+	return cv::Mat(3, sizes, cv::DataType<T>::type, (void*)data, steps);
+    } else {
+	using U = typename std::make_signed<T>::type;
+	return cv::Mat(3, sizes, cv::DataType<U>::type, (void*)data, steps);
+    }
+}
+
+// Byte header (MAT3D_ui8) over rows of T elements, strides in elements: LSL3D_CCL_t::image for
+// the encoders reading other pixels than uint8_t (rle::pixel_t: bit-packed words, grayscale).
+// The header is CV_8U: it is not converted when assigned to a MAT3D_ui8.
+template <typename T>
+cv::Mat create_byte_view(T* data, int width, int height, int depth,
+			 size_t rowstride, size_t slicestride) {
+    int sizes[3] = {depth, height, (int)(width * sizeof(T))};
+    size_t steps[2] = {slicestride * sizeof(T), rowstride * sizeof(T)};
+    return cv::Mat(3, sizes, cv::DataType<uint8_t>::type, (void*)data, steps);
+}
+
 template <typename T>
 cv::Mat create_mat_from_data(const T arr[], int width, int height) {
     cv::Mat mat;
@@ -0,0 +1,28 @@
+#ifndef CCL_CPU_HPP
+#define CCL_CPU_HPP
+
+#include <cstdint>
+
+namespace cpu {
+
+// SIMD instruction sets for which kernels can be selected at runtime.
+// Levels are ordered: a CPU supporting a level supports all the previous ones.
+enum class SIMDLevel : uint8_t {
+    Scalar = 0,
+    SSE4_2 = 1,
+    AVX2 = 2,
+    AVX512 = 3, // AVX512F + BW + VL + VBMI2
+};
+
+// Highest level supported by both the CPU and the OS (queried with CPUID).
+SIMDLevel detect();
+
+// Level used by the dispatched kernels: detect(), capped by the LSL3D_SIMD environment variable
+// (scalar, sse4.2, avx2 or avx512) when set. Computed once.
+SIMDLevel level();
+
+const char* name(SIMDLevel level);
+
+}
+
+#endif // CCL_CPU_HPP
@@ -0,0 +1,58 @@
+#ifndef CCL_DISPATCH_HPP
+#define CCL_DISPATCH_HPP
+
+#include <cstdint>
+
+#include <simdhelpers/restrict.hpp>
+
+#include <lsl3dlib/cpu.hpp>
+
+// Kernels selected at runtime depending on the SIMD level of the CPU (see cpu::level()).
+// The table is resolved once, during static initialization of the library: each call through
+// it costs one indirect call and nothing else.
+// Before that (i.e. from another static initializer), the table holds the scalar kernels.
+//
+// Kernels for each SIMD level live in their own translation unit, compiled with the matching
+// -m flags (src/rle/rle-dispatch-*.cpp). Only compiled with LSL_SIMD_DISPATCH.
+namespace dispatch {
+
+// Same parameters as the Line() functions of the rle:: policies
+using RLELineFun = int16_t (*)(const uint8_t* restrict image_row, int16_t* restrict RLCi,
+			       int16_t* restrict ERi, int16_t width);
+
+// Fill line[segment_start:segment_end] with `label` (same as algo::sse::WriteSegmentSSE)
+using WriteSegmentFun = void (*)(int32_t* restrict line, int32_t label,
+				 int segment_start, int segment_end);
+
+// Write a whole label row from its RLC representation (int16_t rows, as written by RLELineFun).
+// `labels` holds the final label of each segment (one entry per segment, not per ER).
+// Background pixels are set to 0. Never writes past line[width - 1].
+using WriteRowFun = void (*)(int32_t* restrict line, const int16_t* restrict RLCi,
+			     const int32_t* restrict labels, int16_t len, int16_t width);
+
+struct Kernels {
+    cpu::SIMDLevel level;
+
+    // Index 0: FG = 1, index 1: FG = 0xff
+    RLELineFun stdz[2];
+    RLELineFun stdz_er[2];
+
+    WriteSegmentFun write_segment;
+    WriteRowFun write_row;
+};
+
+extern Kernels kernels;
+
+// Per-level tables. A level whose TU is not compiled leaves the table untouched.
+void fill_kernels_scalar(Kernels& k);
+void fill_kernels_sse4_2(Kernels& k);
+void fill_kernels_avx2(Kernels& k);
+void fill_kernels_avx512(Kernels& k);
+
+// Fill `kernels` for the given level. Called once at startup with cpu::level(). Not thread-safe:
+// only useful to benchmark the different levels.
+void select(cpu::SIMDLevel level);
+
+}
+
+#endif // CCL_DISPATCH_HPP
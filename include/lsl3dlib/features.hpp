@@ -57,10 +57,11 @@ struct Features {
     int64_t* restrict Sz = nullptr; // Z-moment (sum of Z coordinates)
     uint32_t* restrict S = nullptr; // size/area
 
-    uint16_t* restrict lo_col = nullptr;
+    // Columns are 32 bits wide: rows may be longer than 32k pixels (see rle::STDZ_Generic<int32_t>)
+    uint32_t* restrict lo_col = nullptr;
     uint16_t* restrict lo_row = nullptr;
     uint16_t* restrict lo_slice = nullptr;
-    uint16_t* restrict hi_col = nullptr;
+    uint32_t* restrict hi_col = nullptr;
     uint16_t* restrict hi_row = nullptr;
     uint16_t* restrict hi_slice = nullptr;
 
@@ -119,11 +120,11 @@ struct Features {
 
 	copy_if_not_null<uint32_t>(cpy.S, S, size);
 
-	copy_if_not_null<uint16_t>(cpy.lo_col, lo_col, size);
+	copy_if_not_null<uint32_t>(cpy.lo_col, lo_col, size);
 	copy_if_not_null<uint16_t>(cpy.lo_row, lo_row, size);
 	copy_if_not_null<uint16_t>(cpy.lo_slice, lo_slice, size);
 	
-	copy_if_not_null<uint16_t>(cpy.hi_col, hi_col, size);
+	copy_if_not_null<uint32_t>(cpy.hi_col, hi_col, size);
 	copy_if_not_null<uint16_t>(cpy.hi_row, hi_row, size);
 	copy_if_not_null<uint16_t>(cpy.hi_slice, hi_slice, size);
 
@@ -152,8 +153,8 @@ struct Features {
 	    S = aligned_new<uint32_t>(size, ALIGNMENT);
 	}
 	if (Conf::UseAABB) {
-	    lo_col = aligned_new<uint16_t>(size, ALIGNMENT);
-	    hi_col = aligned_new<uint16_t>(size, ALIGNMENT);
+	    lo_col = aligned_new<uint32_t>(size, ALIGNMENT);
+	    hi_col = aligned_new<uint32_t>(size, ALIGNMENT);
 	    lo_row = aligned_new<uint16_t>(size, ALIGNMENT);
 	    hi_row = aligned_new<uint16_t>(size, ALIGNMENT);
 
@@ -164,6 +165,27 @@ struct Features {
 	}
     }    
     
+    // Same as Alloc, but the arrays are kept when they already hold `size` elements: features can
+    // be reused for a stream of volumes without allocation
+    template <typename Conf>
+    void Reserve(size_t size) {
+	if (size <= this->size && Allocated<Conf>()) {
+	    return;
+	}
+	Alloc<Conf>(size);
+    }
+
+    template <typename Conf>
+    bool Allocated() const {
+	bool moment = !Conf::UseMoment || (Sx != nullptr && Sy != nullptr &&
+					   (Conf::Dims != 3 || Sz != nullptr));
+	bool volume = !Conf::UseVolume || S != nullptr;
+	bool aabb = !Conf::UseAABB || (lo_col != nullptr && lo_row != nullptr &&
+				       hi_col != nullptr && hi_row != nullptr &&
+				       (Conf::Dims != 3 || (lo_slice != nullptr && hi_slice != nullptr)));
+	return moment && volume && aabb;
+    }
+    
     template <typename Conf>
     void Dealloc() {
 	if (Conf::UseMoment) {
@@ -194,8 +216,9 @@ struct Features {
 	Sz = nullptr;
 	S = nullptr;
 
-	lo_col = lo_row = lo_slice = nullptr;
-	hi_col = hi_row = hi_slice = nullptr;	
+	lo_col = hi_col = nullptr;
+	lo_row = lo_slice = nullptr;
+	hi_row = hi_slice = nullptr;	
     }
     
     template <typename Conf>
@@ -249,7 +272,7 @@ struct Features {
 	}
 	if (Conf::UseAABB) {
 	    
-	    std::fill(lo_col + min_label, lo_col + max_label, INT16_MAX);
+	    std::fill(lo_col + min_label, lo_col + max_label, std::numeric_limits<uint32_t>::max());
 	    std::fill(lo_row + min_label, lo_row + max_label, INT16_MAX);
 	    std::fill(hi_col + min_label, hi_col + max_label, 0);
 	    std::fill(hi_row + min_label, hi_row + max_label, 0);
@@ -313,17 +336,17 @@ struct Features {
     template <typename Conf>
     void NewComponent2D(int32_t label) {
 	NewComponent2D<Conf>(label, 0, 0, 0,
+			     std::numeric_limits<uint32_t>::max(),
 			     std::numeric_limits<uint16_t>::max(),
-			     std::numeric_limits<uint16_t>::max(),
-			     std::numeric_limits<uint16_t>::min(),
+			     std::numeric_limits<uint32_t>::min(),
 			     std::numeric_limits<uint16_t>::min());
     }
 
     
     template <typename Conf>
     void NewComponent2D(Label_t label, int64_t sx, int64_t sy, uint32_t s,
-			uint16_t lcol, uint16_t lrow,
-			uint16_t hcol, uint16_t hrow) {
+			uint32_t lcol, uint16_t lrow,
+			uint32_t hcol, uint16_t hrow) {
 	
 	static_assert(Conf::Dims == 2, "NewComponent2D requires 2 dimensions");
 	
@@ -344,14 +367,14 @@ struct Features {
     }
 
     template <typename Conf>
-    void AddSegment2D(uint32_t i, uint16_t row, uint16_t x0, uint16_t x1) {
+    void AddSegment2D(uint32_t i, uint16_t row, uint32_t x0, uint32_t x1) {
 
 	static_assert(Conf::Dims == 2, "AddSegment2D requires 2 dimensions");
 	
-	uint16_t slen = x1 - x0;
+	uint32_t slen = x1 - x0;
 	if (Conf::UseMoment) {
-	    Sx[i] += (x0 + x1 - 1) * (x1 - x0) / 2;
-	    Sy[i] += row * slen;
+	    Sx[i] += ((int64_t)x0 + x1 - 1) * slen / 2;
+	    Sy[i] += (int64_t)row * slen;
 	}
 	if (Conf::UseVolume) {
 	    S[i] += slen;
@@ -360,14 +383,14 @@ struct Features {
 	    lo_col[i] = std::min(x0, lo_col[i]);
 	    lo_row[i] = std::min(row, lo_row[i]);
     
-	    hi_col[i] = std::max<uint16_t>(x1, hi_col[i]);
+	    hi_col[i] = std::max(x1, hi_col[i]);
 	    hi_row[i] = std::max(row, hi_row[i]);
 	}
     }
 
     
     template <typename Conf> 
-    void AddPoint2D(uint32_t i, uint16_t col, uint16_t row) {
+    void AddPoint2D(uint32_t i, uint32_t col, uint16_t row) {
 
 	static_assert(Conf::Dims == 2, "AddPoint2D requires 2 dimensions");
 	
@@ -383,7 +406,7 @@ struct Features {
 	    lo_col[i] = std::min(col, lo_col[i]);
 	    lo_row[i] = std::min(row, lo_row[i]);
     
-	    hi_col[i] = std::max<uint16_t>(col + 1, hi_col[i]);
+	    hi_col[i] = std::max<uint32_t>(col + 1, hi_col[i]);
 	    hi_row[i] = std::max(row, hi_row[i]);
 	}
     }
@@ -404,7 +427,7 @@ struct Features {
 	if (Conf::UseAABB) {
 	    //std::cout << "[" << label << "] NewComponent3D(label): lcol = " << 0 << "\n";		    
 	    
-	    lo_col[label] = std::numeric_limits<int16_t>::max();
+	    lo_col[label] = std::numeric_limits<uint32_t>::max();
 	    hi_col[label] = 0;
 	
 	    lo_row[label] = std::numeric_limits<int16_t>::max();
@@ -416,16 +439,16 @@ struct Features {
     }
     
     template <typename Conf>
-    void NewComponent3D(uint32_t label, uint16_t row, uint16_t slice, uint16_t x0, uint16_t x1) {
+    void NewComponent3D(uint32_t label, uint16_t row, uint16_t slice, uint32_t x0, uint32_t x1) {
 
 	static_assert(Conf::Dims == 3, "NewComponent(label, row, slice, x0, x1) requires 3 dimensions");
 	
-	uint16_t slen = x1 - x0;
+	uint32_t slen = x1 - x0;
 	assert(slen > 0);
 	
-	int64_t sx = (x0 + x1 - 1) * (x1 - x0) / 2;
-	int64_t sy = row * slen;
-	int64_t sz = slice * slen;
+	int64_t sx = ((int64_t)x0 + x1 - 1) * slen / 2;
+	int64_t sy = (int64_t)row * slen;
+	int64_t sz = (int64_t)slice * slen;
     
         NewComponent3D<Conf>(label, sx, sy, sz, slen, x0, row, slice, x1, row, slice);
     }
@@ -433,8 +456,8 @@ struct Features {
     
     template <typename Conf>
     void NewComponent3D(Label_t label, int64_t sx, int64_t sy, int64_t sz, uint32_t s,
-		      uint16_t lcol, uint16_t lrow, uint16_t lslice,
-		      uint16_t hcol, uint16_t hrow, uint16_t hslice) {
+		      uint32_t lcol, uint16_t lrow, uint16_t lslice,
+		      uint32_t hcol, uint16_t hrow, uint16_t hslice) {
 
 	static_assert(Conf::Dims == 3, "NewComponent(label, row, slice, x0, x1) requires 3 dimensions");
 
@@ -465,15 +488,15 @@ struct Features {
 
     // Updates component stats (only for CCA)
     template <typename Conf>
-    void AddSegment3D(uint32_t i, uint16_t row, uint16_t slice, uint16_t x0, uint16_t x1) {
-	uint16_t slen = x1 - x0;
+    void AddSegment3D(uint32_t i, uint16_t row, uint16_t slice, uint32_t x0, uint32_t x1) {
+	uint32_t slen = x1 - x0;
 
 	static_assert(Conf::Dims == 3, "NewComponent(label, row, slice, x0, x1) requires 3 dimensions");
 	
 	if (Conf::UseMoment) {
-	    Sx[i] += (x0 + x1 - 1) * (x1 - x0) / 2;
-	    Sy[i] += row * slen;
-	    Sz[i] += slice * slen;
+	    Sx[i] += ((int64_t)x0 + x1 - 1) * slen / 2;
+	    Sy[i] += (int64_t)row * slen;
+	    Sz[i] += (int64_t)slice * slen;
 	}
 	if (Conf::UseVolume) {
 	    //std::cout << "[" << i << "] NewComponent3D: S (" << S[i] << ") = " << slen << "\n";
@@ -485,14 +508,14 @@ struct Features {
 	    lo_row[i] = std::min(row, lo_row[i]);
 	    lo_slice[i] = std::min(slice, lo_slice[i]); // Might not be needed if new pixel
     
-	    hi_col[i] = std::max<uint16_t>(x1, hi_col[i]);
+	    hi_col[i] = std::max(x1, hi_col[i]);
 	    hi_row[i] = std::max<uint16_t>(row + 1, hi_row[i]);
 	    hi_slice[i] = std::max<uint16_t>(slice + 1, hi_slice[i]); //
 	}
     }
     
     template <typename Conf>
-    void AddPoint3D(uint32_t i, uint16_t col, uint16_t row, uint16_t slice) {
+    void AddPoint3D(uint32_t i, uint32_t col, uint16_t row, uint16_t slice) {
 
 	static_assert(Conf::Dims == 3, "NewComponent(label, row, slice, x0, x1) requires 3 dimensions");
 	
@@ -510,7 +533,7 @@ struct Features {
 	    lo_row[i] = std::min(row, lo_row[i]);
 	    lo_slice[i] = std::min(slice, lo_slice[i]); // Might not be needed if new pixel
     
-	    hi_col[i] = std::max<uint16_t>(col + 1, hi_col[i]);
+	    hi_col[i] = std::max<uint32_t>(col + 1, hi_col[i]);
 	    hi_row[i] = std::max<uint16_t>(row + 1, hi_row[i]);
 	    hi_slice[i] = std::max<uint16_t>(slice + 1, hi_slice[i]); 
 	}
@@ -8,8 +8,8 @@ template <typename Conf, typename LabelsSolver>
 struct LSL_CCL_t {
     typename Conf::Seg_t** RLC = nullptr;
     int32_t** ERA = nullptr;
-    int16_t** ER = nullptr;
-    int16_t* Lengths = nullptr;
+    typename Conf::Seg_t** ER = nullptr;
+    typename Conf::Seg_t* Lengths = nullptr;
     LabelsSolver ET;
     
     MAT3D_i32 labels;
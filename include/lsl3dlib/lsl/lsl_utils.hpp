@@ -4,6 +4,8 @@
 #include <cstdint>
 #include <limits>
 
+#include <simdhelpers/restrict.hpp>
+
 namespace algo {
 
 constexpr uint16_t to_era_index(uint32_t segment_id) {
@@ -23,6 +25,16 @@ int16_t count_intersections(const int16_t* rlc0, int16_t len0,
 // This is useful when calculating statistics on the image witout iterating twice on it
 int16_t count_foreground(const int16_t* rlc0, int16_t len);
 
+// Estimate of the number of foreground pixels of an image row, before its RLE: one pixel out of
+// `step` is read. Used to balance the slabs of LSL3D_Parallel.
+inline int count_foreground(const uint8_t* restrict line, int width, int step) {
+    int count = 0;
+    for (int col = 0; col < width; col += step) {
+	count += line[col] & 1; // Same test as the scalar encoders ({0; 1} and {0; 255} images)
+    }
+    return count * step;
+}
+
 }
 
 #endif // CCL_ALGOS_LSL_UTILS_HPP
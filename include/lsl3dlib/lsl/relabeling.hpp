@@ -15,7 +15,6 @@ template <typename SegmentWriteFun>
 struct Relabeling_Z_Generic {
 
     struct Conf {
-	using Seg_t = typename SegmentWriteFun::Conf::Seg_t;
 	using Label_t = typename SegmentWriteFun::Conf::Label_t;
     };
 
@@ -25,17 +24,19 @@ struct Relabeling_Z_Generic {
 
 template <typename SegmentWriteFun> template <typename ConfLSL, typename LabelsSolver>
 void Relabeling_Z_Generic<SegmentWriteFun>::Relabel(LSL_CCL_t<ConfLSL, LabelsSolver>& lsl) {
+    using Seg_t = typename ConfLSL::Seg_t;
+
     int width = lsl.width;
     int height = lsl.height;
     
     for (int row = 0; row < height; row++) {
-	int16_t segment_count = lsl.Lengths[row];
-	const typename Conf::Seg_t* restrict RLCi = lsl.RLC[row];
+	int segment_count = lsl.Lengths[row];
+	const Seg_t* restrict RLCi = lsl.RLC[row];
 	const typename Conf::Label_t* restrict ERAi = lsl.ERA[row];
 
 	typename Conf::Label_t* restrict dstline = lsl.labels.template ptr<int32_t>(row);
 	
-	typename Conf::Seg_t segment_start = 0;
+	Seg_t segment_start = 0;
 	typename Conf::Label_t segment_end = 0;
 	
 	for (int er = 1; er < segment_count; er += 2) {
@@ -9,16 +9,16 @@
 namespace lsl {
 
 
+// Columns are int: segments of any Seg_t and the row width are written
 struct WriteSegmentScalar {
         
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
     };
     
-    static inline void Write(int32_t* restrict line, int16_t segment_start, int16_t segment_end,
+    static inline void Write(int32_t* restrict line, int segment_start, int segment_end,
 			     int32_t label) {
-	for (int16_t i = segment_start; i <= segment_end; i++) {
+	for (int i = segment_start; i <= segment_end; i++) {
 	    line[i] = label;
 	}
     }    
@@ -0,0 +1,237 @@
+#ifndef CCL_ALGOS_3D_ARENA_HPP
+#define CCL_ALGOS_3D_ARENA_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+
+#include <simdhelpers/restrict.hpp>
+#include <simdhelpers/aligned_alloc.hpp>
+
+#include <lsl3dlib/utility.hpp>
+#include <lsl3dlib/rle/rle.hpp>
+#include <lsl3dlib/rle/compact_er.hpp>
+
+// One row of the intermediate state of LSL 3D
+template <typename Seg_t>
+struct RowView {
+    Seg_t* restrict RLC;
+    int32_t* restrict ERA; // nullptr when the arena has no ERA rows
+    Seg_t* restrict ER; // nullptr when the arena has no ER rows
+    Seg_t len;
+};
+
+// Intermediate state of LSL 3D (RLC, ERA, Lengths and ER) in a single allocation.
+// Rows are stored back to back with a fixed pitch: row (slice, row) is at offset
+// (slice * height + row) * pitch of its table, without any pointer table.
+//
+// Layout (each table aligned to ALIGNMENT):
+// - RLC: depth * height rows + the empty row (sentinels only)
+// - ERA: depth * height rows, none for the ERA-less unifications (labels are implicit)
+// - Lengths: depth * height entries
+// - ER: `er_planes` slices of rows + the empty row (all 0), with ER[-1] = 0. The planes are used
+//   as rings of `er_ring` slices (plane slice % er_ring). A sequential pass only needs two
+//   consecutive slices, each slab of LSL3D_Parallel has its own pair of planes and LSL3D_Pipeline
+//   lets the RLE run ahead of the unification in a longer ring.
+//   With `compact_er`, the rows are rle::CompactER rows (no ER[-1]) built from the RLC rows.
+// - Z: `z_rows` pairs of RLC and ERA rows, the rows of the previous slice combined by
+//   unify::Unify_SM_Combined_Z (AdjState::z_RLC, z_ERA). One pair per concurrent unification:
+//   LSL3D uses the pair of its ER planes (er_base / er_ring), LSL3D_Bands one pair per thread.
+template <typename Seg_t>
+struct RLEArena {
+
+    static constexpr size_t ALIGNMENT = 64;
+
+    uint8_t* base = nullptr;
+    size_t bytes = 0;    // Used by the current shape
+    size_t capacity = 0; // Allocated
+
+    Seg_t* rlc = nullptr;
+    int32_t* era = nullptr;
+    Seg_t* lengths = nullptr;
+    Seg_t* er = nullptr;
+    Seg_t* z_rlc = nullptr;
+    int32_t* z_era = nullptr;
+
+    // Pitches, in elements (margins included)
+    size_t rlc_pitch = 0;
+    size_t era_pitch = 0;
+    size_t er_pitch = 0;
+    size_t z_rlc_pitch = 0;
+    size_t z_era_pitch = 0;
+
+    int width = 0;
+    int height = 0;
+    int depth = 0;
+    int er_planes = 0;
+    int er_ring = 2;
+    int z_rows = 1;
+    bool compact_er = false;
+
+    // The buffer is only reallocated when the shape needs more than `capacity` bytes: the same
+    // arena can be reused for a stream of volumes without allocation nor page faults
+    void Alloc(int width, int height, int depth, bool with_er, int er_planes = 2, int er_ring = 2,
+	       bool with_era = true, bool compact_er = false, int z_rows = 1);
+    void Free();
+
+    static inline size_t RLCPitch(int width);
+    static inline size_t ERAPitch(int width);
+    static inline size_t ERPitch(int width);
+    static inline size_t CompactERPitch(int width);
+    static inline size_t ZRLCPitch(int width);
+    static inline size_t ZERAPitch(int width);
+
+    inline size_t Index(int slice, int row) const { return (size_t)slice * height + row; }
+
+    inline Seg_t* RLC(int slice, int row) const { return rlc + Index(slice, row) * rlc_pitch; }
+    inline int32_t* ERA(int slice, int row) const;
+    inline Seg_t& Length(int slice, int row) const { return lengths[Index(slice, row)]; }
+    // ER rows of `slice` are in plane er_base + slice % er_ring
+    inline Seg_t* ER(int slice, int row, int er_base = 0) const;
+
+    inline RowView<Seg_t> Row(int slice, int row, int er_base = 0) const;
+
+    // Combined rows of pair k (k < z_rows)
+    inline Seg_t* ZRLC(int k) const { return z_rlc + (size_t)k * z_rlc_pitch; }
+    inline int32_t* ZERA(int k) const { return z_era + (size_t)k * z_era_pitch; }
+
+    // Row with no segment, used as neighbour outside of the volume
+    inline RowView<Seg_t> Empty() const;
+};
+
+
+template <typename Seg_t>
+size_t RLEArena<Seg_t>::RLCPitch(int width) {
+    // width + 1 edges, 2 sentinels, and the SIMD encoders store 16 elements at a time
+    return calc_stride(width + 2 + 2 * rle::RLE_IMG_MARGIN_AFTER, ALIGNMENT / sizeof(Seg_t));
+}
+
+template <typename Seg_t>
+size_t RLEArena<Seg_t>::ERAPitch(int width) {
+    // Relabeling_Pixel loads 4 labels at a time
+    return calc_stride(width / 2 + 2 + 4, ALIGNMENT / sizeof(int32_t));
+}
+
+template <typename Seg_t>
+size_t RLEArena<Seg_t>::ERPitch(int width) {
+    // ER[-1] and ER[width] are read by the ER unification
+    return calc_stride(1 + width + rle::RLE_ER_MARGIN_AFTER, ALIGNMENT / sizeof(Seg_t));
+}
+
+template <typename Seg_t>
+size_t RLEArena<Seg_t>::CompactERPitch(int width) {
+    return calc_stride(rle::CompactER<Seg_t>::RowSize(width), ALIGNMENT / sizeof(Seg_t));
+}
+
+template <typename Seg_t>
+size_t RLEArena<Seg_t>::ZRLCPitch(int width) {
+    // The runs of three rows (width + 2 edges each at most) and 2 sentinels
+    return calc_stride(3 * (width + 2) + 2, ALIGNMENT / sizeof(Seg_t));
+}
+
+template <typename Seg_t>
+size_t RLEArena<Seg_t>::ZERAPitch(int width) {
+    return calc_stride(3 * (width + 2) / 2 + 2, ALIGNMENT / sizeof(int32_t));
+}
+
+template <typename Seg_t>
+void RLEArena<Seg_t>::Alloc(int width, int height, int depth, bool with_er, int er_planes,
+			    int er_ring, bool with_era, bool compact_er, int z_rows) {
+    this->width = width;
+    this->height = height;
+    this->depth = depth;
+    this->er_planes = with_er ? er_planes : 0;
+    this->er_ring = er_ring;
+    this->compact_er = compact_er;
+    this->z_rows = z_rows;
+
+    rlc_pitch = RLCPitch(width);
+    era_pitch = ERAPitch(width);
+    er_pitch = compact_er ? CompactERPitch(width) : ERPitch(width);
+    z_rlc_pitch = ZRLCPitch(width);
+    z_era_pitch = ZERAPitch(width);
+
+    const size_t rows = (size_t)height * depth;
+
+    const size_t rlc_bytes = calc_stride((rows + 1) * rlc_pitch * sizeof(Seg_t), ALIGNMENT);
+    const size_t era_bytes = with_era ?
+	calc_stride(rows * era_pitch * sizeof(int32_t), ALIGNMENT) : 0;
+    const size_t len_bytes = calc_stride(rows * sizeof(Seg_t), ALIGNMENT);
+    const size_t er_bytes = with_er ?
+	calc_stride(((size_t)er_planes * height + 1) * er_pitch * sizeof(Seg_t), ALIGNMENT) : 0;
+    const size_t z_rlc_bytes = calc_stride(z_rows * z_rlc_pitch * sizeof(Seg_t), ALIGNMENT);
+    const size_t z_era_bytes = z_rows * z_era_pitch * sizeof(int32_t);
+
+    const size_t total = rlc_bytes + era_bytes + len_bytes + er_bytes + z_rlc_bytes + z_era_bytes;
+    if (total > capacity) {
+	Free();
+	base = aligned_new<uint8_t>(total, ALIGNMENT);
+	capacity = total;
+    }
+    bytes = total;
+
+    rlc = (Seg_t*)base;
+    era = with_era ? (int32_t*)(base + rlc_bytes) : nullptr;
+    lengths = (Seg_t*)(base + rlc_bytes + era_bytes);
+    er = with_er ? (Seg_t*)(base + rlc_bytes + era_bytes + len_bytes) : nullptr;
+    z_rlc = (Seg_t*)(base + rlc_bytes + era_bytes + len_bytes + er_bytes);
+    z_era = (int32_t*)(base + rlc_bytes + era_bytes + len_bytes + er_bytes + z_rlc_bytes);
+
+    Seg_t* restrict empty = rlc + rows * rlc_pitch;
+    empty[0] = rle::rle_sentinel<Seg_t>();
+    empty[1] = rle::rle_sentinel<Seg_t>();
+
+    // Only the part used by this shape is reset
+    if (with_er) {
+	memset(er, 0, er_bytes);
+    }
+}
+
+template <typename Seg_t>
+void RLEArena<Seg_t>::Free() {
+    if (base != nullptr) {
+	aligned_delete(base, ALIGNMENT);
+    }
+    base = nullptr;
+    bytes = 0;
+    capacity = 0;
+    rlc = nullptr;
+    era = nullptr;
+    lengths = nullptr;
+    er = nullptr;
+    z_rlc = nullptr;
+    z_era = nullptr;
+}
+
+template <typename Seg_t>
+int32_t* RLEArena<Seg_t>::ERA(int slice, int row) const {
+    if (era == nullptr) {
+	return nullptr;
+    }
+    return era + Index(slice, row) * era_pitch;
+}
+
+template <typename Seg_t>
+Seg_t* RLEArena<Seg_t>::ER(int slice, int row, int er_base) const {
+    if (er == nullptr) {
+	return nullptr;
+    }
+    return er + ((size_t)(er_base + slice % er_ring) * height + row) * er_pitch + !compact_er;
+}
+
+template <typename Seg_t>
+RowView<Seg_t> RLEArena<Seg_t>::Row(int slice, int row, int er_base) const {
+    return RowView<Seg_t>{RLC(slice, row), ERA(slice, row), ER(slice, row, er_base),
+			  Length(slice, row)};
+}
+
+template <typename Seg_t>
+RowView<Seg_t> RLEArena<Seg_t>::Empty() const {
+    Seg_t* empty_er = er != nullptr ?
+	er + (size_t)er_planes * height * er_pitch + !compact_er : nullptr;
+    // ERA is never read: the empty row has no segment
+    return RowView<Seg_t>{rlc + (size_t)depth * height * rlc_pitch, era, empty_er, 0};
+}
+
+#endif // CCL_ALGOS_3D_ARENA_HPP
@@ -0,0 +1,74 @@
+#ifndef CCL_ALGOS_3D_CONTEXT_HPP
+#define CCL_ALGOS_3D_CONTEXT_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+#include <lsl3dlib/compat.hpp>
+#include <lsl3dlib/features.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_ccl.hpp>
+
+namespace algo {
+
+// Reusable labeling context for streams of volumes (LSL: an algo::LSL3D instance).
+// The arena, the equivalence table and the features are kept from one call to the next and only
+// grow when a bigger shape arrives: in the steady state Label() does not allocate, and only the
+// part of each buffer used by the current shape is reset.
+//
+// Usage:
+//   LSL3D_Context<LSL3D<rle::STDZ, unify::Unify_SM_Separate, ...>, ConfFeatures3DNone> ctx;
+//   for (...) {
+//       uint32_t n = ctx.Label(image, labels);
+//   }
+template <typename LSL, typename ConfFeatures>
+struct LSL3D_Context {
+
+    typename LSL::CCL ccl;
+    Features features;
+
+    LSL3D_Context() = default;
+    LSL3D_Context(const LSL3D_Context&) = delete;
+    LSL3D_Context& operator=(const LSL3D_Context&) = delete;
+
+    ~LSL3D_Context();
+
+    // Allocate for volumes up to width x height x depth ahead of the first Label()
+    void Reserve(int width, int height, int depth);
+
+    // Label `image` into `labels` (3D matrices of the same size, see create_mat_with_border for
+    // the margins required by the SIMD kernels). Returns the number of labels, background
+    // included. Features are available in `features` until the next call.
+    template <uint8_t FG = 1>
+    uint32_t Label(const MAT3D_ui8& image, MAT3D_i32& labels);
+};
+
+
+template <typename LSL, typename ConfFeatures>
+LSL3D_Context<LSL, ConfFeatures>::~LSL3D_Context() {
+    LSL::Free(ccl);
+}
+
+template <typename LSL, typename ConfFeatures>
+void LSL3D_Context<LSL, ConfFeatures>::Reserve(int width, int height, int depth) {
+    LSL::Alloc(ccl, width, height, depth);
+    features.Reserve<ConfFeatures>(LSL::MaxLabels(width, height, depth));
+}
+
+template <typename LSL, typename ConfFeatures>
+template <uint8_t FG>
+uint32_t LSL3D_Context<LSL, ConfFeatures>::Label(const MAT3D_ui8& image, MAT3D_i32& labels) {
+    int width, height, depth;
+    GetMatSize(image, width, height, depth);
+
+    Reserve(width, height, depth);
+
+    // Headers only: the data is shared with the caller
+    ccl.image = image;
+    ccl.labels = labels;
+
+    return LSL::template Run<ConfFeatures, FG>(ccl, features);
+}
+
+}
+
+#endif // CCL_ALGOS_3D_CONTEXT_HPP
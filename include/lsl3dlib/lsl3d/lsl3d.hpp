@@ -2,19 +2,28 @@
 #define LSL3DLIB_LSL3D_LSL3D_HPP_
 
 #include <cstdint>
+#include <vector>
 
 #include <lsl3dlib/compat.hpp>
+#include <lsl3dlib/lsl3d/arena.hpp>
+#include <lsl3dlib/lsl3d/occupancy.hpp>
 
 
 template <typename Conf, typename LabelsSolver>
 struct LSL3D_CCL_t {
     
     
-    typename Conf::Seg_t*** RLC = nullptr;
-    int32_t*** ERA = nullptr;
-    int16_t* ER = nullptr;
-    int16_t** Lengths = nullptr;
+    // RLC, ERA, Lengths and ER rows in a single allocation
+    RLEArena<typename Conf::Seg_t> arena;
     LabelsSolver ET;
+    size_t label_capacity = 0; // Size of ET
+
+    // Non-empty rows and per slice bounding boxes (filled by LSL3D::Run)
+    Occupancy occupancy;
+
+    // ERA-less unifications (Unify::Conf::ERA = false): label of the first segment of each row,
+    // index slice * height + row, the segments being numbered in raster order from 1
+    std::vector<int32_t> row_label;
     
     MAT3D_i32 labels;
     MAT3D_ui8 image;
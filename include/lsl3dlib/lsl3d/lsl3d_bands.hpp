@@ -0,0 +1,230 @@
+#ifndef CCL_ALGOS_3D_LSL3D_BANDS_HPP
+#define CCL_ALGOS_3D_LSL3D_BANDS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include <vector>
+
+#include <simdhelpers/restrict.hpp>
+
+#include <lsl3dlib/parallel.hpp>
+#include <lsl3dlib/features.hpp>
+#include <lsl3dlib/solvers/concurrent.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_ccl.hpp>
+#include <lsl3dlib/lsl3d/reduce_fsm.hpp>
+
+namespace algo {
+
+// Row band parallel LSL 3D, for volumes too shallow in z for LSL3D_Parallel (one slab per
+// thread). Every slice is cut into bands of BAND_ROWS rows (a multiple of 64: bands do not share
+// an occupancy word), dealt to the threads in turn. All the threads unify against one
+// ConcurrentLabelsSolver (ccl.ET), there is no reduction phase:
+// 1. RLE and unification of band b of slice z, its first row being unified without the row above
+//    (it belongs to band b - 1). Slice z - 1 is complete: its rows row - 1, row + 1 are read across
+//    the band borders.
+// 2. Barrier at the end of each slice (the last thread merges the per band bounding boxes).
+// 3. The first row of band b is merged with the last row of band b - 1 (Reduce_FSM::ReduceLine,
+//    8-connectivity in the slice). It runs at the beginning of the next slice, concurrently with
+//    the unifications.
+// 4. ccl.ET is flattened, features are computed and the threads relabel slices.
+//
+// Unification runs without features (see LSL3D_Parallel).
+template <typename RLE, typename Unify, typename FeatureComputation, typename Relabeling>
+struct LSL3D_Bands {
+
+    using LabelsSolver = ConcurrentLabelsSolver;
+    using LSL = LSL3D<RLE, Unify, FeatureComputation, Relabeling, LabelsSolver>;
+    using Conf = typename LSL::Conf;
+    using Seg_t = typename LSL::Seg_t;
+
+    static_assert(Unify::Conf::ERA, "ERA-less unifications are only supported by LSL3D");
+
+    static constexpr int BAND_ROWS = 64;
+
+    struct CCL : LSL::CCL {
+	int thread_count = 0;
+	int band_count = 0;
+	std::vector<Occupancy::Box> band_box; // Bounding box of each band in the current slice
+    };
+
+    static inline size_t MaxLabels(int width, int height, int depth) {
+	return LSL::MaxLabels(width, height, depth);
+    }
+
+    // Buffers only grow (see LSL3D::Alloc)
+    static void Alloc(CCL& ccl, int width, int height, int depth,
+		      int threads = parallel::hardware_threads());
+    static void Free(CCL& ccl);
+
+    // Same as LSL3D::Run
+    template <typename ConfFeatures, uint8_t FG = 1>
+    static uint32_t Run(CCL& ccl, Features& features);
+
+    // RLE and unification of band b of `slice`
+    template <uint8_t FG>
+    static void LabelBand(CCL& ccl, LabelsSolver::Handle& ET, int slice, int b);
+
+    // Merge the first row of band b (b > 0) with the last row of band b - 1
+    static void MergeBand(CCL& ccl, LabelsSolver::Handle& ET, int slice, int b);
+};
+
+
+template <typename RLE, typename Unify, typename FC, typename RL>
+void LSL3D_Bands<RLE, Unify, FC, RL>::Alloc(CCL& ccl, int width, int height, int depth,
+					    int threads) {
+    assert(width < rle::rle_sentinel<Seg_t>() && "Rows too wide for Seg_t");
+
+    ccl.width = width;
+    ccl.height = height;
+    ccl.depth = depth;
+
+    ccl.band_count = (height + BAND_ROWS - 1) / BAND_ROWS;
+    ccl.thread_count = std::max(1, std::min(threads, ccl.band_count));
+    ccl.band_box.resize(ccl.band_count);
+
+    ccl.arena.Alloc(width, height, depth, Conf::ER || Conf::CompactER, 2, 2, true,
+		    Conf::CompactER, ccl.thread_count);
+
+    // One partly used block per thread
+    const size_t labels = MaxLabels(width, height, depth) +
+	(size_t)ccl.thread_count * LabelsSolver::BLOCK;
+    if (labels > ccl.label_capacity) {
+	ccl.ET.Alloc(labels);
+	ccl.label_capacity = labels;
+    }
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL>
+void LSL3D_Bands<RLE, Unify, FC, RL>::Free(CCL& ccl) {
+    ccl.band_box.clear();
+    ccl.band_count = 0;
+    ccl.thread_count = 0;
+
+    LSL::Free(ccl);
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL>
+template <uint8_t FG>
+void LSL3D_Bands<RLE, Unify, FC, RL>::LabelBand(CCL& ccl, LabelsSolver::Handle& ET, int slice,
+						int b) {
+    const int width = ccl.width;
+    const int row0 = b * BAND_ROWS;
+    const int row1 = std::min(ccl.height, row0 + BAND_ROWS);
+
+    Occupancy::Box& box = ccl.band_box[b];
+    box = Occupancy::Box();
+
+    for (int row = row0; row < row1; row++) {
+	const rle::pixel_t<RLE>* restrict line =
+	    ccl.image.template ptr<rle::pixel_t<RLE>>(slice, row);
+	Seg_t* restrict RLCi = ccl.arena.RLC(slice, row);
+	Seg_t* restrict ERi = ccl.arena.ER(slice, row);
+
+	Seg_t len = RLE::template Line<FG>(line, RLCi, ERi, width);
+	if (Conf::ER) {
+	    ERi[-1] = 0;
+	    ERi[width] = ERi[width - 1];
+	}
+	if (Conf::CompactER) {
+	    rle::CompactER<Seg_t>::Build(RLCi, len, ERi, width);
+	}
+	ccl.arena.Length(slice, row) = len;
+	ccl.occupancy.AddRow(slice, row, RLCi, len, box);
+    }
+
+    // Lengths rather than occupancy.NextOccupiedRow: the words after the band are being written
+    // Band b is labeled by thread b % thread_count (see Run)
+    AdjState<Seg_t, int32_t> state;
+    state.z_RLC = ccl.arena.ZRLC(b % ccl.thread_count);
+    state.z_ERA = ccl.arena.ZERA(b % ccl.thread_count);
+    Features none;
+    for (int row = row0; row < row1; row++) {
+	if (ccl.arena.Length(slice, row) == 0) {
+	    continue;
+	}
+
+	// The row above the band is merged by MergeBand
+	LSL::Neighbour(ccl, slice, row == row0 ? -1 : row - 1, 0, 0,
+		       state.RLC0, state.ERA0, state.ER0, state.len0);
+	LSL::Neighbour(ccl, slice - 1, row - 1, 0, 0,
+		       state.RLC1, state.ERA1, state.ER1, state.len1);
+	LSL::Neighbour(ccl, slice - 1, row, 0, 0,
+		       state.RLC2, state.ERA2, state.ER2, state.len2);
+	LSL::Neighbour(ccl, slice - 1, row + 1, 0, 0,
+		       state.RLC3, state.ERA3, state.ER3, state.len3);
+
+	const RowView<Seg_t> cur = ccl.arena.Row(slice, row);
+	Unify::template Unify<LabelsSolver::Handle, ConfFeatures3DNone>(
+	    state, cur.RLC, cur.ERA, cur.len, ET, none, row, slice, width);
+    }
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL>
+void LSL3D_Bands<RLE, Unify, FC, RL>::MergeBand(CCL& ccl, LabelsSolver::Handle& ET, int slice,
+						int b) {
+    const int row = b * BAND_ROWS;
+    const RowView<Seg_t> cur = ccl.arena.Row(slice, row);
+    const RowView<Seg_t> above = ccl.arena.Row(slice, row - 1);
+
+    Features none;
+    Reduce_FSM::ReduceLine<LabelsSolver::Handle, ConfFeatures3DNone,
+			   unify::connectivity_t<Unify>::Diag0>(
+	cur.RLC, above.RLC, cur.ERA, above.ERA, cur.len, above.len, ET, none);
+}
+
+template <typename RLE, typename Unify, typename FeatureComputation, typename Relabeling>
+template <typename ConfFeatures, uint8_t FG>
+uint32_t LSL3D_Bands<RLE, Unify, FeatureComputation, Relabeling>::Run(CCL& ccl,
+								       Features& features) {
+    const int threads = ccl.thread_count;
+    const int bands = ccl.band_count;
+    const int depth = ccl.depth;
+
+    ccl.ET.Setup();
+    ccl.occupancy.Reset(ccl.height, depth);
+
+    // 1-3. Unification of the bands, merge of the band borders
+    parallel::Barrier barrier(threads);
+    parallel::parallel_for(threads, [&](int t) {
+	LabelsSolver::Handle ET(ccl.ET);
+
+	for (int slice = 0; slice < depth; slice++) {
+	    for (int b = t; b < bands; b += threads) {
+		if (slice > 0 && b > 0) {
+		    MergeBand(ccl, ET, slice - 1, b);
+		}
+		LabelBand<FG>(ccl, ET, slice, b);
+	    }
+	    barrier.ArriveAndWait([&] {
+		for (int k = 0; k < bands; k++) {
+		    ccl.occupancy.slices[slice].Merge(ccl.band_box[k]);
+		}
+	    });
+	}
+	for (int b = t; b < bands; b += threads) {
+	    if (depth > 0 && b > 0) {
+		MergeBand(ccl, ET, depth - 1, b);
+	    }
+	}
+    });
+
+    uint32_t label_count = ccl.ET.Flatten();
+
+    // 4. Features and relabeling
+    FeatureComputation::template CalcFeatures<LabelsSolver, ConfFeatures>(
+	ccl.arena, ccl.ET, features, label_count, &ccl.occupancy);
+
+    const int parts = std::max(1, std::min(threads, depth));
+    parallel::parallel_for(parts, [&](int k) {
+	Relabeling::Relabel(ccl, (int)((int64_t)depth * k / parts),
+			    (int)((int64_t)depth * (k + 1) / parts));
+    });
+
+    return label_count;
+}
+
+}
+
+#endif // CCL_ALGOS_3D_LSL3D_BANDS_HPP
@@ -0,0 +1,298 @@
+#ifndef CCL_ALGOS_3D_LSL3D_CCL_HPP
+#define CCL_ALGOS_3D_LSL3D_CCL_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+
+#include <simdhelpers/restrict.hpp>
+
+#include <lsl3dlib/features.hpp>
+#include <lsl3dlib/rle/rle.hpp>
+#include <lsl3dlib/lsl3d/lsl3d.hpp>
+#include <lsl3dlib/lsl3d/arena.hpp>
+#include <lsl3dlib/lsl3d/unification_common.hpp>
+#include <lsl3dlib/solvers/union_find.hpp>
+
+namespace algo {
+
+// Sequential LSL 3D: each slice is run-length encoded then unified with the previous one. Labels
+// are then resolved, features computed and the label volume written.
+//
+// RLE: rle::STDZ, rle::STDZ_ER, rle::sse::..., rle::dispatch::... (static Line<FG>)
+//      The rows of ccl.image are read as rle::pixel_t<RLE>: uint8_t, or the words of rle::bit::
+//      encoders. ccl.image is then a byte header over these rows (create_byte_view), and only the
+//      relabelings that do not read the image (Relabeling_Z_*) can be used.
+// Unify: unify::Unify_SM_Separate, unify::Unify_ER, unify::Unify_SM_NoERA... (Conf::Double = false)
+//        With Conf::CompactER (unify::Unify_ER_Compact), the ER rows are rle::CompactER rows built
+//        after the RLE: the encoder does not write ER.
+// FeatureComputation: FeatureComputation, FeatureComputation_None, FeatureComputation_OTF
+// Relabeling: policies providing Relabel(LSL3D_CCL_t&) (Relabeling_Z_Generic, Relabeling_Pixel...)
+// LabelsSolver: Alloc(size), Setup(), Dealloc(), NewLabel(), FindRoot(), UpdateTable(),
+//               GetLabel(), Flatten() (returns the number of labels, background included)
+//               Setup() is called for each volume and should only reset what NewLabel() does not
+//               initialize: the table may be much bigger than the labels in use.
+//               EndSlice() is optional, called after the unification of each slice.
+//               In-tree solvers: solvers/union_find.hpp, solvers/concurrent.hpp.
+//
+// The intermediate state lives in ccl.arena (see RLEArena).
+//
+// Neighbours of a row (AdjState): RLC0 is the previous row of the slice, RLC1..RLC3 are the rows
+// row - 1, row and row + 1 of the previous slice. Rows outside of the volume are replaced by an
+// empty row (sentinels only, ER = 0). The unification selects the 3D connectivity
+// (Unify::Conf::Connectivity, 26 by default): RLC1 and RLC3 are not set in 6-connectivity.
+//
+// Empty rows are recorded in ccl.occupancy during the RLE: they are not unified, and empty slices
+// are skipped as a whole.
+//
+// ERA-less unifications (Unify::Conf::ERA = false, unify::Unify_SM_NoERA): the arena has no ERA,
+// the label of a segment is its index in raster order (from 1). ccl.row_label holds the label of
+// the first segment of each row, it is filled slice by slice by UnifySlice and passed to the
+// unification as AdjState::uf_offset (current row) and uf_offset0..3 (neighbour rows). Only
+// FeatureComputation_None/_OTF and Relabeling_Z_NOERA can be used, and the volume must be
+// labeled from its first slice (slice0 = 0).
+template <typename RLE, typename Unify, typename FeatureComputation, typename Relabeling,
+	  typename LabelsSolver>
+struct LSL3D {
+
+    struct Conf {
+	using Seg_t = typename RLE::Conf::Seg_t;
+	using Label_t = int32_t;
+
+	static constexpr bool ER = RLE::Conf::ER;
+	// ER rows built from the RLC rows (rle::CompactER)
+	static constexpr bool CompactER = unify::compact_er_v<Unify>;
+    };
+
+    using Seg_t = typename Conf::Seg_t;
+    using Pixel_t = rle::pixel_t<RLE>;
+    using CCL = LSL3D_CCL_t<Conf, LabelsSolver>;
+
+    static_assert(!Unify::Conf::Double, "Double line unifications are not supported");
+    static_assert(!Unify::Conf::ER || RLE::Conf::ER, "ER unification requires an ER encoder");
+    static_assert(!Conf::CompactER || !RLE::Conf::ER,
+		  "Compact ER rows replace the ER of the encoder");
+
+    // Upper bound of the number of provisional labels (unify::max_labels)
+    static inline size_t MaxLabels(int width, int height, int depth);
+
+    // Buffers (arena, ET) only grow: Alloc can be called before each volume, it only allocates
+    // when the shape is bigger than every previous one (see LSL3D_Context)
+    static void Alloc(CCL& ccl, int width, int height, int depth);
+    static void Free(CCL& ccl);
+
+    // Labels ccl.image into ccl.labels and returns the number of labels (background included).
+    // When ConfFeatures is not a *None configuration, `features` must hold MaxLabels() elements.
+    template <typename ConfFeatures, uint8_t FG = 1>
+    static uint32_t Run(CCL& ccl, Features& features);
+
+    // RLE and unification of the slices [slice0, slice1) into ET, slice0 being handled as the
+    // first slice of a volume. ER rows use the planes er_base and er_base + 1 of the arena.
+    // ccl.occupancy must have been reset.
+    template <typename ConfFeatures, uint8_t FG = 1>
+    static void LabelSlices(CCL& ccl, LabelsSolver& ET, Features& features,
+			    int slice0, int slice1, int er_base = 0);
+
+    // The two halves of LabelSlices for one slice. EncodeSlice only depends on the image, the
+    // slice is recorded in ccl.occupancy. UnifySlice reads the previous slice (unless
+    // slice == slice0): its ER plane must not have been overwritten.
+    template <uint8_t FG = 1>
+    static void EncodeSlice(CCL& ccl, int slice, int er_base = 0);
+    template <typename ConfFeatures>
+    static void UnifySlice(CCL& ccl, LabelsSolver& ET, Features& features, int slice,
+			   int slice0, int er_base = 0);
+
+    // Row (slice, row) as a neighbour: the empty row when outside of [slice0, depth)
+    static inline void Neighbour(CCL& ccl, int slice, int row, int slice0, int er_base,
+				 Seg_t* restrict& RLC, int32_t* restrict& ERA,
+				 Seg_t* restrict& ER, Seg_t& len);
+
+    // ERA-less unifications: ccl.row_label of the rows of `slice`
+    static inline void NumberRows(CCL& ccl, int slice, int slice0);
+    // Label of the first segment of row (slice, row), 0 when outside of [slice0, depth)
+    static inline int32_t RowLabel(const CCL& ccl, int slice, int row, int slice0);
+};
+
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+size_t LSL3D<RLE, Unify, FC, RL, LabelsSolver>::MaxLabels(int width, int height, int depth) {
+    return unify::max_labels<Unify>(width, height, depth);
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+void LSL3D<RLE, Unify, FC, RL, LabelsSolver>::Neighbour(CCL& ccl, int slice, int row,
+							 int slice0, int er_base,
+							 Seg_t* restrict& RLC,
+							 int32_t* restrict& ERA,
+							 Seg_t* restrict& ER, Seg_t& len) {
+    const bool outside = slice < slice0 || row < 0 || row >= ccl.height;
+    const RowView<Seg_t> view = outside ? ccl.arena.Empty() : ccl.arena.Row(slice, row, er_base);
+    RLC = view.RLC;
+    ERA = view.ERA;
+    ER = view.ER;
+    len = view.len;
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+void LSL3D<RLE, Unify, FC, RL, LabelsSolver>::NumberRows(CCL& ccl, int slice, int slice0) {
+    assert(slice0 == 0 && "ERA-less labels are numbered from the first slice of the volume");
+
+    int32_t* restrict row_label = ccl.row_label.data() + (size_t)slice * ccl.height;
+    if (slice == slice0) {
+	row_label[0] = 1;
+    }
+    // row_label[height] is the first label of the next slice
+    for (int row = 0; row < ccl.height; row++) {
+	row_label[row + 1] = row_label[row] + ccl.arena.Length(slice, row) / 2;
+    }
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+int32_t LSL3D<RLE, Unify, FC, RL, LabelsSolver>::RowLabel(const CCL& ccl, int slice, int row,
+							   int slice0) {
+    const bool outside = slice < slice0 || row < 0 || row >= ccl.height;
+    return outside ? 0 : ccl.row_label[(size_t)slice * ccl.height + row];
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+void LSL3D<RLE, Unify, FC, RL, LabelsSolver>::Alloc(CCL& ccl, int width, int height, int depth) {
+    assert(width < rle::rle_sentinel<Seg_t>() && "Rows too wide for Seg_t");
+
+    ccl.width = width;
+    ccl.height = height;
+    ccl.depth = depth;
+
+    ccl.arena.Alloc(width, height, depth, Conf::ER || Conf::CompactER, 2, 2, Unify::Conf::ERA,
+		    Conf::CompactER);
+    if (!Unify::Conf::ERA) {
+	ccl.row_label.resize((size_t)height * depth + 1);
+    }
+
+    const size_t labels = MaxLabels(width, height, depth);
+    if (labels > ccl.label_capacity) {
+	ccl.ET.Alloc(labels);
+	ccl.label_capacity = labels;
+    }
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+void LSL3D<RLE, Unify, FC, RL, LabelsSolver>::Free(CCL& ccl) {
+    if (ccl.arena.base == nullptr) {
+	return;
+    }
+    ccl.arena.Free();
+    ccl.occupancy.Clear();
+    ccl.row_label.clear();
+    ccl.row_label.shrink_to_fit();
+    ccl.ET.Dealloc();
+    ccl.label_capacity = 0;
+}
+
+template <typename RLE, typename Unify, typename FeatureComputation, typename Relabeling,
+	  typename LabelsSolver>
+template <typename ConfFeatures, uint8_t FG>
+uint32_t LSL3D<RLE, Unify, FeatureComputation, Relabeling, LabelsSolver>::Run(CCL& ccl,
+									      Features& features) {
+    ccl.ET.Setup();
+    ccl.occupancy.Reset(ccl.height, ccl.depth);
+
+    LabelSlices<ConfFeatures, FG>(ccl, ccl.ET, features, 0, ccl.depth);
+
+    uint32_t label_count = ccl.ET.Flatten();
+
+    FeatureComputation::template CalcFeatures<LabelsSolver, ConfFeatures>(
+	ccl.arena, ccl.ET, features, label_count, &ccl.occupancy);
+
+    Relabeling::Relabel(ccl);
+
+    return label_count;
+}
+
+template <typename RLE, typename Unify, typename FeatureComputation, typename Relabeling,
+	  typename LabelsSolver>
+template <typename ConfFeatures, uint8_t FG>
+void LSL3D<RLE, Unify, FeatureComputation, Relabeling, LabelsSolver>::LabelSlices(
+    CCL& ccl, LabelsSolver& ET, Features& features, int slice0, int slice1, int er_base) {
+
+    for (int slice = slice0; slice < slice1; slice++) {
+	EncodeSlice<FG>(ccl, slice, er_base);
+	UnifySlice<ConfFeatures>(ccl, ET, features, slice, slice0, er_base);
+    }
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+template <uint8_t FG>
+void LSL3D<RLE, Unify, FC, RL, LabelsSolver>::EncodeSlice(CCL& ccl, int slice, int er_base) {
+    const int width = ccl.width;
+
+    for (int row = 0; row < ccl.height; row++) {
+	const Pixel_t* restrict line = ccl.image.template ptr<Pixel_t>(slice, row);
+	Seg_t* restrict RLCi = ccl.arena.RLC(slice, row);
+	Seg_t* restrict ERi = ccl.arena.ER(slice, row, er_base);
+
+	Seg_t len = RLE::template Line<FG>(line, RLCi, ERi, width);
+	if (Conf::ER) {
+	    // Borders read by lsl_combine_z
+	    ERi[-1] = 0;
+	    ERi[width] = ERi[width - 1];
+	}
+	if (Conf::CompactER) {
+	    rle::CompactER<Seg_t>::Build(RLCi, len, ERi, width);
+	}
+	ccl.arena.Length(slice, row) = len;
+	ccl.occupancy.AddRow(slice, row, RLCi, len);
+    }
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+template <typename ConfFeatures>
+void LSL3D<RLE, Unify, FC, RL, LabelsSolver>::UnifySlice(CCL& ccl, LabelsSolver& ET,
+							  Features& features, int slice,
+							  int slice0, int er_base) {
+    const int width = ccl.width;
+    const int height = ccl.height;
+
+    using Conn = unify::connectivity_t<Unify>;
+    AdjState<Seg_t, int32_t> state;
+    // Combined rows of the ER planes in use (see RLEArena)
+    state.z_RLC = ccl.arena.ZRLC(er_base / ccl.arena.er_ring);
+    state.z_ERA = ccl.arena.ZERA(er_base / ccl.arena.er_ring);
+
+    if (!Unify::Conf::ERA) {
+	NumberRows(ccl, slice, slice0);
+    }
+
+    // Unification of the non-empty rows
+    for (int row = ccl.occupancy.NextOccupiedRow(slice, 0); row < height;
+	 row = ccl.occupancy.NextOccupiedRow(slice, row + 1)) {
+
+	Neighbour(ccl, slice, row - 1, slice0, er_base,
+		  state.RLC0, state.ERA0, state.ER0, state.len0);
+	if (Conn::Row1) {
+	    Neighbour(ccl, slice - 1, row - 1, slice0, er_base,
+		      state.RLC1, state.ERA1, state.ER1, state.len1);
+	}
+	Neighbour(ccl, slice - 1, row, slice0, er_base,
+		  state.RLC2, state.ERA2, state.ER2, state.len2);
+	if (Conn::Row3) {
+	    Neighbour(ccl, slice - 1, row + 1, slice0, er_base,
+		      state.RLC3, state.ERA3, state.ER3, state.len3);
+	}
+	if (!Unify::Conf::ERA) {
+	    state.uf_offset = RowLabel(ccl, slice, row, slice0);
+	    state.uf_offset0 = RowLabel(ccl, slice, row - 1, slice0);
+	    state.uf_offset1 = RowLabel(ccl, slice - 1, row - 1, slice0);
+	    state.uf_offset2 = RowLabel(ccl, slice - 1, row, slice0);
+	    state.uf_offset3 = RowLabel(ccl, slice - 1, row + 1, slice0);
+	}
+
+	const RowView<Seg_t> cur = ccl.arena.Row(slice, row, er_base);
+	Unify::template Unify<LabelsSolver, ConfFeatures>(
+	    state, cur.RLC, cur.ERA, cur.len, ET, features, row, slice, width);
+    }
+    solver::end_slice(ET);
+}
+
+}
+
+#endif // CCL_ALGOS_3D_LSL3D_CCL_HPP
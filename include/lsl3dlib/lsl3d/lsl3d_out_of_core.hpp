@@ -0,0 +1,435 @@
+#ifndef CCL_ALGOS_3D_LSL3D_OUT_OF_CORE_HPP
+#define CCL_ALGOS_3D_LSL3D_OUT_OF_CORE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cassert>
+#include <algorithm>
+#include <vector>
+#include <type_traits>
+
+#include <simdhelpers/restrict.hpp>
+
+#include <lsl3dlib/utility.hpp>
+#include <lsl3dlib/rle/rle.hpp>
+#include <lsl3dlib/lsl3d/arena.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_ccl.hpp>
+#include <lsl3dlib/lsl3d/unification_common.hpp>
+
+namespace algo {
+
+// Out-of-core LSL 3D, for volumes bigger than the memory. The input is a raw file (width x height
+// x depth uint8_t, slice after slice), read by slabs of `slab` slices; the size of the slabs is
+// set by a memory budget.
+// 1. Each slab is run-length encoded and unified with its own LabelsSolver, the last slice of the
+//    previous slab (the boundary) being its first neighbour. The components of the boundary are
+//    the labels [1, live] of the slab: they are their own roots, and the smallest.
+// 2. The slab is flattened. Each component of the slab gets a global id, the boundary ones keep
+//    the id of their component in the previous slab; boundary components merged by the slab are
+//    merged in the global forest (one entry per component per slab, the only state growing with
+//    the volume).
+// 3. The RLC and ERA (global ids) of the slab are spilled to a file: the length of each row, then
+//    its RLC and ERA when it is not empty.
+// 4. The global forest is flattened, and the spill file is replayed slice by slice to write the
+//    labels (int32_t, same layout as the input) to the output file.
+//
+// Memory: the slab of input, slab + 1 slices of RLC/ERA, the solver of a slab, one slice of
+// labels and the global forest. Labels are those of LSL3D::Run (components in raster order of
+// their first pixel). No features are computed.
+template <typename RLE, typename Unify, typename LabelsSolver>
+struct LSL3D_OutOfCore {
+
+    struct Conf {
+	using Seg_t = typename RLE::Conf::Seg_t;
+	using Label_t = int32_t;
+
+	static constexpr bool ER = RLE::Conf::ER;
+	// ER rows built from the RLC rows (rle::CompactER)
+	static constexpr bool CompactER = unify::compact_er_v<Unify>;
+    };
+
+    using Seg_t = typename Conf::Seg_t;
+
+    static_assert(!Unify::Conf::Double, "Double line unifications are not supported");
+    static_assert(!Unify::Conf::ER || RLE::Conf::ER, "ER unification requires an ER encoder");
+    static_assert(!Conf::CompactER || !RLE::Conf::ER,
+		  "Compact ER rows replace the ER of the encoder");
+    static_assert(Unify::Conf::ERA, "ERA-less unifications are only supported by LSL3D");
+    static_assert(std::is_same_v<rle::pixel_t<RLE>, uint8_t>, "The input file holds uint8_t voxels");
+
+    struct CCL {
+	// Slice z is in slot z % ring: the slab and the boundary
+	RLEArena<Seg_t> arena;
+	int ring = 0;
+
+	LabelsSolver ET; // Of the current slab
+	size_t label_capacity = 0;
+
+	std::vector<uint8_t> input; // Slab of input rows, with the RLE margins
+	size_t input_pitch = 0;
+	std::vector<int32_t> slice_labels; // Output slice
+
+	std::vector<int32_t> global;   // Global forest, lowest root wins
+	std::vector<int32_t> gid;      // Component of the slab -> global id
+	std::vector<int32_t> boundary; // Boundary label -> global id
+	std::vector<int32_t> remap;    // Component of the slab -> boundary label
+	std::vector<int32_t> row_ids;  // Global ids of a spilled row
+
+	int slab = 0; // Slices per slab
+	int width = 0;
+	int height = 0;
+	int depth = 0;
+    };
+
+    // Labels of a slab of `slices` slices + its boundary
+    static inline size_t MaxLabels(int width, int height, int slices) {
+	return unify::max_labels<Unify>(width, height, slices + 1);
+    }
+
+    // Bytes used per slice of a slab (input, RLC, ERA, Lengths and solver)
+    static inline size_t SliceBytes(int width, int height);
+
+    // Slabs of budget / SliceBytes() slices (at least one). Buffers only grow.
+    static void Alloc(CCL& ccl, int width, int height, int depth, size_t budget);
+    static void Free(CCL& ccl);
+
+    // Labels `input` into `output`. The spill file must be open for reading and writing, a
+    // temporary file is used when it is nullptr. Returns the number of labels (background
+    // included), 0 on I/O error.
+    template <uint8_t FG = 1>
+    static uint32_t Run(CCL& ccl, std::FILE* input, std::FILE* output,
+			std::FILE* spill = nullptr);
+
+    // Reads the slices [slice0, slice1) into ccl.input
+    static bool ReadSlab(CCL& ccl, std::FILE* input, int slice0, int slice1);
+
+    // 1-3 for the slab [slice0, slice1)
+    template <uint8_t FG>
+    static void LabelSlab(CCL& ccl, int slice0, int slice1);
+    static bool SpillSlab(CCL& ccl, std::FILE* spill, int slice0, int slice1);
+
+    // 4. Replay of the spill file
+    static bool WriteLabels(CCL& ccl, std::FILE* spill, std::FILE* output);
+
+    static inline void Neighbour(CCL& ccl, int slice, int row, Seg_t* restrict& RLC,
+				 int32_t* restrict& ERA, Seg_t* restrict& ER, Seg_t& len);
+
+    static inline int32_t NewGlobal(CCL& ccl);
+    static inline int32_t FindGlobal(CCL& ccl, int32_t id);
+    static inline void UnionGlobal(CCL& ccl, int32_t id0, int32_t id1);
+    static inline uint32_t FlattenGlobal(CCL& ccl);
+};
+
+
+template <typename RLE, typename Unify, typename LabelsSolver>
+size_t LSL3D_OutOfCore<RLE, Unify, LabelsSolver>::SliceBytes(int width, int height) {
+    const size_t input = calc_stride(width + rle::RLE_IMG_EXTRA_SPACE, RLEArena<Seg_t>::ALIGNMENT);
+    const size_t rows = RLEArena<Seg_t>::RLCPitch(width) * sizeof(Seg_t) +
+	RLEArena<Seg_t>::ERAPitch(width) * sizeof(int32_t) + sizeof(Seg_t) + input;
+    return (size_t)height * rows + MaxLabels(width, height, 1) / 2 * sizeof(int32_t);
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver>
+void LSL3D_OutOfCore<RLE, Unify, LabelsSolver>::Alloc(CCL& ccl, int width, int height,
+						       int depth, size_t budget) {
+    assert(width < rle::rle_sentinel<Seg_t>() && "Rows too wide for Seg_t");
+
+    ccl.width = width;
+    ccl.height = height;
+    ccl.depth = depth;
+
+    const size_t slices = budget / SliceBytes(width, height);
+    ccl.slab = (int)std::max<size_t>(1, std::min<size_t>(slices, std::max(1, depth)));
+    // Even: the ER planes (slot % 2) alternate across the wrap of the ring
+    ccl.ring = (ccl.slab + 2) & ~1;
+
+    ccl.arena.Alloc(width, height, ccl.ring, Conf::ER || Conf::CompactER, 2, 2, true,
+		    Conf::CompactER);
+
+    const size_t labels = MaxLabels(width, height, ccl.slab);
+    if (labels > ccl.label_capacity) {
+	ccl.ET.Alloc(labels);
+	ccl.label_capacity = labels;
+    }
+
+    ccl.input_pitch = calc_stride(width + rle::RLE_IMG_EXTRA_SPACE, RLEArena<Seg_t>::ALIGNMENT);
+    ccl.input.assign((size_t)ccl.slab * height * ccl.input_pitch, 0);
+    ccl.slice_labels.resize((size_t)width * height);
+    ccl.row_ids.resize(width / 2 + 2);
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver>
+void LSL3D_OutOfCore<RLE, Unify, LabelsSolver>::Free(CCL& ccl) {
+    if (ccl.arena.base == nullptr) {
+	return;
+    }
+    ccl.arena.Free();
+    ccl.ET.Dealloc();
+    ccl.label_capacity = 0;
+
+    for (std::vector<int32_t>* buffer : {&ccl.slice_labels, &ccl.global, &ccl.gid, &ccl.boundary,
+					 &ccl.remap, &ccl.row_ids}) {
+	std::vector<int32_t>().swap(*buffer);
+    }
+    std::vector<uint8_t>().swap(ccl.input);
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver>
+template <uint8_t FG>
+uint32_t LSL3D_OutOfCore<RLE, Unify, LabelsSolver>::Run(CCL& ccl, std::FILE* input,
+							 std::FILE* output, std::FILE* spill) {
+    std::FILE* temporary = spill == nullptr ? std::tmpfile() : nullptr;
+    if (spill == nullptr) {
+	spill = temporary;
+    }
+
+    ccl.global.assign(1, 0);
+    ccl.boundary.assign(1, 0);
+
+    bool ok = spill != nullptr;
+    for (int slice0 = 0; ok && slice0 < ccl.depth; slice0 += ccl.slab) {
+	const int slice1 = std::min(ccl.depth, slice0 + ccl.slab);
+	ok = ReadSlab(ccl, input, slice0, slice1);
+	if (ok) {
+	    LabelSlab<FG>(ccl, slice0, slice1);
+	    ok = SpillSlab(ccl, spill, slice0, slice1);
+	}
+    }
+
+    uint32_t label_count = 0;
+    if (ok && std::fflush(spill) == 0 && std::fseek(spill, 0, SEEK_SET) == 0) {
+	label_count = FlattenGlobal(ccl);
+	if (!WriteLabels(ccl, spill, output)) {
+	    label_count = 0;
+	}
+    }
+
+    if (temporary != nullptr) {
+	std::fclose(temporary);
+    }
+    return label_count;
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver>
+bool LSL3D_OutOfCore<RLE, Unify, LabelsSolver>::ReadSlab(CCL& ccl, std::FILE* input, int slice0,
+							  int slice1) {
+    const size_t width = ccl.width;
+    for (int slice = slice0; slice < slice1; slice++) {
+	for (int row = 0; row < ccl.height; row++) {
+	    uint8_t* line = ccl.input.data() +
+		((size_t)(slice - slice0) * ccl.height + row) * ccl.input_pitch +
+		rle::RLE_IMG_MARGIN_BEFORE;
+	    if (std::fread(line, 1, width, input) != width) {
+		return false;
+	    }
+	}
+    }
+    return true;
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver>
+void LSL3D_OutOfCore<RLE, Unify, LabelsSolver>::Neighbour(CCL& ccl, int slice, int row,
+							   Seg_t* restrict& RLC,
+							   int32_t* restrict& ERA,
+							   Seg_t* restrict& ER, Seg_t& len) {
+    const bool outside = slice < 0 || row < 0 || row >= ccl.height;
+    const RowView<Seg_t> view = outside ? ccl.arena.Empty() : ccl.arena.Row(slice % ccl.ring, row);
+    RLC = view.RLC;
+    ERA = view.ERA;
+    ER = view.ER;
+    len = view.len;
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver>
+template <uint8_t FG>
+void LSL3D_OutOfCore<RLE, Unify, LabelsSolver>::LabelSlab(CCL& ccl, int slice0, int slice1) {
+    const int width = ccl.width;
+    const int height = ccl.height;
+    const int32_t live = (int32_t)ccl.boundary.size() - 1;
+
+    LabelsSolver& ET = ccl.ET;
+    ET.Setup();
+    for (int32_t label = 1; label <= live; label++) {
+	ET.NewLabel();
+    }
+
+    AdjState<Seg_t, int32_t> state;
+    state.z_RLC = ccl.arena.ZRLC(0);
+    state.z_ERA = ccl.arena.ZERA(0);
+    Features none;
+    for (int slice = slice0; slice < slice1; slice++) {
+	const int slot = slice % ccl.ring;
+
+	for (int row = 0; row < height; row++) {
+	    const uint8_t* restrict line = ccl.input.data() +
+		((size_t)(slice - slice0) * height + row) * ccl.input_pitch +
+		rle::RLE_IMG_MARGIN_BEFORE;
+	    Seg_t* restrict RLCi = ccl.arena.RLC(slot, row);
+	    Seg_t* restrict ERi = ccl.arena.ER(slot, row);
+
+	    Seg_t len = RLE::template Line<FG>(line, RLCi, ERi, width);
+	    if (Conf::ER) {
+		// Borders read by lsl_combine_z
+		ERi[-1] = 0;
+		ERi[width] = ERi[width - 1];
+	    }
+	    if (Conf::CompactER) {
+		rle::CompactER<Seg_t>::Build(RLCi, len, ERi, width);
+	    }
+	    ccl.arena.Length(slot, row) = len;
+	}
+
+	for (int row = 0; row < height; row++) {
+	    const RowView<Seg_t> cur = ccl.arena.Row(slot, row);
+	    if (cur.len == 0) {
+		continue;
+	    }
+	    Neighbour(ccl, slice, row - 1, state.RLC0, state.ERA0, state.ER0, state.len0);
+	    Neighbour(ccl, slice - 1, row - 1, state.RLC1, state.ERA1, state.ER1, state.len1);
+	    Neighbour(ccl, slice - 1, row, state.RLC2, state.ERA2, state.ER2, state.len2);
+	    Neighbour(ccl, slice - 1, row + 1, state.RLC3, state.ERA3, state.ER3, state.len3);
+
+	    Unify::template Unify<LabelsSolver, ConfFeatures3DNone>(
+		state, cur.RLC, cur.ERA, cur.len, ET, none, row, slice, width);
+	}
+	solver::end_slice(ET);
+    }
+
+    // Components of the slab: the boundary ones are the first (smallest roots)
+    const int32_t count = ET.Flatten();
+    ccl.gid.assign(count, 0);
+    for (int32_t label = 1; label <= live; label++) {
+	int32_t& id = ccl.gid[ET.GetLabel(label)];
+	if (id == 0) {
+	    id = ccl.boundary[label];
+	} else {
+	    UnionGlobal(ccl, id, ccl.boundary[label]);
+	}
+    }
+    for (int32_t c = 1; c < count; c++) {
+	if (ccl.gid[c] == 0) {
+	    ccl.gid[c] = NewGlobal(ccl);
+	}
+    }
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver>
+bool LSL3D_OutOfCore<RLE, Unify, LabelsSolver>::SpillSlab(CCL& ccl, std::FILE* spill,
+							   int slice0, int slice1) {
+    LabelsSolver& ET = ccl.ET;
+    int32_t* restrict ids = ccl.row_ids.data();
+
+    // The last slice becomes the boundary of the next slab
+    ccl.remap.assign(ccl.gid.size(), 0);
+    ccl.boundary.assign(1, 0);
+
+    for (int slice = slice0; slice < slice1; slice++) {
+	const bool last = slice == slice1 - 1;
+	for (int row = 0; row < ccl.height; row++) {
+	    const RowView<Seg_t> view = ccl.arena.Row(slice % ccl.ring, row);
+	    int32_t* restrict ERAi = view.ERA;
+	    const int segments = view.len / 2;
+
+	    for (int i = 0; i < segments; i++) {
+		const int32_t c = ET.GetLabel(ERAi[i]);
+		ids[i] = ccl.gid[c];
+		if (last) {
+		    int32_t& label = ccl.remap[c];
+		    if (label == 0) {
+			label = (int32_t)ccl.boundary.size();
+			ccl.boundary.push_back(ids[i]);
+		    }
+		    ERAi[i] = label;
+		}
+	    }
+
+	    if (std::fwrite(&view.len, sizeof(Seg_t), 1, spill) != 1) {
+		return false;
+	    }
+	    if (view.len > 0 &&
+		(std::fwrite(view.RLC, sizeof(Seg_t), view.len, spill) != (size_t)view.len ||
+		 std::fwrite(ids, sizeof(int32_t), segments, spill) != (size_t)segments)) {
+		return false;
+	    }
+	}
+    }
+    return true;
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver>
+bool LSL3D_OutOfCore<RLE, Unify, LabelsSolver>::WriteLabels(CCL& ccl, std::FILE* spill,
+							     std::FILE* output) {
+    const int width = ccl.width;
+    std::vector<Seg_t> rlc(width + 2);
+    int32_t* restrict ids = ccl.row_ids.data();
+    const int32_t* restrict global = ccl.global.data();
+
+    for (int slice = 0; slice < ccl.depth; slice++) {
+	for (int row = 0; row < ccl.height; row++) {
+	    int32_t* restrict dstrow = ccl.slice_labels.data() + (size_t)row * width;
+	    std::fill(dstrow, dstrow + width, 0);
+
+	    Seg_t len;
+	    if (std::fread(&len, sizeof(Seg_t), 1, spill) != 1) {
+		return false;
+	    }
+	    const int segments = len / 2;
+	    if (len > 0 &&
+		(std::fread(rlc.data(), sizeof(Seg_t), len, spill) != (size_t)len ||
+		 std::fread(ids, sizeof(int32_t), segments, spill) != (size_t)segments)) {
+		return false;
+	    }
+	    for (int i = 0; i < segments; i++) {
+		std::fill(dstrow + rlc[2 * i], dstrow + rlc[2 * i + 1], global[ids[i]]);
+	    }
+	}
+	const size_t pixels = (size_t)width * ccl.height;
+	if (std::fwrite(ccl.slice_labels.data(), sizeof(int32_t), pixels, output) != pixels) {
+	    return false;
+	}
+    }
+    return true;
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver>
+int32_t LSL3D_OutOfCore<RLE, Unify, LabelsSolver>::NewGlobal(CCL& ccl) {
+    const int32_t id = (int32_t)ccl.global.size();
+    ccl.global.push_back(id);
+    return id;
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver>
+int32_t LSL3D_OutOfCore<RLE, Unify, LabelsSolver>::FindGlobal(CCL& ccl, int32_t id) {
+    int32_t* restrict global = ccl.global.data();
+    while (global[id] < id) {
+	global[id] = global[global[id]];
+	id = global[id];
+    }
+    return id;
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver>
+void LSL3D_OutOfCore<RLE, Unify, LabelsSolver>::UnionGlobal(CCL& ccl, int32_t id0, int32_t id1) {
+    id0 = FindGlobal(ccl, id0);
+    id1 = FindGlobal(ccl, id1);
+    if (id0 < id1) {
+	std::swap(id0, id1);
+    }
+    ccl.global[id0] = id1;
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver>
+uint32_t LSL3D_OutOfCore<RLE, Unify, LabelsSolver>::FlattenGlobal(CCL& ccl) {
+    int32_t* restrict global = ccl.global.data();
+    const int32_t n = (int32_t)ccl.global.size();
+    int32_t k = 1;
+    for (int32_t i = 1; i < n; i++) {
+	global[i] = global[i] < i ? global[global[i]] : k++;
+    }
+    return k;
+}
+
+}
+
+#endif // CCL_ALGOS_3D_LSL3D_OUT_OF_CORE_HPP
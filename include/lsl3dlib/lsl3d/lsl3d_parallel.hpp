@@ -0,0 +1,495 @@
+#ifndef CCL_ALGOS_3D_LSL3D_PARALLEL_HPP
+#define CCL_ALGOS_3D_LSL3D_PARALLEL_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+
+#include <simdhelpers/restrict.hpp>
+
+#include <lsl3dlib/parallel.hpp>
+#include <lsl3dlib/features.hpp>
+#include <lsl3dlib/lsl/lsl_utils.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_ccl.hpp>
+
+namespace algo {
+
+// Slab parallel LSL 3D: the volume is split along z in SLABS_PER_THREAD slabs per thread, of
+// about the same cost. The cost of a slice is estimated before the RLE from a sample of its
+// pixels (count_foreground): dense slices get thinner slabs.
+// The slabs and their borders are tasks of a work stealing scheduler (parallel::WorkStealing):
+// 1. Slab task k: RLE + unification of the slab (LSL3D::LabelSlices) with its own LabelsSolver,
+//    as if the slab was a whole volume, then Flatten. ER rows use the planes of the thread.
+// 2. Border task k, pushed once slabs k - 1 and k are done: the equivalences between the first
+//    slice of slab k and the last slice of slab k - 1 (rows row - 1, row and row + 1, as
+//    selected by the connectivity of Unify) are recorded as pairs of labels of the two slabs.
+// 3. Slab k owns the global labels [slab_offset[k] + 1, slab_offset[k + 1]], created in ccl.ET
+//    by one thread per slab (NewLabels). The borders are merged in ccl.ET by a tree reduction of
+//    ceil(log2(slabs)) levels: at the level of width w, the groups of slabs [g, g + w) and
+//    [g + w, g + 2w) (g multiple of 2w) are merged across border g + w (MergeGroups), all the
+//    groups of a level in parallel. The groups of a level own
+//    disjoint ranges of labels: their unions never touch the same entries of ccl.ET. The pairs of
+//    the outer borders of a merged group are then replaced by their roots, so that the next
+//    levels find them in one step. The labels that stop being roots are recorded per border.
+// 4. ccl.ET is flattened in parallel: the labels recorded by the reduction and their roots are
+//    sorted (Unions, sequential, proportional to the number of unions), and the final label of a
+//    root is its label minus the number of unions below it. The final labels of the labels of
+//    slab k are then set by slab task k (FlattenSlab), which also rewrites the ERA of the slab
+//    with global labels (Globalize). Features are computed and the slabs relabeled.
+//
+// The features are sequential: their cost is proportional to the number of labels, not to the
+// volume.
+// The LabelsSolver must only access the entries of the labels given to FindRoot and UpdateTable
+// and of their ancestors (true for the table based solvers): step 3 shares ccl.ET between threads.
+// It must provide NewLabels(first, last), used by step 3 instead of NewLabel(), and
+// SetLabel(e, label), used by step 4 instead of Flatten() (see solvers/union_find.hpp).
+// Unification runs without features: FeatureComputation_OTF is not supported, features are only
+// computed by FeatureComputation.
+template <typename RLE, typename Unify, typename FeatureComputation, typename Relabeling,
+	  typename LabelsSolver>
+struct LSL3D_Parallel {
+
+    using LSL = LSL3D<RLE, Unify, FeatureComputation, Relabeling, LabelsSolver>;
+    using Conf = typename LSL::Conf;
+    using Seg_t = typename LSL::Seg_t;
+    using Conn = unify::connectivity_t<Unify>;
+
+    static_assert(Unify::Conf::ERA, "ERA-less unifications are only supported by LSL3D");
+    static_assert(std::is_same_v<rle::pixel_t<RLE>, uint8_t>, "Slab costs are sampled on uint8_t rows");
+
+    static constexpr int SLABS_PER_THREAD = 4;
+    // Sampling of the slices for the cost estimate (1 pixel out of SAMPLE_STEP^2)
+    static constexpr int SAMPLE_STEP = 4;
+    // A foreground pixel costs about FOREGROUND_COST background pixels (RLE, unification and
+    // relabeling)
+    static constexpr int FOREGROUND_COST = 4;
+
+    struct CCL : LSL::CCL {
+	int thread_count = 0;
+	int slab_count = 0;
+	std::vector<int> slab_begin; // First slice of each slab, slab_begin[slab_count] = depth
+	std::vector<uint32_t> slab_offset; // Global label = slab_offset[k] + label in slab k
+	std::vector<LabelsSolver> slab_ET;
+	std::vector<size_t> slab_capacity;
+	std::vector<int64_t> slice_cost;
+	// Equivalences across the border between slab k - 1 and slab k: (label in k - 1, label in k)
+	std::vector<std::vector<std::pair<int32_t, int32_t>>> border_pairs;
+	// Global labels that stopped being roots in the merge across border k
+	std::vector<std::vector<int32_t>> border_unions;
+	// (label, final label of its root) of all the border_unions, sorted by label
+	std::vector<std::pair<int32_t, int32_t>> unions;
+    };
+
+    // Size of the features (see LSL3D::Run)
+    static inline size_t MaxLabels(int width, int height, int depth) {
+	return LSL::MaxLabels(width, height, depth);
+    }
+
+    // min(threads * SLABS_PER_THREAD, depth) slabs. As for LSL3D::Alloc, buffers only grow.
+    static void Alloc(CCL& ccl, int width, int height, int depth,
+		      int threads = parallel::hardware_threads());
+    static void Free(CCL& ccl);
+
+    // Same as LSL3D::Run
+    template <typename ConfFeatures, uint8_t FG = 1>
+    static uint32_t Run(CCL& ccl, Features& features);
+
+    // Cost estimate of each slice, then slabs of about the same cost
+    static void Split(CCL& ccl);
+
+    // Slab task k on `thread`
+    template <uint8_t FG>
+    static void LabelSlab(CCL& ccl, Features& features, int k, int thread);
+
+    // Rewrite the ERA of slab k with global labels
+    static void Globalize(CCL& ccl, int k);
+
+    // Border task: pairs of labels between the first slice of slab k (k > 0) and the last slice
+    // of slab k - 1
+    static void MergeBorder(CCL& ccl, int k);
+
+    // Tree reduction node: merge the groups of slabs [g, g + w) and [g + w, min(g + 2w, slabs))
+    // across border g + w. Pairs have global labels.
+    static void MergeGroups(CCL& ccl, int g, int w);
+
+    // Sorted ccl.unions after the reduction, returns the number of labels (background included)
+    static uint32_t Unions(CCL& ccl);
+
+    // Final labels of the global labels of slab k in ccl.ET
+    static void FlattenSlab(CCL& ccl, int k);
+
+    // Pairs (label in slab k - 1, label in slab k) of the segments of cur touching those of prev.
+    // Not Reduce_FSM::ReduceLine, which merges the labels of one solver: the two rows have their
+    // own solvers, and the merges wait for the reduction. Diag: segments touching by a corner are
+    // neighbours.
+    template <bool Diag>
+    static inline void BorderPairs(const RowView<Seg_t>& cur, const RowView<Seg_t>& prev,
+				   LabelsSolver& ET_cur, LabelsSolver& ET_prev,
+				   std::vector<std::pair<int32_t, int32_t>>& pairs);
+};
+
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+void LSL3D_Parallel<RLE, Unify, FC, RL, LabelsSolver>::Alloc(CCL& ccl, int width, int height,
+							     int depth, int threads) {
+    assert(width < rle::rle_sentinel<Seg_t>() && "Rows too wide for Seg_t");
+
+    ccl.width = width;
+    ccl.height = height;
+    ccl.depth = depth;
+
+    threads = std::max(1, std::min(threads, depth));
+    const int slabs = std::max(1, std::min(threads * SLABS_PER_THREAD, depth));
+    if (slabs != ccl.slab_count) {
+	for (int k = 0; k < ccl.slab_count; k++) {
+	    if (ccl.slab_capacity[k] > 0) {
+		ccl.slab_ET[k].Dealloc();
+	    }
+	}
+	ccl.slab_ET = std::vector<LabelsSolver>(slabs);
+	ccl.slab_capacity.assign(slabs, 0);
+	ccl.slab_count = slabs;
+    }
+    ccl.thread_count = threads;
+
+    ccl.slab_begin.resize(slabs + 1);
+    ccl.slab_offset.resize(slabs + 1);
+    ccl.slice_cost.resize(depth);
+    ccl.border_pairs.resize(slabs);
+    ccl.border_unions.resize(slabs);
+
+    // Two ER planes and a pair of combined rows per thread: a slab is labeled by a single thread
+    ccl.arena.Alloc(width, height, depth, Conf::ER || Conf::CompactER, 2 * threads, 2, true,
+		    Conf::CompactER, threads);
+
+    // Bound of the sum of the labels of the slabs, whatever the split
+    const size_t total = MaxLabels(width, height, depth) + (size_t)slabs * (width + 1) + 1;
+    if (total > ccl.label_capacity) {
+	ccl.ET.Alloc(total);
+	ccl.label_capacity = total;
+    }
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+void LSL3D_Parallel<RLE, Unify, FC, RL, LabelsSolver>::Free(CCL& ccl) {
+    for (int k = 0; k < ccl.slab_count; k++) {
+	if (ccl.slab_capacity[k] > 0) {
+	    ccl.slab_ET[k].Dealloc();
+	}
+    }
+    ccl.slab_ET.clear();
+    ccl.slab_capacity.clear();
+    ccl.border_pairs.clear();
+    ccl.border_unions.clear();
+    ccl.unions.clear();
+    ccl.unions.shrink_to_fit();
+    ccl.slab_count = 0;
+    ccl.thread_count = 0;
+
+    LSL::Free(ccl);
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+void LSL3D_Parallel<RLE, Unify, FC, RL, LabelsSolver>::Split(CCL& ccl) {
+    const int depth = ccl.depth;
+    const int slabs = ccl.slab_count;
+    const int threads = ccl.thread_count;
+
+    parallel::parallel_for(threads, [&](int t) {
+	for (int slice = t; slice < depth; slice += threads) {
+	    int64_t foreground = 0;
+	    for (int row = 0; row < ccl.height; row += SAMPLE_STEP) {
+		const uint8_t* restrict line = ccl.image.template ptr<uint8_t>(slice, row);
+		foreground += count_foreground(line, ccl.width, SAMPLE_STEP);
+	    }
+	    ccl.slice_cost[slice] = (int64_t)ccl.width * ccl.height +
+		FOREGROUND_COST * SAMPLE_STEP * foreground;
+	}
+    });
+
+    int64_t total = 0;
+    for (int slice = 0; slice < depth; slice++) {
+	total += ccl.slice_cost[slice];
+    }
+
+    // Slab k ends when the prefix cost reaches (k + 1) / slabs of the total, each slab keeping at
+    // least one slice
+    ccl.slab_begin[0] = 0;
+    int64_t prefix = 0;
+    int slice = 0;
+    for (int k = 0; k < slabs - 1; k++) {
+	const int64_t target = total * (k + 1) / slabs;
+	do {
+	    prefix += ccl.slice_cost[slice++];
+	} while (prefix < target && depth - slice > slabs - 1 - k);
+	ccl.slab_begin[k + 1] = slice;
+    }
+    ccl.slab_begin[slabs] = depth;
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+template <uint8_t FG>
+void LSL3D_Parallel<RLE, Unify, FC, RL, LabelsSolver>::LabelSlab(CCL& ccl, Features& features,
+								  int k, int thread) {
+    const int slice0 = ccl.slab_begin[k];
+    const int slice1 = ccl.slab_begin[k + 1];
+
+    // Slab sizes change with the split: the solvers only grow
+    const size_t labels = MaxLabels(ccl.width, ccl.height, slice1 - slice0);
+    LabelsSolver& ET = ccl.slab_ET[k];
+    if (labels > ccl.slab_capacity[k]) {
+	ET.Alloc(labels);
+	ccl.slab_capacity[k] = labels;
+    }
+
+    ET.Setup();
+    LSL::template LabelSlices<ConfFeatures3DNone, FG>(ccl, ET, features, slice0, slice1,
+						       2 * thread);
+    ccl.slab_offset[k + 1] = ET.Flatten() - 1; // Background excluded
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+void LSL3D_Parallel<RLE, Unify, FC, RL, LabelsSolver>::Globalize(CCL& ccl, int k) {
+    LabelsSolver& ET = ccl.slab_ET[k];
+    const uint32_t offset = ccl.slab_offset[k];
+
+    for (int slice = ccl.slab_begin[k]; slice < ccl.slab_begin[k + 1]; slice++) {
+	for (int row = ccl.occupancy.NextOccupiedRow(slice, 0); row < ccl.height;
+	     row = ccl.occupancy.NextOccupiedRow(slice, row + 1)) {
+
+	    const RowView<Seg_t> view = ccl.arena.Row(slice, row);
+	    int32_t* restrict ERAi = view.ERA;
+	    for (int i = 0; i < view.len / 2; i++) {
+		ERAi[i] = offset + ET.GetLabel(ERAi[i]);
+	    }
+	}
+    }
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+template <bool Diag>
+void LSL3D_Parallel<RLE, Unify, FC, RL, LabelsSolver>::BorderPairs(
+    const RowView<Seg_t>& cur, const RowView<Seg_t>& prev, LabelsSolver& ET_cur,
+    LabelsSolver& ET_prev, std::vector<std::pair<int32_t, int32_t>>& pairs) {
+
+    // Same walk as the merges of the unifications (for_each_overlap, the rows end with their
+    // sentinels). The labels are those of two solvers: the pairs are recorded, not merged.
+    Seg_t er_b = 1;
+    for (Seg_t er_a = 1; er_a < cur.len; er_a += 2) {
+	for_each_overlap<Diag>(cur.RLC[er_a - 1], cur.RLC[er_a], prev.RLC, er_b, [&](Seg_t er) {
+	    pairs.emplace_back(ET_prev.GetLabel(prev.ERA[er / 2]),
+			       ET_cur.GetLabel(cur.ERA[er_a / 2]));
+	});
+    }
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+void LSL3D_Parallel<RLE, Unify, FC, RL, LabelsSolver>::MergeBorder(CCL& ccl, int k) {
+    const int slice = ccl.slab_begin[k];
+    const int height = ccl.height;
+
+    std::vector<std::pair<int32_t, int32_t>>& pairs = ccl.border_pairs[k];
+    pairs.clear();
+
+    if (!ccl.occupancy.SliceOccupied(slice) || !ccl.occupancy.SliceOccupied(slice - 1)) {
+	return;
+    }
+
+    for (int row = ccl.occupancy.NextOccupiedRow(slice, 0); row < height;
+	 row = ccl.occupancy.NextOccupiedRow(slice, row + 1)) {
+
+	const RowView<Seg_t> cur = ccl.arena.Row(slice, row);
+	if (Conn::Row1 && row > 0) {
+	    BorderPairs<Conn::Diag1>(cur, ccl.arena.Row(slice - 1, row - 1), ccl.slab_ET[k],
+				     ccl.slab_ET[k - 1], pairs);
+	}
+	BorderPairs<Conn::Diag2>(cur, ccl.arena.Row(slice - 1, row), ccl.slab_ET[k],
+				 ccl.slab_ET[k - 1], pairs);
+	if (Conn::Row3 && row + 1 < height) {
+	    BorderPairs<Conn::Diag3>(cur, ccl.arena.Row(slice - 1, row + 1), ccl.slab_ET[k],
+				     ccl.slab_ET[k - 1], pairs);
+	}
+    }
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+void LSL3D_Parallel<RLE, Unify, FC, RL, LabelsSolver>::MergeGroups(CCL& ccl, int g, int w) {
+    const int slabs = ccl.slab_count;
+    const int end = std::min(slabs, g + 2 * w);
+    LabelsSolver& ET = ccl.ET;
+    std::vector<int32_t>& unions = ccl.border_unions[g + w];
+    unions.clear();
+
+    for (const std::pair<int32_t, int32_t>& pair : ccl.border_pairs[g + w]) {
+	int32_t label0 = ET.FindRoot(pair.first);
+	int32_t label1 = ET.FindRoot(pair.second);
+	if (label0 < label1) {
+	    std::swap(label0, label1);
+	}
+	if (label0 != label1) {
+	    ET.UpdateTable(label0, label1);
+	    unions.push_back(label0);
+	}
+    }
+
+    // Outer borders, merged by the next levels. The groups on the other side rewrite the other
+    // label of the pairs.
+    if (g > 0) {
+	for (std::pair<int32_t, int32_t>& pair : ccl.border_pairs[g]) {
+	    pair.second = ET.FindRoot(pair.second);
+	}
+    }
+    if (end < slabs) {
+	for (std::pair<int32_t, int32_t>& pair : ccl.border_pairs[end]) {
+	    pair.first = ET.FindRoot(pair.first);
+	}
+    }
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+uint32_t LSL3D_Parallel<RLE, Unify, FC, RL, LabelsSolver>::Unions(CCL& ccl) {
+    LabelsSolver& ET = ccl.ET;
+    std::vector<std::pair<int32_t, int32_t>>& unions = ccl.unions;
+
+    unions.clear();
+    for (int k = 1; k < ccl.slab_count; k++) {
+	for (int32_t label : ccl.border_unions[k]) {
+	    unions.emplace_back(label, ET.FindRoot(label));
+	}
+    }
+    // A label stops being a root once: the labels are unique
+    std::sort(unions.begin(), unions.end());
+
+    const auto by_label = [](const std::pair<int32_t, int32_t>& u, int32_t label) {
+	return u.first < label;
+    };
+    for (std::pair<int32_t, int32_t>& u : unions) {
+	const int32_t below = (int32_t)(std::lower_bound(unions.begin(), unions.end(), u.second,
+							 by_label) - unions.begin());
+	u.second -= below;
+    }
+    return ccl.slab_offset[ccl.slab_count] + 1 - (uint32_t)unions.size();
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+void LSL3D_Parallel<RLE, Unify, FC, RL, LabelsSolver>::FlattenSlab(CCL& ccl, int k) {
+    LabelsSolver& ET = ccl.ET;
+    const std::vector<std::pair<int32_t, int32_t>>& unions = ccl.unions;
+    const int32_t first = ccl.slab_offset[k] + 1;
+    const int32_t last = ccl.slab_offset[k + 1] + 1;
+
+    const auto by_label = [](const std::pair<int32_t, int32_t>& u, int32_t label) {
+	return u.first < label;
+    };
+    // Unions below the current label
+    size_t u = std::lower_bound(unions.begin(), unions.end(), first, by_label) - unions.begin();
+    for (int32_t label = first; label < last; label++) {
+	if (u < unions.size() && unions[u].first == label) {
+	    ET.SetLabel(label, unions[u].second);
+	    u++;
+	} else {
+	    ET.SetLabel(label, label - (int32_t)u);
+	}
+    }
+}
+
+template <typename RLE, typename Unify, typename FeatureComputation, typename Relabeling,
+	  typename LabelsSolver>
+template <typename ConfFeatures, uint8_t FG>
+uint32_t LSL3D_Parallel<RLE, Unify, FeatureComputation, Relabeling, LabelsSolver>::Run(
+    CCL& ccl, Features& features) {
+
+    const int slabs = ccl.slab_count;
+    const int threads = ccl.thread_count;
+
+    ccl.occupancy.Reset(ccl.height, ccl.depth);
+    Split(ccl);
+
+    // 1-2. Slab tasks [0, slabs), border tasks slabs + k - 1 for k in [1, slabs)
+    std::unique_ptr<std::atomic<int>[]> waiting(new std::atomic<int>[slabs]);
+    for (int k = 1; k < slabs; k++) {
+	waiting[k].store(2, std::memory_order_relaxed);
+    }
+
+    parallel::WorkStealing pool(threads);
+    for (int k = 0; k < slabs; k++) {
+	// Contiguous slabs per thread: neighbour borders are likely to become ready on one thread
+	pool.Push((int)((int64_t)k * threads / slabs), k);
+    }
+    pool.Run([&](int task, int thread) {
+	if (task >= slabs) {
+	    MergeBorder(ccl, task - slabs + 1);
+	    return;
+	}
+	LabelSlab<FG>(ccl, features, task, thread);
+	for (int k = task; k <= task + 1; k++) {
+	    if (k >= 1 && k < slabs && waiting[k].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		pool.Push(thread, slabs + k - 1);
+	    }
+	}
+    });
+
+    // 3. Global labels
+    ccl.slab_offset[0] = 0;
+    for (int k = 0; k < slabs; k++) {
+	ccl.slab_offset[k + 1] += ccl.slab_offset[k];
+    }
+
+    LabelsSolver& ET = ccl.ET;
+    ET.Setup();
+    ET.n = (int32_t)ccl.slab_offset[slabs] + 1;
+
+    parallel::Barrier barrier(threads);
+    parallel::parallel_for(threads, [&](int t) {
+	for (int k = t; k < slabs; k += threads) {
+	    ET.NewLabels(ccl.slab_offset[k] + 1, ccl.slab_offset[k + 1] + 1);
+	    if (k == 0) {
+		continue;
+	    }
+	    for (std::pair<int32_t, int32_t>& pair : ccl.border_pairs[k]) {
+		pair.first += ccl.slab_offset[k - 1];
+		pair.second += ccl.slab_offset[k];
+	    }
+	}
+	for (int w = 1; w < slabs; w *= 2) {
+	    barrier.ArriveAndWait();
+	    for (int g = 2 * w * t; g + w < slabs; g += 2 * w * threads) {
+		MergeGroups(ccl, g, w);
+	    }
+	}
+    });
+    // 4. Flatten, features and relabeling
+    uint32_t label_count = Unions(ccl);
+
+    parallel::WorkStealing globalize(threads);
+    for (int k = 0; k < slabs; k++) {
+	globalize.Push((int)((int64_t)k * threads / slabs), k);
+    }
+    globalize.Run([&](int k, int) {
+	FlattenSlab(ccl, k);
+	Globalize(ccl, k);
+    });
+
+    FeatureComputation::template CalcFeatures<LabelsSolver, ConfFeatures>(
+	ccl.arena, ET, features, label_count, &ccl.occupancy);
+
+    parallel::WorkStealing relabel(threads);
+    for (int k = 0; k < slabs; k++) {
+	relabel.Push((int)((int64_t)k * threads / slabs), k);
+    }
+    relabel.Run([&](int k, int) {
+	Relabeling::Relabel(ccl, ccl.slab_begin[k], ccl.slab_begin[k + 1]);
+    });
+
+    return label_count;
+}
+
+}
+
+#endif // CCL_ALGOS_3D_LSL3D_PARALLEL_HPP
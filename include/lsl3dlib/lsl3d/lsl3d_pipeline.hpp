@@ -0,0 +1,150 @@
+#ifndef CCL_ALGOS_3D_LSL3D_PIPELINE_HPP
+#define CCL_ALGOS_3D_LSL3D_PIPELINE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include <lsl3dlib/parallel.hpp>
+#include <lsl3dlib/features.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_ccl.hpp>
+
+namespace algo {
+
+// Pipelined LSL 3D: the RLE of a slice only depends on the image, only the unification needs the
+// previous slice. Encoder threads run LSL3D::EncodeSlice ahead (slice z by encoder z % encoders)
+// while the calling thread unifies the slices in order with LSL3D::UnifySlice.
+//
+// The ER rows are a ring of `ring` slices: slice z overwrites slice z - ring, which is read until
+// slice z - ring + 1 is unified. An encoder waits (back-pressure) until the encoded slice is at
+// most ring - 2 slices ahead of the unification. RLC, ERA and Lengths are kept for the whole
+// volume (relabeling).
+//
+// Unification is sequential and in order, as in LSL3D: every FeatureComputation (including
+// FeatureComputation_OTF) and every LabelsSolver is supported.
+template <typename RLE, typename Unify, typename FeatureComputation, typename Relabeling,
+	  typename LabelsSolver>
+struct LSL3D_Pipeline {
+
+    using LSL = LSL3D<RLE, Unify, FeatureComputation, Relabeling, LabelsSolver>;
+    using Conf = typename LSL::Conf;
+    using Seg_t = typename LSL::Seg_t;
+
+    static_assert(Unify::Conf::ERA, "ERA-less unifications are only supported by LSL3D");
+
+    struct CCL : LSL::CCL {
+	int encoders = 1;
+	int ring = 4; // Slices of ER rows
+    };
+
+    static inline size_t MaxLabels(int width, int height, int depth) {
+	return LSL::MaxLabels(width, height, depth);
+    }
+
+    // ring >= 2: with 2 slices, encoding and unification can not overlap for ER encoders
+    static void Alloc(CCL& ccl, int width, int height, int depth, int encoders = 1,
+		      int ring = 4);
+    static void Free(CCL& ccl);
+
+    // Same as LSL3D::Run
+    template <typename ConfFeatures, uint8_t FG = 1>
+    static uint32_t Run(CCL& ccl, Features& features);
+};
+
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+void LSL3D_Pipeline<RLE, Unify, FC, RL, LabelsSolver>::Alloc(CCL& ccl, int width, int height,
+							     int depth, int encoders, int ring) {
+    assert(width < rle::rle_sentinel<Seg_t>() && "Rows too wide for Seg_t");
+    assert(ring >= 2 && "The unification needs two slices of ER rows");
+
+    ccl.width = width;
+    ccl.height = height;
+    ccl.depth = depth;
+    ccl.encoders = std::max(1, encoders);
+    ccl.ring = ring;
+
+    ccl.arena.Alloc(width, height, depth, Conf::ER || Conf::CompactER, ring, ring, true,
+		    Conf::CompactER);
+
+    const size_t labels = MaxLabels(width, height, depth);
+    if (labels > ccl.label_capacity) {
+	ccl.ET.Alloc(labels);
+	ccl.label_capacity = labels;
+    }
+}
+
+template <typename RLE, typename Unify, typename FC, typename RL, typename LabelsSolver>
+void LSL3D_Pipeline<RLE, Unify, FC, RL, LabelsSolver>::Free(CCL& ccl) {
+    LSL::Free(ccl);
+}
+
+template <typename RLE, typename Unify, typename FeatureComputation, typename Relabeling,
+	  typename LabelsSolver>
+template <typename ConfFeatures, uint8_t FG>
+uint32_t LSL3D_Pipeline<RLE, Unify, FeatureComputation, Relabeling, LabelsSolver>::Run(
+    CCL& ccl, Features& features) {
+
+    const int depth = ccl.depth;
+    const int encoders = ccl.encoders;
+    const int ahead = ccl.ring - 2; // Slices encoded ahead of the unified ones
+
+    ccl.ET.Setup();
+    ccl.occupancy.Reset(ccl.height, depth);
+
+    std::mutex mutex;
+    std::condition_variable encoded_cv;
+    std::condition_variable unified_cv;
+    std::vector<char> encoded(depth, 0);
+    int unified = 0; // Slices [0, unified) are unified
+
+    parallel::parallel_for(encoders + 1, [&](int t) {
+	if (t == 0) {
+	    // Unification
+	    for (int slice = 0; slice < depth; slice++) {
+		{
+		    std::unique_lock<std::mutex> lock(mutex);
+		    encoded_cv.wait(lock, [&] { return encoded[slice] != 0; });
+		}
+		LSL::template UnifySlice<ConfFeatures>(ccl, ccl.ET, features, slice, 0);
+		{
+		    std::lock_guard<std::mutex> lock(mutex);
+		    unified = slice + 1;
+		}
+		unified_cv.notify_all();
+	    }
+	    return;
+	}
+
+	// Encoder t - 1
+	for (int slice = t - 1; slice < depth; slice += encoders) {
+	    {
+		std::unique_lock<std::mutex> lock(mutex);
+		unified_cv.wait(lock, [&] { return slice - unified <= ahead; });
+	    }
+	    LSL::template EncodeSlice<FG>(ccl, slice);
+	    {
+		std::lock_guard<std::mutex> lock(mutex);
+		encoded[slice] = 1;
+	    }
+	    encoded_cv.notify_one();
+	}
+    });
+
+    uint32_t label_count = ccl.ET.Flatten();
+
+    FeatureComputation::template CalcFeatures<LabelsSolver, ConfFeatures>(
+	ccl.arena, ccl.ET, features, label_count, &ccl.occupancy);
+
+    Relabeling::Relabel(ccl);
+
+    return label_count;
+}
+
+}
+
+#endif // CCL_ALGOS_3D_LSL3D_PIPELINE_HPP
@@ -0,0 +1,353 @@
+#ifndef CCL_ALGOS_3D_LSL3D_STREAM_HPP
+#define CCL_ALGOS_3D_LSL3D_STREAM_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <algorithm>
+#include <vector>
+
+#include <simdhelpers/restrict.hpp>
+
+#include <lsl3dlib/features.hpp>
+#include <lsl3dlib/rle/rle.hpp>
+#include <lsl3dlib/lsl3d/arena.hpp>
+#include <lsl3dlib/lsl3d/lsl3d_ccl.hpp>
+#include <lsl3dlib/lsl3d/unification_common.hpp>
+
+namespace algo {
+
+// Streaming LSL 3D: slices are pushed one at a time (PushSlice), no volume is ever stored.
+// Each slice is run-length encoded and unified with the previous one, exactly as in LSL3D, then:
+// - the features of its segments are added to their components,
+// - the components that do not have any segment in the slice are finished: they are reported to
+//   the caller with their features and forgotten,
+// - the live components (those of the slice) are renumbered [1, live], in the order of their
+//   smallest label: the ERA of the slice, read by the next unification, uses these labels.
+// ET and features only hold the live components and the labels of one slice: memory is
+// O(two slices + live components) and the cost of a push only depends on the slice.
+//
+// No label volume is written: the labels of a component are only final when it is finished.
+// Features use the Features conventions, with slices relative to ccl.base: the slice of a voxel
+// is lo_slice/hi_slice + ccl.base, and its moment Sz + ccl.base * S. Every REBASE_SLICES slices,
+// ccl.base moves to the first slice of the live components (Rebase): streams are unbounded, a
+// component must span less than INT16_MAX slices.
+//
+// Usage:
+//   LSL3D_Stream<rle::STDZ, unify::Unify_SM_Separate, solver::UFPC, ConfFeatures3DAll>::CCL ccl;
+//   Stream::Alloc(ccl, width, height);
+//   for (...) {
+//       Stream::PushSlice(ccl, slice, pitch, [&](const Features& f, int32_t label) { ... });
+//   }
+//   Stream::Finish(ccl, emit);
+template <typename RLE, typename Unify, typename LabelsSolver, typename ConfFeatures>
+struct LSL3D_Stream {
+
+    struct Conf {
+	using Seg_t = typename RLE::Conf::Seg_t;
+	using Label_t = int32_t;
+
+	static constexpr bool ER = RLE::Conf::ER;
+	// ER rows built from the RLC rows (rle::CompactER)
+	static constexpr bool CompactER = unify::compact_er_v<Unify>;
+    };
+
+    using Seg_t = typename Conf::Seg_t;
+
+    static_assert(!Unify::Conf::Double, "Double line unifications are not supported");
+    static_assert(!Unify::Conf::ER || RLE::Conf::ER, "ER unification requires an ER encoder");
+    static_assert(!Conf::CompactER || !RLE::Conf::ER,
+		  "Compact ER rows replace the ER of the encoder");
+    static_assert(Unify::Conf::ERA, "ERA-less unifications are only supported by LSL3D");
+    static_assert(!ConfFeatures::UseMoment || ConfFeatures::UseVolume,
+		  "Rebasing Sz requires the volume of the components");
+
+    // Slices of the features before a rebase
+    static constexpr int64_t REBASE_SLICES = 1 << 14;
+
+    struct CCL {
+	// Slice z is in slot z % 2
+	RLEArena<Seg_t> arena;
+	LabelsSolver ET;
+	size_t label_capacity = 0; // Size of ET and features
+	Features features;
+
+	int32_t live = 0;  // Components [1, live] have segments in the last slice
+	int64_t slice = 0; // Next slice
+	int64_t base = 0;  // Slices of the features are relative to base
+
+	std::vector<int32_t> roots; // Roots of the segments of the last slice
+	std::vector<int32_t> remap; // Root -> live label, 0 when the root has no segment
+
+	int width = 0;
+	int height = 0;
+    };
+
+    // Labels of a slice + live components of the previous one
+    static inline size_t MaxLabels(int width, int height) {
+	return 2 * unify::max_labels<Unify>(width, height, 1);
+    }
+
+    // A new stream starts: buffers only grow (see LSL3D::Alloc)
+    static void Alloc(CCL& ccl, int width, int height);
+    static void Free(CCL& ccl);
+
+    // RLE and unification of the next slice. `slice` is height rows of width pixels
+    // (rle::pixel_t<RLE>), `pitch` bytes apart, with the margins of a row of ccl.image
+    // (rle::RLE_IMG_MARGIN_BEFORE/AFTER).
+    // emit(features, label) is called for each finished component, its features being those of
+    // `label` in `features`. Returns the number of finished components.
+    template <uint8_t FG = 1, typename Emit>
+    static int PushSlice(CCL& ccl, const uint8_t* slice, size_t pitch, Emit emit);
+
+    // End of the stream: every live component is finished. The next push starts a new stream.
+    template <typename Emit>
+    static int Finish(CCL& ccl, Emit emit);
+
+    // Row (slot, row) as a neighbour: the empty row for the rows outside of the slice and before
+    // the first slice
+    static inline void Neighbour(const CCL& ccl, int slot, int row, bool first,
+				 Seg_t* restrict& RLC, int32_t* restrict& ERA,
+				 Seg_t* restrict& ER, Seg_t& len);
+
+    // Features of the components of the slice in `slot`, emit the finished ones and renumber the
+    // live ones
+    template <typename Emit>
+    static int Compact(CCL& ccl, int slot, Emit emit);
+
+    // Moves ccl.base to the first slice of the live components, or to the next slice
+    static void Rebase(CCL& ccl);
+};
+
+
+template <typename RLE, typename Unify, typename LabelsSolver, typename ConfFeatures>
+void LSL3D_Stream<RLE, Unify, LabelsSolver, ConfFeatures>::Alloc(CCL& ccl, int width,
+								  int height) {
+    assert(width < rle::rle_sentinel<Seg_t>() && "Rows too wide for Seg_t");
+
+    ccl.width = width;
+    ccl.height = height;
+    ccl.live = 0;
+    ccl.slice = 0;
+    ccl.base = 0;
+
+    ccl.arena.Alloc(width, height, 2, Conf::ER || Conf::CompactER, 2, 2, true, Conf::CompactER);
+
+    const size_t labels = MaxLabels(width, height);
+    if (labels > ccl.label_capacity) {
+	ccl.ET.Alloc(labels);
+	ccl.label_capacity = labels;
+	ccl.remap.assign(labels, 0);
+    }
+    ccl.features.template Reserve<ConfFeatures>(labels);
+    ccl.roots.reserve(labels / 2);
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver, typename ConfFeatures>
+void LSL3D_Stream<RLE, Unify, LabelsSolver, ConfFeatures>::Free(CCL& ccl) {
+    if (ccl.arena.base == nullptr) {
+	return;
+    }
+    ccl.arena.Free();
+    ccl.ET.Dealloc();
+    ccl.features.template Dealloc<ConfFeatures>();
+    ccl.label_capacity = 0;
+    ccl.roots.clear();
+    ccl.remap.clear();
+    ccl.live = 0;
+    ccl.slice = 0;
+    ccl.base = 0;
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver, typename ConfFeatures>
+void LSL3D_Stream<RLE, Unify, LabelsSolver, ConfFeatures>::Neighbour(const CCL& ccl, int slot,
+								      int row, bool first,
+								      Seg_t* restrict& RLC,
+								      int32_t* restrict& ERA,
+								      Seg_t* restrict& ER,
+								      Seg_t& len) {
+    const bool outside = first || row < 0 || row >= ccl.height;
+    const RowView<Seg_t> view = outside ? ccl.arena.Empty() : ccl.arena.Row(slot, row);
+    RLC = view.RLC;
+    ERA = view.ERA;
+    ER = view.ER;
+    len = view.len;
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver, typename ConfFeatures>
+template <uint8_t FG, typename Emit>
+int LSL3D_Stream<RLE, Unify, LabelsSolver, ConfFeatures>::PushSlice(CCL& ccl,
+								     const uint8_t* slice,
+								     size_t pitch, Emit emit) {
+    const int width = ccl.width;
+    const int height = ccl.height;
+    const int slot = (int)(ccl.slice & 1);
+    const bool first = ccl.slice == 0;
+    // Slices are int16_t in the unifications
+    const int16_t rel_slice = (int16_t)(ccl.slice - ccl.base);
+
+    assert(ccl.slice - ccl.base < INT16_MAX && "A component spans INT16_MAX slices");
+
+    for (int row = 0; row < height; row++) {
+	const rle::pixel_t<RLE>* restrict line =
+	    reinterpret_cast<const rle::pixel_t<RLE>*>(slice + row * pitch);
+	Seg_t* restrict RLCi = ccl.arena.RLC(slot, row);
+	Seg_t* restrict ERi = ccl.arena.ER(slot, row);
+
+	Seg_t len = RLE::template Line<FG>(line, RLCi, ERi, width);
+	if (Conf::ER) {
+	    // Borders read by lsl_combine_z
+	    ERi[-1] = 0;
+	    ERi[width] = ERi[width - 1];
+	}
+	if (Conf::CompactER) {
+	    rle::CompactER<Seg_t>::Build(RLCi, len, ERi, width);
+	}
+	ccl.arena.Length(slot, row) = len;
+    }
+
+    // The live components of the previous slice are their own roots
+    LabelsSolver& ET = ccl.ET;
+    ET.Setup();
+    for (int32_t label = 1; label <= ccl.live; label++) {
+	ET.NewLabel();
+    }
+
+    AdjState<Seg_t, int32_t> state;
+    state.z_RLC = ccl.arena.ZRLC(0);
+    state.z_ERA = ccl.arena.ZERA(0);
+    Features none;
+    for (int row = 0; row < height; row++) {
+	const RowView<Seg_t> cur = ccl.arena.Row(slot, row);
+	if (cur.len == 0) {
+	    continue;
+	}
+
+	Neighbour(ccl, slot, row - 1, false, state.RLC0, state.ERA0, state.ER0, state.len0);
+	Neighbour(ccl, slot ^ 1, row - 1, first, state.RLC1, state.ERA1, state.ER1, state.len1);
+	Neighbour(ccl, slot ^ 1, row, first, state.RLC2, state.ERA2, state.ER2, state.len2);
+	Neighbour(ccl, slot ^ 1, row + 1, first, state.RLC3, state.ERA3, state.ER3, state.len3);
+
+	Unify::template Unify<LabelsSolver, ConfFeatures3DNone>(
+	    state, cur.RLC, cur.ERA, cur.len, ET, none, row, rel_slice, width);
+    }
+
+    const int finished = Compact(ccl, slot, emit);
+    ccl.slice++;
+    if (ccl.slice - ccl.base >= REBASE_SLICES) {
+	Rebase(ccl);
+    }
+    return finished;
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver, typename ConfFeatures>
+template <typename Emit>
+int LSL3D_Stream<RLE, Unify, LabelsSolver, ConfFeatures>::Compact(CCL& ccl, int slot, Emit emit) {
+    LabelsSolver& ET = ccl.ET;
+    Features& features = ccl.features;
+    int32_t* restrict remap = ccl.remap.data();
+    std::vector<int32_t>& roots = ccl.roots;
+    const int32_t live = ccl.live;
+    const uint16_t slice = (uint16_t)(ccl.slice - ccl.base);
+
+    // Live components merged by the slice. Roots are smallest labels: the root of a live label is
+    // live, and its features have not been moved yet.
+    for (int32_t label = 1; label <= live; label++) {
+	const int32_t root = ET.FindRoot(label);
+	if (root != label) {
+	    features.template Merge<ConfFeatures>(label, root);
+	}
+    }
+
+    // Segments of the slice, ERA temporarily holds the roots
+    roots.clear();
+    for (int row = 0; row < ccl.height; row++) {
+	const RowView<Seg_t> view = ccl.arena.Row(slot, row);
+	int32_t* restrict ERAi = view.ERA;
+	for (int er = 1; er < view.len; er += 2) {
+	    const int32_t root = ET.FindRoot(ERAi[er / 2]);
+	    if (remap[root] == 0) {
+		remap[root] = -1;
+		roots.push_back(root);
+		if (root > live) {
+		    features.template NewComponent3D<ConfFeatures>(root);
+		}
+	    }
+	    features.template AddSegment3D<ConfFeatures>(root, row, slice, view.RLC[er - 1],
+							  view.RLC[er]);
+	    ERAi[er / 2] = root;
+	}
+    }
+
+    // Finished: live roots without segment in the slice
+    int finished = 0;
+    for (int32_t label = 1; label <= live; label++) {
+	if (remap[label] == 0 && ET.FindRoot(label) == label) {
+	    emit((const Features&)features, label);
+	    finished++;
+	}
+    }
+
+    // Renumbering in ascending order: the live label of a root is not greater than the root, the
+    // features of the next roots are not overwritten
+    std::sort(roots.begin(), roots.end());
+    for (size_t k = 0; k < roots.size(); k++) {
+	const int32_t root = roots[k];
+	remap[root] = (int32_t)k + 1;
+	features.template Shift<ConfFeatures>((uint32_t)k + 1, root);
+    }
+
+    for (int row = 0; row < ccl.height; row++) {
+	const RowView<Seg_t> view = ccl.arena.Row(slot, row);
+	int32_t* restrict ERAi = view.ERA;
+	for (int i = 0; i < view.len / 2; i++) {
+	    ERAi[i] = remap[ERAi[i]];
+	}
+    }
+
+    for (const int32_t root : roots) {
+	remap[root] = 0;
+    }
+    ccl.live = (int32_t)roots.size();
+    return finished;
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver, typename ConfFeatures>
+template <typename Emit>
+int LSL3D_Stream<RLE, Unify, LabelsSolver, ConfFeatures>::Finish(CCL& ccl, Emit emit) {
+    const int32_t live = ccl.live;
+    for (int32_t label = 1; label <= live; label++) {
+	emit((const Features&)ccl.features, label);
+    }
+    ccl.live = 0;
+    ccl.slice = 0;
+    ccl.base = 0;
+    return live;
+}
+
+template <typename RLE, typename Unify, typename LabelsSolver, typename ConfFeatures>
+void LSL3D_Stream<RLE, Unify, LabelsSolver, ConfFeatures>::Rebase(CCL& ccl) {
+    Features& features = ccl.features;
+    const int32_t live = ccl.live;
+
+    int64_t delta = ccl.slice - ccl.base;
+    if (ConfFeatures::UseAABB) {
+	for (int32_t label = 1; label <= live; label++) {
+	    delta = std::min<int64_t>(delta, features.lo_slice[label]);
+	}
+    }
+    for (int32_t label = 1; label <= live; label++) {
+	if (ConfFeatures::UseAABB) {
+	    features.lo_slice[label] -= (uint16_t)delta;
+	    features.hi_slice[label] -= (uint16_t)delta;
+	}
+	if (ConfFeatures::UseMoment) {
+	    features.Sz[label] -= delta * features.S[label];
+	}
+    }
+    ccl.base += delta;
+}
+
+}
+
+#endif // CCL_ALGOS_3D_LSL3D_STREAM_HPP
@@ -2,22 +2,20 @@
 #define CCL_ALGOS_3D_LSL_FEATURES_HPP
 
 #include <lsl3dlib/features.hpp>
+#include <lsl3dlib/lsl3d/arena.hpp>
+#include <lsl3dlib/lsl3d/occupancy.hpp>
 #include <simdhelpers/restrict.hpp>
 
 
 struct FeatureComputation_None {
 
-    struct Conf {
-	using Seg_t = int16_t;
-    };
-
-    template <typename LabelsSolver, typename ConfFeatures>
-    static void CalcFeatures(Conf::Seg_t*** RLC, int32_t*** ERA, int16_t** Lengths, LabelsSolver& ET,
-		      Features& features, size_t label_count, int depth, int height, int width) {
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static void CalcFeatures(const RLEArena<Seg_t>& arena, LabelsSolver& ET, Features& features,
+			     size_t label_count, const Occupancy* occupancy = nullptr) {
     }
 
-    template <typename LabelsSolver, typename ConfFeatures>
-    static void CalcFeatures(int16_t*** RLC, int32_t*** ERA, int16_t** Lengths, LabelsSolver& ET,
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static void CalcFeatures(const RLEArena<Seg_t>& arena, LabelsSolver& ET,
 			     Features& features, size_t min_label, size_t max_label,
 			     int x0, int y0, int z0, int x1, int y1, int z1) {
     }
@@ -28,16 +26,15 @@ struct FeatureComputation_Line {
 
     struct Conf {
 	using Label_t = int32_t;
-	using Seg_t = int16_t;
     };
     
-    template <typename ConfFeatures>
-    static void CalcFeatures(const Conf::Seg_t* restrict RLCi, int32_t* restrict ERAi, int16_t len,
+    template <typename ConfFeatures, typename Seg_t>
+    static void CalcFeatures(const Seg_t* restrict RLCi, int32_t* restrict ERAi, int len,
 			     int old_label_count, Features& features, int slice, int row, int col) {
 	
         for (int er = 1; er < len; er += 2) {
-	    Conf::Seg_t segment_start = RLCi[er - 1];
-	    Conf::Seg_t segment_end = RLCi[er];
+	    Seg_t segment_start = RLCi[er - 1];
+	    Seg_t segment_end = RLCi[er];
 
 	    Conf::Label_t label = ERAi[er / 2];
 
@@ -55,9 +52,9 @@ struct FeatureComputation_Line {
 	}
     }
 
-    template <typename LabelsSolver, typename ConfFeatures>
-    static void CalcFeatures(typename Conf::Seg_t*** RLC, int32_t*** ERA, int16_t** Lengths, LabelsSolver& ET,
-			     Features& features, size_t label_count, int depth, int height, int width) {
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static void CalcFeatures(const RLEArena<Seg_t>& arena, LabelsSolver& ET, Features& features,
+			     size_t label_count, const Occupancy* occupancy = nullptr) {
     }
 
 };
@@ -69,12 +66,8 @@ using FeatureComputation_OTF = FeatureComputation_None;
 
 struct FeatureComputation {
 
-    struct Conf {
-	using Seg_t = int16_t;
-    };
-    
-    template <typename LabelsSolver, typename ConfFeatures>
-    static void CalcFeatures(int16_t*** RLC, int32_t*** ERA, int16_t** Lengths, LabelsSolver& ET,
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static void CalcFeatures(const RLEArena<Seg_t>& arena, LabelsSolver& ET,
 			     Features& features, size_t min_label, size_t max_label,
 			     int x0, int y0, int z0, int x1, int y1, int z1) {
 
@@ -84,12 +77,13 @@ struct FeatureComputation {
 	
 	for (int slice = z0; slice <= z1; slice++) {
 	    for (int row = y0; row <= y1; row++) {
-		int ner = Lengths[slice][row];
+		const RowView<Seg_t> view = arena.Row(slice, row);
+		int ner = view.len;
 		for (int er = 1; er < ner; er += 2) {
 
-		    int segstart = RLC[slice][row][er - 1];
-		    int segend = RLC[slice][row][er];
-		    int label = ERA[slice][row][er / 2];
+		    int segstart = view.RLC[er - 1];
+		    int segend = view.RLC[er];
+		    int label = view.ERA[er / 2];
 		    label = ET.GetLabel(label);
 
 		    features.AddSegment3D<ConfFeatures>(label, row, slice, segstart, segend);
@@ -99,25 +93,37 @@ struct FeatureComputation {
 	}
     }
 
-    template <typename LabelsSolver, typename ConfFeatures>
-    static void CalcFeatures(Conf::Seg_t*** RLC, int32_t*** ERA, int16_t** Lengths, LabelsSolver& ET,
-			     Features& features, size_t label_count, int depth, int height, int width) {
+    // With an occupancy index (see LSL3D::Run), empty slices and rows are skipped
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static void CalcFeatures(const RLEArena<Seg_t>& arena, LabelsSolver& ET, Features& features,
+			     size_t label_count, const Occupancy* occupancy = nullptr) {
+
+	const int height = arena.height;
+	const int depth = arena.depth;
 
 	// Initialize features
 	// Ignore '0' label -> start at 1
 	features.Init<ConfFeatures>(label_count);
+
+	Occupancy none;
+	const Occupancy& occ = occupancy != nullptr ? *occupancy : none;
 	
 	for (int slice = 0; slice < depth; slice++) {
-	    for (int row = 0; row < height; row++) {
+	    if (!occ.SliceOccupied(slice)) {
+		continue;
+	    }
+	    for (int row = occ.NextOccupiedRow(slice, 0); row < height;
+		 row = occ.NextOccupiedRow(slice, row + 1)) {
 		
-		const uint16_t segment_count = Lengths[slice][row];
-		const int16_t* restrict RLCi = RLC[slice][row];
-		const int32_t* restrict ERAi = ERA[slice][row];
+		const RowView<Seg_t> view = arena.Row(slice, row);
+		const int segment_count = view.len;
+		const Seg_t* restrict RLCi = view.RLC;
+		const int32_t* restrict ERAi = view.ERA;
 		
-		for (uint16_t er = 1; er < segment_count; er += 2) {
+		for (int er = 1; er < segment_count; er += 2) {
 
-		    const int16_t segment_start = RLCi[er - 1];
-		    const int16_t segment_end = RLCi[er];
+		    const Seg_t segment_start = RLCi[er - 1];
+		    const Seg_t segment_end = RLCi[er];
 		    int32_t label = ERAi[er / 2];
 		    label = ET.GetLabel(label);
 
@@ -1,14 +1,16 @@
 #ifndef CCL_ALGOS_3D_LSL_FEATURES_PARALLEL_HPP
 #define CCL_ALGOS_3D_LSL_FEATURES_PARALLEL_HPP
 
-#include "features.hpp"
+#include <lsl3dlib/features.hpp>
+#include <lsl3dlib/lsl3d/arena.hpp>
+#include <lsl3dlib/lsl3d/occupancy.hpp>
 #include <simdhelpers/restrict.hpp>
 
 struct FeaturesCalc_Parallel_None {
     
-    template <typename LabelsSolver, typename ConfFeatures>
-    static void CalcFeatures(int16_t*** RLC, int32_t*** ERA, int16_t** Lengths, LabelsSolver& ET,
-		      Features& features, size_t label_count, int depth, int height, int width) {
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static void CalcFeatures(const RLEArena<Seg_t>& arena, LabelsSolver& ET, Features& features,
+			     size_t label_count, const Occupancy* occupancy = nullptr) {
     }
 
 };
@@ -0,0 +1,128 @@
+#ifndef CCL_ALGOS_3D_OCCUPANCY_HPP
+#define CCL_ALGOS_3D_OCCUPANCY_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <climits>
+#include <vector>
+#include <algorithm>
+
+#include <simdhelpers/restrict.hpp>
+
+// Summary of the non-empty rows of a volume, built during the RLE (see LSL3D::Run).
+// - 1 bit per row (Lengths[slice][row] > 0), each slice starting on a new 64 bits word
+// - Per slice bounding box of the foreground
+// Unification, feature computation and relabeling use it to skip empty rows and slices by blocks.
+//
+// An occupancy that has not been built (Built() == false) reports every row as occupied: the
+// consumers behave as if there was no index.
+struct Occupancy {
+
+    struct Box {
+	int row0 = INT_MAX; // First non-empty row
+	int row1 = -1;      // Last non-empty row (included)
+	int col0 = INT_MAX; // First foreground column
+	int col1 = -1;      // End of the last segment (excluded)
+
+	inline bool Empty() const { return row1 < row0; }
+	inline void Merge(const Box& other);
+    };
+
+    std::vector<uint64_t> rows;
+    std::vector<Box> slices;
+
+    int height = 0;
+    int depth = 0;
+    int words_per_slice = 0;
+
+    void Reset(int height, int depth);
+    void Clear();
+
+    template <typename Seg_t>
+    inline void AddRow(int slice, int row, const Seg_t* restrict RLCi, Seg_t len);
+    // Same as above with the bounding box kept in `box`, merged later into slices[slice]. Threads
+    // can fill rows of the same slice as long as they do not share a 64 rows word.
+    template <typename Seg_t>
+    inline void AddRow(int slice, int row, const Seg_t* restrict RLCi, Seg_t len, Box& box);
+
+    inline bool Built() const { return depth > 0; }
+    inline bool RowOccupied(int slice, int row) const;
+    inline bool SliceOccupied(int slice) const;
+
+    // First occupied row in [row, height) of `slice`, height if none
+    inline int NextOccupiedRow(int slice, int row) const;
+};
+
+
+inline void Occupancy::Reset(int height, int depth) {
+    this->height = height;
+    this->depth = depth;
+    words_per_slice = (height + 63) / 64;
+
+    rows.assign((size_t)words_per_slice * depth, 0);
+    slices.assign(depth, Box());
+}
+
+inline void Occupancy::Clear() {
+    height = depth = words_per_slice = 0;
+    rows.clear();
+    slices.clear();
+}
+
+void Occupancy::Box::Merge(const Box& other) {
+    row0 = std::min(row0, other.row0);
+    row1 = std::max(row1, other.row1);
+    col0 = std::min(col0, other.col0);
+    col1 = std::max(col1, other.col1);
+}
+
+template <typename Seg_t>
+void Occupancy::AddRow(int slice, int row, const Seg_t* restrict RLCi, Seg_t len) {
+    AddRow(slice, row, RLCi, len, slices[slice]);
+}
+
+template <typename Seg_t>
+void Occupancy::AddRow(int slice, int row, const Seg_t* restrict RLCi, Seg_t len, Box& box) {
+    if (len == 0) {
+	return;
+    }
+    rows[(size_t)slice * words_per_slice + row / 64] |= 1ULL << (row % 64);
+
+    box.row0 = std::min(box.row0, row);
+    box.row1 = std::max(box.row1, row);
+    box.col0 = std::min<int>(box.col0, RLCi[0]);
+    box.col1 = std::max<int>(box.col1, RLCi[len - 1]);
+}
+
+bool Occupancy::RowOccupied(int slice, int row) const {
+    if (!Built()) {
+	return true;
+    }
+    return (rows[(size_t)slice * words_per_slice + row / 64] >> (row % 64)) & 1;
+}
+
+bool Occupancy::SliceOccupied(int slice) const {
+    return !Built() || !slices[slice].Empty();
+}
+
+int Occupancy::NextOccupiedRow(int slice, int row) const {
+    if (!Built()) {
+	return row;
+    }
+    const uint64_t* restrict words = rows.data() + (size_t)slice * words_per_slice;
+
+    int w = row / 64;
+    if (w >= words_per_slice) {
+	return height;
+    }
+    uint64_t word = words[w] & (~0ULL << (row % 64));
+    while (word == 0) {
+	if (++w == words_per_slice) {
+	    return height;
+	}
+	word = words[w];
+    }
+    return std::min(height, w * 64 + __builtin_ctzll(word));
+}
+
+#endif // CCL_ALGOS_3D_OCCUPANCY_HPP
@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <lsl3dlib/lsl3d/unification_common.hpp>
+#include <lsl3dlib/lsl3d/arena.hpp>
 #include <utility>
 #include <iostream>
 #include <lsl3dlib/features.hpp>
@@ -10,33 +11,41 @@
 struct Reduce_FSM {
 
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
     };
 
     
-    template <typename LabelsSolver, typename ConfFeatures>
-    static void ReduceLine(const Conf::Seg_t* restrict RLC0, const Conf::Seg_t* restrict RLC1,
-		       const int32_t* restrict ERA0, const int32_t* restrict ERA1,
-			   int16_t len_b, int16_t len_a, LabelsSolver& ET, Features& features);
-
-    
-    template <typename LabelsSolver, typename ConfFeatures>
-    static void Reduce(AdjState<Conf::Seg_t, Conf::Label_t>& state, Conf::Seg_t* RLCi, int32_t *ERAi,
-		       int16_t len, LabelsSolver& ET, Features& features);
+    // Diag: segments touching by a corner are merged
+    template <typename LabelsSolver, typename ConfFeatures, bool Diag = true, typename Seg_t>
+    static void ReduceLine(const Seg_t* restrict RLC0, const Seg_t* restrict RLC1,
+			   const int32_t* restrict ERA0, const int32_t* restrict ERA1,
+			   int len_b, int len_a, LabelsSolver& ET, Features& features);
+
+    // Rows of the previous slice of Conn (Connectivity)
+    template <typename LabelsSolver, typename ConfFeatures, typename Conn = Connectivity<26>,
+	      typename Seg_t>
+    static void Reduce(AdjState<Seg_t, Conf::Label_t>& state, Seg_t* RLCi, int32_t *ERAi,
+		       Seg_t len, LabelsSolver& ET, Features& features);
+
+    // Same as above on rows of a RLEArena: `row` against the rows row - 1, row and row + 1 of
+    // the previous slice
+    template <typename LabelsSolver, typename ConfFeatures, typename Conn = Connectivity<26>,
+	      typename Seg_t>
+    static void Reduce(const RowView<Seg_t>& row, const RowView<Seg_t> (&prev)[3],
+		       LabelsSolver& ET, Features& features);
     
 };
 
 // RLC0: Previous line
 // RLC1: Current line
-template <typename LabelsSolver, typename ConfFeatures>
-void Reduce_FSM::ReduceLine(const int16_t* restrict RLC1, const int16_t* restrict RLC0,
+template <typename LabelsSolver, typename ConfFeatures, bool Diag, typename Seg_t>
+void Reduce_FSM::ReduceLine(const Seg_t* restrict RLC1, const Seg_t* restrict RLC0,
 			    const int32_t* restrict ERA1, const int32_t* restrict ERA0,
-			    int16_t len1, int16_t len0, LabelsSolver& ET, Features& features) {
+			    int len1, int len0, LabelsSolver& ET, Features& features) {
 
-    int16_t er1 = 1, er0 = 1;
-    int16_t j0a, j1a;
-    int16_t j0b, j1b;
+    int er1 = 1, er0 = 1;
+    Seg_t j0a, j1a;
+    Seg_t j0b, j1b;
     int32_t label1, label0;
 
     if (len1 == 0) {
@@ -51,12 +60,12 @@ void Reduce_FSM::ReduceLine(const int16_t* restrict RLC1, const int16_t* restric
 
   main:
 	
-    if (j1b < j0a) { // Top before
+    if (seg_before<Diag>(j1b, j0a)) { // Top before
 	er0 += 2;
 	j0b = RLC0[er0 - 1];
 	j1b = RLC0[er0];
 	goto main;
-    } else if (j1a < j0b) {
+    } else if (seg_before<Diag>(j1a, j0b)) {
 	goto next_a;
     }
 
@@ -94,7 +103,7 @@ void Reduce_FSM::ReduceLine(const int16_t* restrict RLC1, const int16_t* restric
 
     j0b = RLC0[er0 - 1];
     j1b = RLC0[er0];
-    if (j1a < j0b) {
+    if (seg_before<Diag>(j1a, j0b)) {
 	goto next_a;
     }
     goto merge;
@@ -114,18 +123,37 @@ void Reduce_FSM::ReduceLine(const int16_t* restrict RLC1, const int16_t* restric
     return;    
 }
 
-template <typename LabelsSolver, typename ConfFeatures>
-void Reduce_FSM::Reduce(AdjState<Conf::Seg_t, Conf::Label_t> &state, Conf::Seg_t *RLCi, int32_t *ERAi,
-			int16_t len, LabelsSolver &ET, Features& features) {
+template <typename LabelsSolver, typename ConfFeatures, typename Conn, typename Seg_t>
+void Reduce_FSM::Reduce(AdjState<Seg_t, Conf::Label_t> &state, Seg_t *RLCi, int32_t *ERAi,
+			Seg_t len, LabelsSolver &ET, Features& features) {
     
-    Reduce_FSM::ReduceLine<LabelsSolver, ConfFeatures>(
-	RLCi, state.RLC1, ERAi, state.ERA1, len, state.len1, ET, features);
+    if (Conn::Row1) {
+	Reduce_FSM::ReduceLine<LabelsSolver, ConfFeatures, Conn::Diag1>(
+	    RLCi, state.RLC1, ERAi, state.ERA1, len, state.len1, ET, features);
+    }
     
-    Reduce_FSM::ReduceLine<LabelsSolver, ConfFeatures>(
+    Reduce_FSM::ReduceLine<LabelsSolver, ConfFeatures, Conn::Diag2>(
 	RLCi, state.RLC2, ERAi, state.ERA2, len, state.len2, ET, features);
     
-    Reduce_FSM::ReduceLine<LabelsSolver, ConfFeatures>(
-	RLCi, state.RLC3, ERAi, state.ERA3, len, state.len3, ET, features);
+    if (Conn::Row3) {
+	Reduce_FSM::ReduceLine<LabelsSolver, ConfFeatures, Conn::Diag3>(
+	    RLCi, state.RLC3, ERAi, state.ERA3, len, state.len3, ET, features);
+    }
+}
+
+template <typename LabelsSolver, typename ConfFeatures, typename Conn, typename Seg_t>
+void Reduce_FSM::Reduce(const RowView<Seg_t>& row, const RowView<Seg_t> (&prev)[3],
+			LabelsSolver& ET, Features& features) {
+    if (Conn::Row1) {
+	Reduce_FSM::ReduceLine<LabelsSolver, ConfFeatures, Conn::Diag1>(
+	    row.RLC, prev[0].RLC, row.ERA, prev[0].ERA, row.len, prev[0].len, ET, features);
+    }
+    Reduce_FSM::ReduceLine<LabelsSolver, ConfFeatures, Conn::Diag2>(
+	row.RLC, prev[1].RLC, row.ERA, prev[1].ERA, row.len, prev[1].len, ET, features);
+    if (Conn::Row3) {
+	Reduce_FSM::ReduceLine<LabelsSolver, ConfFeatures, Conn::Diag3>(
+	    row.RLC, prev[2].RLC, row.ERA, prev[2].ERA, row.len, prev[2].len, ET, features);
+    }
 }
 
 #endif // CCL_ALGOS_3D_REDUCE_FSM_HPP
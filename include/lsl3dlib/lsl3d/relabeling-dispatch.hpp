@@ -0,0 +1,90 @@
+#ifndef CCL_ALGOS_3D_RELABELING_DISPATCH_HPP
+#define CCL_ALGOS_3D_RELABELING_DISPATCH_HPP
+
+#include <type_traits>
+
+#include <simdhelpers/restrict.hpp>
+
+#include <lsl3dlib/dispatch.hpp>
+#include <lsl3dlib/lsl3d/relabeling.hpp>
+
+
+namespace algo {
+
+// WriteSegment policy selected at runtime (see dispatch::Kernels)
+struct WriteSegmentDispatch {
+
+    struct Conf {
+	using Label_t = int32_t;
+    };
+
+    static inline void Write(Conf::Label_t* restrict line, Conf::Label_t label,
+			     int segment_start, int segment_end) {
+	::dispatch::kernels.write_segment(line, label, segment_start, segment_end);
+    }
+};
+
+// Same output as Relabeling_Z_Generic, with one indirect call per row instead of one per segment:
+// the labels of a row are first resolved in place in ERA (as Relabeling_Pixel does), then the
+// whole row is written by the selected kernel.
+// ERA holds the final labels afterward. The row kernels read int16_t rows (dispatch::WriteRowFun).
+struct Relabeling_Z_Dispatch {
+
+    struct Conf {
+	using Seg_t = int16_t;
+	using Label_t = int32_t;
+
+	static constexpr bool DO_NOTHING = false;
+    };
+
+    template <typename ConfLSL, typename LabelsSolver>
+    static inline void Relabel(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl);
+
+    // Slices [slice0, slice1) only (see LSL3D_Parallel)
+    template <typename ConfLSL, typename LabelsSolver>
+    static inline void Relabel(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl, int slice0, int slice1);
+};
+
+template <typename ConfLSL, typename LabelsSolver>
+void Relabeling_Z_Dispatch::Relabel(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl) {
+    Relabel(ccl, 0, ccl.depth);
+}
+
+template <typename ConfLSL, typename LabelsSolver>
+void Relabeling_Z_Dispatch::Relabel(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl,
+				    int slice0, int slice1) {
+
+    static_assert(std::is_same<typename ConfLSL::Seg_t, Conf::Seg_t>::value,
+		  "The row kernels read int16_t rows (see Relabeling_Z_Generic)");
+
+    int width = ccl.width;
+    int height = ccl.height;
+
+    ::dispatch::WriteRowFun write_row = ::dispatch::kernels.write_row;
+
+    for (int slice = slice0; slice < slice1; slice++) {
+	for (int row = 0;; row++) {
+	    int next = ccl.occupancy.NextOccupiedRow(slice, row);
+	    fill_rows_zero<int32_t>(ccl.labels, slice, row, next, width);
+	    if (next == height) {
+		break;
+	    }
+	    row = next;
+
+	    const RowView<Conf::Seg_t> view = ccl.arena.Row(slice, row);
+	    const Conf::Seg_t* restrict RLCi = view.RLC;
+	    int32_t* restrict ERAi = view.ERA;
+	    const Conf::Seg_t len = view.len;
+	    int32_t* restrict dstrow = ccl.labels.template ptr<int32_t>(slice, row);
+
+	    for (int i = 0; i < len / 2; i++) {
+		ERAi[i] = ET_GET_LABEL(ccl.ET, ERAi[i]);
+	    }
+	    write_row(dstrow, RLCi, ERAi, len, width);
+	}
+    }
+}
+
+}
+
+#endif // CCL_ALGOS_3D_RELABELING_DISPATCH_HPP
@@ -1,6 +1,8 @@
 #ifndef CCL_ALGOS_3D_RELABELING_SSE_HPP
 #define CCL_ALGOS_3D_RELABELING_SSE_HPP
 
+#include <cstring>
+
 #include <opencv2/core.hpp>
 
 #include <lsl3dlib/lsl/relabeling.hpp>
@@ -16,6 +18,7 @@
 #include <lsl3dlib/compat.hpp>
 
 #include <lsl3dlib/lsl3d/relabeling.hpp>
+#include <lsl3dlib/rle/rle-sse.hpp>
 #include <simdhelpers/utils-sse.hpp>
 #include <simdhelpers/simd-wrapper.hpp>
 
@@ -26,14 +29,13 @@ namespace sse {
 struct WriteSegmentSSE {
     
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
     };
     
     static inline void Write(Conf::Label_t* restrict line, Conf::Label_t label,
-			     Conf::Seg_t segment_start, Conf::Seg_t segment_end) {
+			     int segment_start, int segment_end) {
 	__m128i val = _mm_set1_epi32(label);
-	for (int16_t i = segment_start; i < segment_end; i += 4) {
+	for (int i = segment_start; i < segment_end; i += 4) {
 	    _mm_storeu_si128((__m128i*)(line + i), val);
 	}
     }
@@ -54,19 +56,18 @@ using Relabeling_Z = algo::Relabeling_Z_Generic<WriteSegmentSSE>;
 struct Relabeling_Z_V2 {
 
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
 
 	static constexpr bool DO_NOTHING = false;
     };
     
-    template <typename LabelsSolver>    
-    static inline void Relabel(cv::Mat1i& labels, int32_t*** ERA, Conf::Seg_t*** RLC, int16_t** Lengths,
+    template <typename LabelsSolver, typename Seg_t>
+    static inline void Relabel(cv::Mat1i& labels, int32_t*** ERA, Seg_t*** RLC, Seg_t** Lengths,
 			       LabelsSolver& ET);
 };
 
-template <typename LabelsSolver>
-void Relabeling_Z_V2::Relabel(MAT3D_i32& labels, int32_t*** ERA, Conf::Seg_t*** RLC, int16_t** Lengths,
+template <typename LabelsSolver, typename Seg_t>
+void Relabeling_Z_V2::Relabel(MAT3D_i32& labels, int32_t*** ERA, Seg_t*** RLC, Seg_t** Lengths,
 			      LabelsSolver& ET) {
     
     int width, height, depth;
@@ -77,13 +78,13 @@ void Relabeling_Z_V2::Relabel(MAT3D_i32& labels, int32_t*** ERA, Conf::Seg_t***
     for (int slice = 0; slice < depth; slice++) {	
 	for (int row = 0; row < height; row++) {
 
-	    const Conf::Seg_t* restrict RLCi = RLC[slice][row];
+	    const Seg_t* restrict RLCi = RLC[slice][row];
 	    const int32_t* restrict ERAi = ERA[slice][row];
 	    int rlen = Lengths[slice][row];
 	    Conf::Label_t* restrict dstrow = MAT3D_PTR(labels, Conf::Label_t, slice, row);
 	    
-	    uint16_t seg_start = 0;
-	    uint16_t seg_end = 0;
+	    int seg_start = 0;
+	    int seg_end = 0;
 	    for (int er = 1; er < rlen; er += 2) {
 		_mm_storeu_si128((__m128i*)(dstrow + seg_end), _mm_setzero_si128());
 
@@ -106,10 +107,13 @@ void Relabeling_Z_V2::Relabel(MAT3D_i32& labels, int32_t*** ERA, Conf::Seg_t***
 }
 
 
-struct Relabeling_Pixel {
+// Unpadded = false: image and label rows are aligned and have RLE_IMG_MARGIN_AFTER elements.
+// Unpadded = true: rows are neither aligned nor padded (see create_mat_view), the last block of
+// pixels is loaded with rle::sse::load_partial_8x16 and the last tile is stored element-wise.
+template <bool Unpadded>
+struct Relabeling_Pixel_Generic {
 
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
 
 	static constexpr bool DO_NOTHING = false;
@@ -119,22 +123,35 @@ struct Relabeling_Pixel {
     
     template <typename ConfLSL, typename LabelsSolver>
     static inline void Relabel(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl) {
+	Relabel(ccl, 0, ccl.depth);
+    }
+
+    // Slices [slice0, slice1) only (see LSL3D_Parallel)
+    template <typename ConfLSL, typename LabelsSolver>
+    static inline void Relabel(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl, int slice0, int slice1) {
 
 	int width = ccl.width;
 	int height = ccl.height;
-	int depth = ccl.depth;
 
 
 	//std::cout << "\n=== Relabeling Pixel ===\n";
 	constexpr int16_t TILE_W = 4;
 	
-	for (int slice = 0; slice < depth; slice++) {
-	    for (int row = 0; row < height; row++) {
+	for (int slice = slice0; slice < slice1; slice++) {
+	    // Empty rows (see Occupancy) are set to 0 by blocks: the image is not read
+	    for (int row = 0;; row++) {
+		int next = ccl.occupancy.NextOccupiedRow(slice, row);
+		fill_rows_zero<int32_t>(ccl.labels, slice, row, next, width);
+		if (next == height) {
+		    break;
+		}
+		row = next;
 
 		const uint8_t* restrict srcrow = ccl.image.template ptr<uint8_t>(slice, row);
-		int32_t* restrict ERAi = ccl.ERA[slice][row];
+		const RowView<typename ConfLSL::Seg_t> view = ccl.arena.Row(slice, row);
+		int32_t* restrict ERAi = view.ERA;
 		int32_t* restrict dstrow = ccl.labels.template ptr<int32_t>(slice, row);
-		const int16_t len = ccl.Lengths[slice][row] / 2;
+		const int len = view.len / 2;
 		
 		int n = 0;
 
@@ -156,7 +173,14 @@ struct Relabeling_Pixel {
 		// Main loop
 		__m128i last = _mm_set1_epi8(0);
 		for (int col = 0; col < width; col += 16) {
-		    __m128i in = _mm_load_si128((__m128i*)(srcrow + col));
+		    __m128i in;
+		    if (!Unpadded) {
+			in = _mm_load_si128((__m128i*)(srcrow + col));
+		    } else if (col + 16 > width) {
+			in = rle::sse::load_partial_8x16(srcrow + col, width - col);
+		    } else {
+			in = _mm_loadu_si128((__m128i*)(srcrow + col));
+		    }
 		    __m128i f = _mm_xor_si128(in, ::sse::vec_right_8x16(last, in));
 
 		    last = in;
@@ -224,7 +248,16 @@ struct Relabeling_Pixel {
 			//std::cout << "       l0<" << J << "> = " << SIMDWrapper<4>(l0) << "\n";
 
 			
-			_mm_store_si128((__m128i*)(dstrow + col + J * TILE_W), l0);
+			int32_t* restrict dst = dstrow + col + J * TILE_W;
+			if (!Unpadded) {
+			    _mm_store_si128((__m128i*)dst, l0);
+			} else if (col + (J + 1) * TILE_W > width) {
+			    alignas(16) int32_t tile[TILE_W];
+			    _mm_store_si128((__m128i*)tile, l0);
+			    memcpy(dst, tile, (width - col - J * TILE_W) * sizeof(int32_t));
+			} else {
+			    _mm_storeu_si128((__m128i*)dst, l0);
+			}
 
 
 			int n2 = n + cnt0;
@@ -251,6 +284,9 @@ struct Relabeling_Pixel {
     }
 };
 
+using Relabeling_Pixel = Relabeling_Pixel_Generic<false>;
+using Relabeling_Pixel_Unpadded = Relabeling_Pixel_Generic<true>;
+
 }
 }
 
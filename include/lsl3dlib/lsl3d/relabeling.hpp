@@ -1,6 +1,8 @@
 #ifndef CCL_ALGOS_3D_RELABELING_HPP
 #define CCL_ALGOS_3D_RELABELING_HPP
 
+#include <cstring>
+
 #include <opencv2/core.hpp>
 
 #include "lsl3dlib/lsl/relabeling.hpp"
@@ -12,16 +14,20 @@
 
 #include "lsl3dlib/compat.hpp"
 #include "lsl3dlib/lsl3d/lsl3d.hpp"
+#include "lsl3dlib/lsl3d/unification_common.hpp"
 
 
 namespace algo {
 
+// Set rows [row0, row1) of `slice` to 0: one memset when the rows have no padding
+template <typename T>
+inline void fill_rows_zero(cv::Mat& mat, int slice, int row0, int row1, int width);
+
 
 template <typename SegmentWriteFun>
 struct Relabeling_Z_Generic {
 
     struct Conf {
-	using Seg_t = typename SegmentWriteFun::Conf::Seg_t;
 	using Label_t = typename SegmentWriteFun::Conf::Label_t;
 
 	static constexpr bool DO_NOTHING = false;
@@ -30,27 +36,48 @@ struct Relabeling_Z_Generic {
     
     template <typename ConfLSL, typename LabelsSolver>
     static inline void Relabel(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl);
+
+    // Slices [slice0, slice1) only (see LSL3D_Parallel)
+    template <typename ConfLSL, typename LabelsSolver>
+    static inline void Relabel(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl, int slice0, int slice1);
 };
 
 template <typename SegmentWriteFun> template <typename ConfLSL, typename LabelsSolver>
 void Relabeling_Z_Generic<SegmentWriteFun>::Relabel(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl) {
+    Relabel(ccl, 0, ccl.depth);
+}
+
+template <typename SegmentWriteFun> template <typename ConfLSL, typename LabelsSolver>
+void Relabeling_Z_Generic<SegmentWriteFun>::Relabel(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl,
+						    int slice0, int slice1) {
     
     int width = ccl.width;
     int height = ccl.height;
     int depth = ccl.depth;
     
-    for (int16_t slice = 0; slice < depth; slice++) {
-	for (int16_t row  = 0; row < height; row++) {
-	    const int16_t* restrict RLCi = ccl.RLC[slice][row];
-	    const int32_t* restrict ERAi = ccl.ERA[slice][row];	    
-	    const int16_t segment_count = ccl.Lengths[slice][row];
+    using Seg_t = typename ConfLSL::Seg_t;
+    
+    for (int slice = slice0; slice < slice1; slice++) {
+	// Empty rows (see Occupancy) are set to 0 by blocks
+	for (int row = 0;; row++) {
+	    int next = ccl.occupancy.NextOccupiedRow(slice, row);
+	    fill_rows_zero<int32_t>(ccl.labels, slice, row, next, width);
+	    if (next == height) {
+		break;
+	    }
+	    row = next;
+
+	    const RowView<Seg_t> view = ccl.arena.Row(slice, row);
+	    const Seg_t* restrict RLCi = view.RLC;
+	    const int32_t* restrict ERAi = view.ERA;
+	    const Seg_t segment_count = view.len;
 	    int32_t* restrict dstrow = ccl.labels.template ptr<int32_t>(slice, row);
 	    	    
-	    int16_t segment_start = 0;
-	    int16_t segment_end = 0;
+	    Seg_t segment_start = 0;
+	    Seg_t segment_end = 0;
 	    
 	    for (int er = 1; er < segment_count; er += 2) {
-		uint16_t segment_id = er / 2;
+		uint32_t segment_id = to_era_index(er);
 		
 		segment_start = RLCi[er - 1];
 		SegmentWriteFun::Write(dstrow, 0, segment_end, segment_start);
@@ -68,39 +95,39 @@ void Relabeling_Z_Generic<SegmentWriteFun>::Relabel(LSL3D_CCL_t<ConfLSL, LabelsS
 }
 
 
-template <typename LabelsSolver>
+// Rows given as tables of pointers: Seg_t is the type of the RLC rows (see unification_common.hpp)
+template <typename LabelsSolver, typename Seg_t>
 uint32_t relabeling(cv::Mat1i& EA, int32_t*** ERA,
-		   int16_t*** rlc, LabelsSolver& ET);
+		   Seg_t*** rlc, Seg_t** Lengths, LabelsSolver& ET);
 
-template <typename LabelsSolver>
+template <typename LabelsSolver, typename Seg_t>
 uint32_t relabeling_v2(cv::Mat1i& EA, int32_t*** ERA,
-		      int16_t*** rlc, LabelsSolver& ET);
+		      Seg_t*** rlc, Seg_t** Lengths, LabelsSolver& ET);
 
-template <typename LabelsSolver>
+template <typename LabelsSolver, typename Seg_t>
 uint32_t relabeling_z(cv::Mat1i& EA, int32_t*** ERA,
-		     int16_t*** rlc, LabelsSolver& ET);
+		     Seg_t*** rlc, Seg_t** Lengths, LabelsSolver& ET);
 
 // Same as previous except that the entire line is first set to 0 prior to writing lines
-template <typename LabelsSolver>
+template <typename LabelsSolver, typename Seg_t>
 uint32_t relabeling_z_2(cv::Mat1i& EA, int32_t*** ERA,
-			int16_t*** rlc, LabelsSolver& ET);
+			Seg_t*** rlc, Seg_t** Lengths, LabelsSolver& ET);
 
 
 // Same as previous except that the entire line is first set to 0 prior to writing lines
-template <typename LabelsSolver>
+template <typename LabelsSolver, typename Seg_t>
 uint32_t relabeling_z_border_2(cv::Mat1i& EA, int32_t*** ERA,
-			    int16_t*** rlc, LabelsSolver& ET);
+			    Seg_t*** rlc, Seg_t** Lengths, LabelsSolver& ET);
 
-template <typename LabelsSolver>
-uint32_t relabeling_z_no_era(cv::Mat1i& EA,
-			    int16_t*** rlc, LabelsSolver& ET);
+// ERA-less unifications: the label of a segment is ccl.row_label of its row + its index
+template <typename ConfLSL, typename LabelsSolver>
+void relabeling_z_no_era(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl, int slice0, int slice1);
 
-void relabel_nothing(cv::Mat1i &labels, int32_t*** ERA, int16_t*** RLC);
+void relabel_nothing(cv::Mat1i &labels, const void* state);
 
 struct Relabeling_Nothing {
 
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
 
 	static constexpr bool DO_NOTHING = true;
@@ -110,21 +137,25 @@ struct Relabeling_Nothing {
     // the call. This is needed for measuring cost of RLE
     template <typename ConfLSL, typename LabelsSolver>
     static void Relabel(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl) {
-	relabel_nothing(ccl.labels, ccl.ERA, ccl.RLC);
+	relabel_nothing(ccl.labels, ccl.arena.base);
+    }
+
+    template <typename ConfLSL, typename LabelsSolver>
+    static void Relabel(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl, int slice0, int slice1) {
+	relabel_nothing(ccl.labels, ccl.arena.base);
     }
 };
 
 struct Relabeling {
     
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
 
 	static constexpr bool DO_NOTHING = false;
     };
     
-    template <typename LabelsSolver>
-    static inline void Relabel(cv::Mat1i& labels, int32_t*** ERA, int16_t*** RLC, int16_t** Lengths,
+    template <typename LabelsSolver, typename Seg_t>
+    static inline void Relabel(cv::Mat1i& labels, int32_t*** ERA, Seg_t*** RLC, Seg_t** Lengths,
 			       LabelsSolver& ET) {
 	relabeling(labels, ERA, RLC, Lengths, ET);
     }
@@ -133,32 +164,30 @@ struct Relabeling {
 struct Relabeling_V2 {
 
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
 
 	static constexpr bool DO_NOTHING = false;
     };
     
-    template <typename LabelsSolver>
-    static inline void Relabel(cv::Mat1i& labels, int32_t*** ERA, int16_t*** RLC, int16_t** Lengths,
+    template <typename LabelsSolver, typename Seg_t>
+    static inline void Relabel(cv::Mat1i& labels, int32_t*** ERA, Seg_t*** RLC, Seg_t** Lengths,
 			       LabelsSolver& ET) {
-	relabeling_v2<LabelsSolver>(labels, ERA, RLC, Lengths, ET);
+	relabeling_v2(labels, ERA, RLC, Lengths, ET);
     }
 };
 
 struct Relabeling_Z {
 
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
 
 	static constexpr bool DO_NOTHING = false;
     };
     
-    template <typename LabelsSolver>
-    static inline void Relabel(cv::Mat1i& labels, int32_t*** ERA, int16_t*** RLC, int16_t** Lengths,
+    template <typename LabelsSolver, typename Seg_t>
+    static inline void Relabel(cv::Mat1i& labels, int32_t*** ERA, Seg_t*** RLC, Seg_t** Lengths,
 			       LabelsSolver& ET) {
-	relabeling_z<LabelsSolver>(labels, ERA, RLC, Lengths, ET);
+	relabeling_z(labels, ERA, RLC, Lengths, ET);
     }
 };
 
@@ -166,16 +195,15 @@ struct Relabeling_Z {
 struct Relabeling_Z_V2 {
 
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
 
 	static constexpr bool DO_NOTHING = false;
     };
     
-    template <typename LabelsSolver>
-    static inline void Relabel(cv::Mat1i& labels, int32_t*** ERA, int16_t*** RLC, int16_t** Lengths,
+    template <typename LabelsSolver, typename Seg_t>
+    static inline void Relabel(cv::Mat1i& labels, int32_t*** ERA, Seg_t*** RLC, Seg_t** Lengths,
 			       LabelsSolver& ET) {
-	relabeling_z_2<LabelsSolver>(labels, ERA, RLC, Lengths, ET);
+	relabeling_z_2(labels, ERA, RLC, Lengths, ET);
     }
 };
 
@@ -184,44 +212,47 @@ struct Relabeling_Z_V2 {
 struct Relabeling_Z_Border_V2 {
 
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
 
 	static constexpr bool DO_NOTHING = false;
     };
     
-    template <typename LabelsSolver>
-    static inline void Relabel(cv::Mat1i& labels, int32_t*** ERA, int16_t*** RLC, int16_t** Lengths,
+    template <typename LabelsSolver, typename Seg_t>
+    static inline void Relabel(cv::Mat1i& labels, int32_t*** ERA, Seg_t*** RLC, Seg_t** Lengths,
 			       LabelsSolver& ET);
 };
 
 struct Relabeling_Z_NOERA {
     
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
 
 	static constexpr bool DO_NOTHING = false;
     };
     
-    template <typename LabelsSolver>
-    static inline void Relabel(cv::Mat1i& labels, int16_t*** RLC, int16_t** Lengths, LabelsSolver& ET) {
-	relabeling_z_no_era<LabelsSolver>(labels, RLC, Lengths, ET);
+    template <typename ConfLSL, typename LabelsSolver>
+    static inline void Relabel(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl) {
+	relabeling_z_no_era(ccl, 0, ccl.depth);
+    }
+
+    template <typename ConfLSL, typename LabelsSolver>
+    static inline void Relabel(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl, int slice0, int slice1) {
+	relabeling_z_no_era(ccl, slice0, slice1);
     }
 };
 
 
+// Columns are int: segments of any Seg_t and the row width are written
 struct WriteSegmentFill {
     
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
 
 	static constexpr bool DO_NOTHING = false;
     };
     
     static inline void Write(Conf::Label_t* restrict line, Conf::Label_t label,
-			     Conf::Seg_t segment_start, Conf::Seg_t segment_end) {
+			     int segment_start, int segment_end) {
 	std::fill(line + segment_start, line + segment_end, label);
     }
 };
@@ -229,9 +260,24 @@ struct WriteSegmentFill {
 using Relabeling_Z_Border = Relabeling_Z_Generic<WriteSegmentFill>;
 
 
-template <typename LabelsSolver>
+template <typename T>
+void fill_rows_zero(cv::Mat& mat, int slice, int row0, int row1, int width) {
+    if (row0 >= row1) {
+	return;
+    }
+    if (mat.step[1] == width * sizeof(T)) {
+	memset(mat.ptr<T>(slice, row0), 0, (size_t)(row1 - row0) * width * sizeof(T));
+	return;
+    }
+    for (int row = row0; row < row1; row++) {
+	memset(mat.ptr<T>(slice, row), 0, width * sizeof(T));
+    }
+}
+
+
+template <typename LabelsSolver, typename Seg_t>
 uint32_t relabeling(cv::Mat1i& labels, int32_t*** ERA,
-		    int16_t*** RLC, int16_t** Lengths, LabelsSolver& ET) {
+		    Seg_t*** RLC, Seg_t** Lengths, LabelsSolver& ET) {
     int width, height, depth;
     int rowstride, slicestride;
 
@@ -245,17 +291,17 @@ uint32_t relabeling(cv::Mat1i& labels, int32_t*** ERA,
     for (uint16_t slice = 0; slice < depth; slice++) {
 	for (uint16_t row  = 0; row < height; row++) {
 
-	    const int16_t* RLCi = RLC[slice][row];
+	    const Seg_t* RLCi = RLC[slice][row];
 	    const int32_t* ERAi = ERA[slice][row];
-	    const uint16_t segment_count = Lengths[slice][row];
+	    const int segment_count = Lengths[slice][row];
 	    int32_t* dstrow = labels.ptr<int32_t>(slice, row);
 	    
-	    uint16_t segment_start = 0;
-	    uint16_t segment_end = -1;
+	    int segment_start = 0;
+	    int segment_end = -1;
 
-	    std::fill(RLCi, RLCi + width, 0);
-	    for (uint16_t col = 1; col < segment_count; col += 2) {
-		uint16_t segment_id = col / 2;
+	    std::fill(dstrow, dstrow + width, 0);
+	    for (int col = 1; col < segment_count; col += 2) {
+		int segment_id = col / 2;
 
 		segment_start = RLCi[col - 1];		
 		segment_end = RLCi[col];
@@ -273,9 +319,9 @@ uint32_t relabeling(cv::Mat1i& labels, int32_t*** ERA,
 }
 
 
-template <typename LabelsSolver>
+template <typename LabelsSolver, typename Seg_t>
 inline uint32_t relabeling_z(cv::Mat1i& labels, int32_t*** ERA,
-			     int16_t*** RLC, int16_t** Lengths, LabelsSolver& ET) {
+			     Seg_t*** RLC, Seg_t** Lengths, LabelsSolver& ET) {
     uint32_t nea = 0;
     
     int width, height, depth;
@@ -288,29 +334,29 @@ inline uint32_t relabeling_z(cv::Mat1i& labels, int32_t*** ERA,
     for (uint16_t slice = 0; slice < depth; slice++) {
 	for (uint16_t row  = 0; row < height; row++) {
 
-	    const int16_t* restrict RLCi = RLC[slice][row];
+	    const Seg_t* restrict RLCi = RLC[slice][row];
 	    const int32_t* restrict ERAi = ERA[slice][row];
 	    int32_t* restrict dstrow = labels.ptr<int32_t>(slice, row);
-	    const uint16_t segment_count = Lengths[slice][row];
+	    const int segment_count = Lengths[slice][row];
 	    
-	    uint16_t segment_start = 0;
-	    uint16_t segment_end = 0;
+	    int segment_start = 0;
+	    int segment_end = 0;
 
 	    //std::fill(dstrow, dstrow + width, 0);
-	    for (uint16_t col = 1; col < segment_count; col += 2) {
-		uint16_t segment_id = col / 2;
+	    for (int col = 1; col < segment_count; col += 2) {
+		int segment_id = col / 2;
 		
 		segment_start = RLCi[col - 1];
-		lsl::WriteSegmentScalar::Write(dstrow, 0, segment_end, segment_start);
+		WriteSegmentFill::Write(dstrow, 0, segment_end, segment_start);
 		segment_end = RLCi[col];
 		
 		uint32_t label = ERAi[segment_id];
 		uint32_t ea = ET.GetLabel(label);
 		
 		assert(ea <= width * height * depth);
-		lsl::WriteSegmentScalar::Write(dstrow, ea, segment_start, segment_end);
+		WriteSegmentFill::Write(dstrow, ea, segment_start, segment_end);
 	    }
-	    lsl::WriteSegmentScalar::Write(dstrow, 0, segment_end, width);
+	    WriteSegmentFill::Write(dstrow, 0, segment_end, width);
 	}
     }
     return nea;
@@ -318,9 +364,9 @@ inline uint32_t relabeling_z(cv::Mat1i& labels, int32_t*** ERA,
 
 
 // Step 3+5
-template <typename LabelsSolver>
+template <typename LabelsSolver, typename Seg_t>
 uint32_t relabeling_v2(cv::Mat1i& labels, int32_t*** ERA,
-		       int16_t*** RLC, int16_t** Lengths, LabelsSolver& ET) {
+		       Seg_t*** RLC, Seg_t** Lengths, LabelsSolver& ET) {
     int width, height, depth;
     int rowstride, slicestride;
 
@@ -333,16 +379,16 @@ uint32_t relabeling_v2(cv::Mat1i& labels, int32_t*** ERA,
     for (uint16_t slice = 0; slice < depth; slice++) {
 	for (uint16_t row  = 0; row < height; row++) {
 
-	    const int16_t* restrict RLCi = RLC[slice][row];
+	    const Seg_t* restrict RLCi = RLC[slice][row];
 	    const int32_t* restrict ERAi = ERA[slice][row];
 	    int32_t* restrict dstrow = labels.ptr<int32_t>(slice, row);
-	    const uint16_t segment_count = Lengths[slice][row];
+	    const int segment_count = Lengths[slice][row];
 	    
-	    uint16_t segment_start = 0;
-	    uint16_t segment_end = -1;
+	    int segment_start = 0;
+	    int segment_end = -1;
 
-	    for (uint16_t col = 1; col < segment_count; col += 2) {
-		uint16_t segment_id = col / 2;
+	    for (int col = 1; col < segment_count; col += 2) {
+		int segment_id = col / 2;
 
 		segment_start = RLCi[col - 1];
 		std::fill(dstrow + segment_end + 1, dstrow + segment_start, 0);
@@ -362,57 +408,50 @@ uint32_t relabeling_v2(cv::Mat1i& labels, int32_t*** ERA,
 }
 
 
-// Merge for STDZ version + handle RLC borders
-template <typename LabelsSolver>
-uint32_t relabeling_z_no_era(cv::Mat1i& labels, int16_t*** RLC, int16_t** Lengths, LabelsSolver& ET) {
-    
-    int width, height, depth;
-    int rowstride, slicestride;
+// Same as Relabeling_Z_Generic<WriteSegmentFill>, labels from ccl.row_label
+template <typename ConfLSL, typename LabelsSolver>
+void relabeling_z_no_era(LSL3D_CCL_t<ConfLSL, LabelsSolver>& ccl, int slice0, int slice1) {
 
-    GetMatSize(labels, width, height, depth);
-    GetMatStrides<uint32_t>(labels, rowstride, slicestride);    
-    
-    uint32_t nea = 0;
-    
-	    
-    uint32_t uf_offset = 1;
-    
-    for (uint16_t slice = 0; slice < depth; slice++) {
-		
-	for (uint16_t row  = 0; row < height; row++) {
+    using Seg_t = typename ConfLSL::Seg_t;
 
-	    const int16_t* restrict RLCi = RLC[slice][row];
-	    const uint16_t segment_count = Lengths[slice][row];
-	    int32_t* restrict dstrow = labels.ptr<int32_t>(slice, row);
-	    
-	    uint16_t segment_start = 0;
-	    uint16_t segment_end = 0;
-	    
-	    for (uint16_t col = 1; col < segment_count; col += 2) {
-		uint16_t segment_id = col / 2;
-		
-		segment_start = RLCi[col - 1];
-		std::fill(dstrow + segment_end, dstrow + segment_start, 0);
-		segment_end = RLCi[col];
+    const int width = ccl.width;
+    const int height = ccl.height;
 
+    for (int slice = slice0; slice < slice1; slice++) {
+	// Empty rows (see Occupancy) are set to 0 by blocks
+	for (int row = 0;; row++) {
+	    int next = ccl.occupancy.NextOccupiedRow(slice, row);
+	    fill_rows_zero<int32_t>(ccl.labels, slice, row, next, width);
+	    if (next == height) {
+		break;
+	    }
+	    row = next;
 
-		uint32_t label = ET.GetLabel(uf_offset + segment_id);
-		
-		
+	    const Seg_t* restrict RLCi = ccl.arena.RLC(slice, row);
+	    const Seg_t segment_count = ccl.arena.Length(slice, row);
+	    const int32_t uf_offset = ccl.row_label[(size_t)slice * height + row];
+	    int32_t* restrict dstrow = ccl.labels.template ptr<int32_t>(slice, row);
+
+	    Seg_t segment_start = 0;
+	    Seg_t segment_end = 0;
+
+	    for (int er = 1; er < segment_count; er += 2) {
+		segment_start = RLCi[er - 1];
+		std::fill(dstrow + segment_end, dstrow + segment_start, 0);
+		segment_end = RLCi[er];
+
+		const int32_t label = ccl.ET.GetLabel(uf_offset + er / 2);
 		std::fill(dstrow + segment_start, dstrow + segment_end, label);
 	    }
 	    std::fill(dstrow + segment_end, dstrow + width, 0);
-
-	    uf_offset += (segment_count / 2);
 	}
     }
-    return nea;
 }
 
 
-template <typename LabelsSolver>
-void Relabeling_Z_Border_V2::Relabel(cv::Mat1i& labels, int32_t*** ERA, int16_t*** RLC,
-				     int16_t** Lengths, LabelsSolver& ET) {
+template <typename LabelsSolver, typename Seg_t>
+void Relabeling_Z_Border_V2::Relabel(cv::Mat1i& labels, int32_t*** ERA, Seg_t*** RLC,
+				     Seg_t** Lengths, LabelsSolver& ET) {
     int width, height, depth;
     int rowstride, slicestride;
 
@@ -422,20 +461,20 @@ void Relabeling_Z_Border_V2::Relabel(cv::Mat1i& labels, int32_t*** ERA, int16_t*
     
     for (int slice = 0; slice < depth; slice++) {	
 	for (int row = 0; row < height; row++) {
-	    const int16_t* restrict RLCi = RLC[slice][row];
+	    const Seg_t* restrict RLCi = RLC[slice][row];
 	    const int32_t* restrict ERAi = ERA[slice][row];
-	    const int16_t rlen = Lengths[slice][row];
+	    const int rlen = Lengths[slice][row];
 	    int32_t* restrict dstrow = labels.ptr<int32_t>(slice, row);
 	    
-	    uint16_t seg_start = 0;
-	    uint16_t seg_end = 0;
+	    int seg_start = 0;
+	    int seg_end = 0;
 	    for (int er = 1; er < rlen; er += 2) {
 	        seg_start = RLCi[er - 1];
 		uint32_t l = ERAi[er / 2];
 		l = ET.GetLabel(l);	       
 		seg_end = RLCi[er];
 		
-		for (uint16_t col = seg_start; col < seg_end; col++) {
+		for (int col = seg_start; col < seg_end; col++) {
 		    dstrow[col] = l;
 		}		
 	    }
@@ -0,0 +1,174 @@
+#ifndef CCL_ALGOS_3D_UNIFICATION_BATCH_HPP
+#define CCL_ALGOS_3D_UNIFICATION_BATCH_HPP
+
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+
+#include <simdhelpers/restrict.hpp>
+
+#include "lsl3dlib/features.hpp"
+#include "lsl3dlib/lsl3d/unification_common.hpp"
+#include "lsl3dlib/solvers/union_find.hpp"
+
+namespace unify {
+
+// Batched unification: the equivalences of a row are recorded first, then resolved together.
+// 1. The row is swept against the neighbour rows without any FindRoot: a segment takes the label
+//    (not necessarily a root) of the first run it touches, and a (label, label) pair is recorded
+//    for each other run. A segment records a label once in a row: repeated pairs are skipped.
+//    A segment touching nothing gets a new label.
+// 2. The pairs are unioned in ET, lowest root wins. The entries of the pairs PREFETCH_DISTANCE
+//    ahead are prefetched (solver::prefetch): the cache misses of the first steps of the
+//    FindRoots overlap instead of stalling the sweep.
+// 3. The segments are added to the features of their roots, once every merge of the row is done:
+//    Features::Merge is only called with roots, as in the other unifications.
+// ERA holds labels of the right sets, not always roots: they are resolved by Flatten.
+
+// Runs of rowb touching [j0a, j1a) from er_b. `a` is TEMP_LABEL or the label of the segment,
+// `last` the label of its last pair. Returns the new end of pairs.
+template <bool Diag = true, typename Seg_t>
+inline int32_t* unification_batch_segment(Seg_t j0a, Seg_t j1a, const Seg_t* restrict rlc_rowb,
+					  const int32_t* restrict era_rowb, Seg_t& er_b,
+					  int32_t& a, int32_t& last, int32_t* restrict pairs);
+
+// Unions of the count pairs
+template <typename LabelsSolver, typename ConfFeatures>
+inline void unification_batch_resolve(const int32_t* restrict pairs, int32_t count,
+				      LabelsSolver& ET, Features& features);
+
+// N: 6, 18 or 26-connectivity
+template <int N>
+struct Unify_SM_Batched_Conn {
+
+    struct Conf {
+	using Label_t = int32_t;
+	using Connectivity = ::Connectivity<N>;
+
+	static constexpr bool ER = false;
+	static constexpr bool ERA = true;
+	static constexpr bool Double = false;
+    };
+
+    static constexpr int32_t PREFETCH_DISTANCE = 8;
+
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static inline void Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi, int32_t* restrict ERAi,
+			     seg_arg_t<Seg_t> segment_count, LabelsSolver& ET,
+			     Features& features,
+			     const int16_t row, const int16_t slice, const seg_arg_t<Seg_t> image_width);
+};
+
+using Unify_SM_Batched = Unify_SM_Batched_Conn<26>;
+
+
+
+// Implementations
+
+template <bool Diag, typename Seg_t>
+int32_t* unification_batch_segment(Seg_t j0a, Seg_t j1a, const Seg_t* restrict rlc_rowb,
+				   const int32_t* restrict era_rowb, Seg_t& er_b, int32_t& a,
+				   int32_t& last, int32_t* restrict pairs) {
+    for_each_overlap<Diag>(j0a, j1a, rlc_rowb, er_b, [&](Seg_t er) {
+	const int32_t b = era_rowb[er / 2];
+	if (a == TEMP_LABEL) {
+	    a = b;
+	    return;
+	}
+	if (b != a && b != last) {
+	    pairs[0] = a;
+	    pairs[1] = b;
+	    pairs += 2;
+	    last = b;
+	}
+    });
+    return pairs;
+}
+
+template <typename LabelsSolver, typename ConfFeatures>
+void unification_batch_resolve(const int32_t* restrict pairs, int32_t count, LabelsSolver& ET,
+			       Features& features) {
+    constexpr int32_t distance = Unify_SM_Batched::PREFETCH_DISTANCE;
+
+    for (int32_t i = 0; i < std::min(count, distance); i++) {
+	solver::prefetch(ET, pairs[2 * i]);
+	solver::prefetch(ET, pairs[2 * i + 1]);
+    }
+    for (int32_t i = 0; i < count; i++) {
+	if (i + distance < count) {
+	    solver::prefetch(ET, pairs[2 * (i + distance)]);
+	    solver::prefetch(ET, pairs[2 * (i + distance) + 1]);
+	}
+	int32_t a = ET.FindRoot(pairs[2 * i]);
+	int32_t r = ET.FindRoot(pairs[2 * i + 1]);
+	if (r < a) {
+	    std::swap(a, r);
+	}
+	if (r != a) {
+	    ET.UpdateTable(r, a);
+	    features.Merge<ConfFeatures>(r, a);
+	}
+    }
+}
+
+template <int N>
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void Unify_SM_Batched_Conn<N>::Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi,
+				     int32_t* restrict ERAi, seg_arg_t<Seg_t> segment_count,
+				     LabelsSolver& ET, Features& features, const int16_t row,
+				     const int16_t slice, const seg_arg_t<Seg_t> image_width) {
+    using Conn = typename Conf::Connectivity;
+    constexpr bool UseFeatures = ConfFeatures::UseVolume || ConfFeatures::UseMoment ||
+	ConfFeatures::UseAABB;
+
+    // At most one pair per overlap, and (segments) + (runs of the row) overlaps with each row
+    const size_t capacity = 2 * ((size_t)segment_count / 2 * 4 + state.len0 / 2 + state.len1 / 2 +
+				 state.len2 / 2 + state.len3 / 2);
+    if (state.eq_pairs.size() < capacity) {
+	state.eq_pairs.resize(capacity);
+    }
+    int32_t* restrict const pairs = state.eq_pairs.data();
+    int32_t* restrict end = pairs;
+
+    Seg_t er0 = 1, er1 = 1, er2 = 1, er3 = 1;
+    for (Seg_t er_a = 1; er_a < segment_count; er_a += 2) {
+	const Seg_t j0a = RLCi[er_a - 1];
+	const Seg_t j1a = RLCi[er_a];
+	int32_t a = TEMP_LABEL;
+	int32_t last = TEMP_LABEL;
+
+	end = unification_batch_segment<Conn::Diag0>(j0a, j1a, state.RLC0, state.ERA0, er0, a,
+						     last, end);
+	if (Conn::Row1) {
+	    end = unification_batch_segment<Conn::Diag1>(j0a, j1a, state.RLC1, state.ERA1, er1, a,
+							 last, end);
+	}
+	end = unification_batch_segment<Conn::Diag2>(j0a, j1a, state.RLC2, state.ERA2, er2, a,
+						     last, end);
+	if (Conn::Row3) {
+	    end = unification_batch_segment<Conn::Diag3>(j0a, j1a, state.RLC3, state.ERA3, er3, a,
+							 last, end);
+	}
+
+	if (a == TEMP_LABEL) {
+	    a = ET.NewLabel();
+	    // The segment itself is added with the others
+	    features.NewComponent3D<ConfFeatures>(a);
+	}
+	ERAi[er_a / 2] = a;
+    }
+
+    unification_batch_resolve<LabelsSolver, ConfFeatures>(pairs, (int32_t)(end - pairs) / 2, ET,
+							   features);
+
+    if (UseFeatures) {
+	for (Seg_t er_a = 1; er_a < segment_count; er_a += 2) {
+	    features.AddSegment3D<ConfFeatures>(ET.FindRoot(ERAi[er_a / 2]), row, slice,
+						RLCi[er_a - 1], RLCi[er_a]);
+	}
+    }
+}
+
+}
+
+#endif // CCL_ALGOS_3D_UNIFICATION_BATCH_HPP
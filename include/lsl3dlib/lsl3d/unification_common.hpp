@@ -4,13 +4,41 @@
 #include <cstdint>
 #include <cassert>
 #include <limits>
+#include <type_traits>
+#include <vector>
 
 #include <simdhelpers/restrict.hpp>
 
+#include <lsl3dlib/rle/rle.hpp>
+
 constexpr uint32_t TEMP_LABEL = std::numeric_limits<int32_t>::max();
 
+// 3D connectivity of a unification: 6 (faces), 18 (faces and edges) or 26 (faces, edges and
+// corners). Row<i>: row i of AdjState holds neighbours (RLC0: previous row of the slice,
+// RLC1..RLC3: rows row - 1, row and row + 1 of the previous slice). Diag<i>: the segments of row i
+// touching the current one by a corner (x - 1 or x + 1) are neighbours.
+template <int N>
+struct Connectivity {
+    static_assert(N == 6 || N == 18 || N == 26, "3D connectivity is 6, 18 or 26");
+
+    static constexpr int value = N;
+
+    static constexpr bool Row0 = true;
+    static constexpr bool Row1 = N != 6;
+    static constexpr bool Row2 = true;
+    static constexpr bool Row3 = N != 6;
+
+    static constexpr bool Diag0 = N != 6;
+    static constexpr bool Diag1 = N == 26;
+    static constexpr bool Diag2 = N != 6;
+    static constexpr bool Diag3 = N == 26;
+};
+
 
 
+// Seg_t: type of the RLC and ER entries (int16_t, or int32_t for rows of 32k pixels and more).
+// It is the encoder's (RLE::Conf::Seg_t): unifications, reductions, feature computations and
+// relabelings have none of their own and deduce it from the rows they are given.
 template <typename Seg_t, typename Label_t>
 struct AdjState {
 
@@ -26,15 +54,15 @@ struct AdjState {
     Label_t* restrict ERA2 = nullptr;
     Label_t* restrict ERA3 = nullptr;
     
-    int16_t* restrict ER0 = nullptr;
-    int16_t* restrict ER1 = nullptr;
-    int16_t* restrict ER2 = nullptr;
-    int16_t* restrict ER3 = nullptr;
+    Seg_t* restrict ER0 = nullptr;
+    Seg_t* restrict ER1 = nullptr;
+    Seg_t* restrict ER2 = nullptr;
+    Seg_t* restrict ER3 = nullptr;
 
-    int16_t len0 = 0;
-    int16_t len1 = 0;
-    int16_t len2 = 0;
-    int16_t len3 = 0;
+    Seg_t len0 = 0;
+    Seg_t len1 = 0;
+    Seg_t len2 = 0;
+    Seg_t len3 = 0;
 
     // Double Lines
     Seg_t* restrict l_RLC0 = nullptr;
@@ -42,8 +70,15 @@ struct AdjState {
     Label_t* restrict l_ERA0 = nullptr;
     Label_t* restrict l_ERA1 = nullptr;
 
-    int16_t l_len0 = 0;
-    int16_t l_len1 = 0;
+    Seg_t l_len0 = 0;
+    Seg_t l_len1 = 0;
+
+    // Rows RLC1..RLC3 combined by Unify_SM_Combined_Z, set by the drivers (RLEArena::ZRLC, ZERA)
+    Seg_t* restrict z_RLC = nullptr;
+    Label_t* restrict z_ERA = nullptr;
+
+    // Equivalences (label, label) of a row recorded by Unify_SM_Batched, grown on demand
+    std::vector<Label_t> eq_pairs;
 
     // For Unification without ERA    
     Label_t uf_offset = 0;
@@ -53,28 +88,56 @@ struct AdjState {
     Label_t uf_offset3 = 0;
 };
 
+// Seg_t is only deduced from the RLC rows: lengths and widths can be passed as any integer type
+template <typename Seg_t>
+using seg_arg_t = typename std::enable_if<true, Seg_t>::type;
+
 // Some utility functions to make unification code clearer
 template <typename Seg_t>
-inline void next_er(int16_t& er, Seg_t& j0, Seg_t& j1, const Seg_t* restrict rlc_row) {
+inline void next_er(Seg_t& er, Seg_t& j0, Seg_t& j1, const Seg_t* restrict rlc_row) {
     j0 = rlc_row[er - 1];
     j1 = rlc_row[er];
     er += 2;
 }
 
+// [j0b, j1b) ends before [j0a, j1a) starts: the segments are not neighbours (ends are exclusive).
+// With Diag, segments touching by a corner (j1b == j0a) are neighbours.
+template <bool Diag, typename Seg_t>
+inline bool seg_before(Seg_t j1b, Seg_t j0a) {
+    return Diag ? j1b < j0a : j1b <= j0a;
+}
+
+// Runs of rowb touching the segment [j0a, j1a) from er_b: overlap(er) is called for each of them,
+// in order. er_b is left on the first run that may touch the next segment of the row.
+// Shared by the segment by segment merges (unification_merge_segment, unification_batch_segment,
+// unification_noera_segment): they only differ by their action on an overlap.
+template <bool Diag, typename Seg_t, typename Overlap>
+inline void for_each_overlap(Seg_t j0a, Seg_t j1a, const Seg_t* restrict rlc_rowb, Seg_t& er_b,
+			     Overlap&& overlap) {
+    // Runs of rowb are disjoint: the runs ending before j0a end before the next segments too
+    while (seg_before<Diag>(rlc_rowb[er_b], j0a)) {
+	er_b += 2;
+    }
+    // No need to check if last run: the sentinels start after every segment
+    for (Seg_t er = er_b; !seg_before<Diag>(j1a, rlc_rowb[er - 1]); er += 2) {
+	overlap(er);
+    }
+}
+
 template <typename Seg_t>
-inline void next_erb(int16_t& er, Seg_t& j0, Seg_t& j1, const Seg_t* restrict rlc_row) {
+inline void next_erb(Seg_t& er, Seg_t& j0, Seg_t& j1, const Seg_t* restrict rlc_row) {
     er += 2;
     j0 = rlc_row[er - 1];
     j1 = rlc_row[er];
 }
 
-template <typename Label_t>
-inline void write_era(int16_t er, Label_t label, Label_t* era_row) {
+template <typename Seg_t, typename Label_t>
+inline void write_era(Seg_t er, Label_t label, Label_t* era_row) {
     era_row[er / 2] = label;
 }
 
 template <typename Seg_t, typename Label_t>
-inline void write_temp(int16_t ert, Label_t label, Seg_t j0t, Seg_t j1t, Seg_t* restrict rlc_rowt,
+inline void write_temp(Seg_t ert, Label_t label, Seg_t j0t, Seg_t j1t, Seg_t* restrict rlc_rowt,
 		       Label_t* restrict era_rowt) {
     assert(j0t < j1t);
     assert(label > 0);
@@ -89,6 +152,57 @@ namespace unify {
 
 static constexpr bool UseCounter = false;
 
+// Connectivity of a Unify policy: Unify::Conf::Connectivity, 26 for the policies without it
+template <typename Unify, typename = void>
+struct connectivity_of {
+    using type = Connectivity<26>;
+};
+
+template <typename Unify>
+struct connectivity_of<Unify, std::void_t<typename Unify::Conf::Connectivity>> {
+    using type = typename Unify::Conf::Connectivity;
+};
+
+template <typename Unify>
+using connectivity_t = typename connectivity_of<Unify>::type;
+
+// Bound of the number of labels created by Unify on a width x height x depth volume, background
+// included: size of the LabelsSolver and of the features of every driver. Without ERA, every
+// segment has its own label. Otherwise a label is created for each segment touching no segment of
+// the rows already unified: at most one voxel out of 4 in 18 and 26-connectivity, but one out of 2
+// in 6-connectivity (checkerboard), plus the segments of the first row and slice.
+template <typename Unify>
+inline size_t max_labels(int width, int height, int depth) {
+    if (!Unify::Conf::ERA) {
+	return (size_t)height * depth * ((width + 1) / 2) + 1;
+    }
+    const size_t size = (size_t)width * height * depth;
+    const size_t voxels = connectivity_t<Unify>::value == 6 ? size / 2 : size / 4;
+    return voxels + (size_t)height * depth + width + 1;
+}
+
+// Unify::Conf::CompactER: the ER rows are rle::CompactER rows built by the driver from the RLC
+// rows. false for the policies without it.
+template <typename Unify, typename = void>
+struct compact_er_of : std::false_type {};
+
+template <typename Unify>
+struct compact_er_of<Unify, std::void_t<decltype(Unify::Conf::CompactER)>>
+    : std::integral_constant<bool, Unify::Conf::CompactER> {};
+
+template <typename Unify>
+constexpr bool compact_er_v = compact_er_of<Unify>::value;
+
+}
+
+namespace algo {
+
+// Index in the ERA row of the segment ending at RLC entry `er` (odd)
+template <typename Seg_t>
+inline uint32_t to_era_index(Seg_t er) {
+    return static_cast<uint32_t>(er) / 2;
+}
+
 }
 
 #endif // CCL_ALGOS_3D_UNIFICATION_COMMON_HPP
@@ -20,30 +20,29 @@ namespace unify {
 
 
 // Unification with temporary segments
-template <typename LabelsSolver, typename ConfFeatures>
-void unification_double_step1(const int16_t* restrict RLCi, int32_t* restrict ERAi, int16_t len,
-			      AdjState<int16_t, int32_t>& state, LabelsSolver& ET, Features& features,
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void unification_double_step1(const Seg_t* restrict RLCi, int32_t* restrict ERAi, Seg_t len,
+			      AdjState<Seg_t, int32_t>& state, LabelsSolver& ET, Features& features,
 			       const int16_t row, const int16_t slice, StateCounters& counters);
 
 // Unify temporary lines.
-template <typename LabelsSolver, typename ConfFeatures>
-void unification_combined_temp_segments(AdjState<int16_t, int32_t>& state, LabelsSolver& ET, Features& features,
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void unification_combined_temp_segments(AdjState<Seg_t, int32_t>& state, LabelsSolver& ET, Features& features,
 					StateCounters& counters);
 
 
 
 
 // Unify + Pipeline
-template <typename LabelsSolver, typename ConfFeatures>
-void unification_double_pipeline(const int16_t* restrict RLCi, int32_t* restrict ERAi,
-				 const int16_t len, AdjState<int16_t, int32_t>& state, LabelsSolver& ET, Features& features,
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void unification_double_pipeline(const Seg_t* restrict RLCi, int32_t* restrict ERAi,
+				 const Seg_t len, AdjState<Seg_t, int32_t>& state, LabelsSolver& ET, Features& features,
 				 const int16_t row, const int16_t slice, StateCounters& counters);
 
 
 struct Unify_SM_Double {
 
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
 	
 	static constexpr bool ER = false;
@@ -51,17 +50,17 @@ struct Unify_SM_Double {
 	static constexpr bool Double = true;
     };
     
-    template <typename LabelsSolver, typename ConfFeatures>
-    static inline void Unify(AdjState<int16_t, int32_t>& state, int16_t* restrict RLCi, int32_t* restrict ERAi,
-			     int16_t segment_count, LabelsSolver& ET, Features& features,
-			     const int16_t row, const int16_t slice, const int16_t image_width) {
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static inline void Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi, int32_t* restrict ERAi,
+			     seg_arg_t<Seg_t> segment_count, LabelsSolver& ET, Features& features,
+			     const int16_t row, const int16_t slice, const seg_arg_t<Seg_t> image_width) {
 
 	StateCounters counters;
 	unification_double_step1<LabelsSolver, ConfFeatures>(
 	    RLCi, ERAi, segment_count, state, ET, features, row, slice, counters);
 	
-        state.l_RLC1[state.l_len1]     = INT16_MAX - 1;
-        state.l_RLC1[state.l_len1 + 1] = INT16_MAX - 1;
+        state.l_RLC1[state.l_len1]     = rle::rle_sentinel<Seg_t>();
+        state.l_RLC1[state.l_len1 + 1] = rle::rle_sentinel<Seg_t>();
 	// Unify both columns
 	unification_combined_temp_segments<LabelsSolver, ConfFeatures>(state, ET, features, counters);
     }
@@ -70,7 +69,6 @@ struct Unify_SM_Double {
 struct Unify_SM_Double_PL {
 
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
 
 	static constexpr bool ER = false;
@@ -78,34 +76,34 @@ struct Unify_SM_Double_PL {
 	static constexpr bool Double = true;
     };
     
-    template <typename LabelsSolver, typename ConfFeatures>
-    static inline void Unify(AdjState<int16_t, int32_t>& state, int16_t* restrict RLCi, int32_t* restrict ERAi,
-			     int16_t segment_count, LabelsSolver& ET, Features& features,
-			     const int16_t row, const int16_t slice, const int16_t image_width) {
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static inline void Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi, int32_t* restrict ERAi,
+			     seg_arg_t<Seg_t> segment_count, LabelsSolver& ET, Features& features,
+			     const int16_t row, const int16_t slice, const seg_arg_t<Seg_t> image_width) {
 
 	StateCounters counters;
 	unification_double_pipeline<LabelsSolver, ConfFeatures>(
 	    RLCi, ERAi, segment_count, state, ET, features, row, slice, counters);
 	
-        state.l_RLC1[state.l_len1]     = INT16_MAX - 1;
-	state.l_RLC1[state.l_len1 + 1] = INT16_MAX - 1;
+        state.l_RLC1[state.l_len1]     = rle::rle_sentinel<Seg_t>();
+	state.l_RLC1[state.l_len1 + 1] = rle::rle_sentinel<Seg_t>();
     }
 };
 
 
-template <typename LabelsSolver, typename ConfFeatures>
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
 __attribute__((always_inline))
-void merge_segment_with(const int16_t ia, const int16_t ib,
-			const int16_t* restrict rlc0, const int32_t* restrict era0,
-			int16_t len0, int16_t& restrict ia0, int16_t& restrict ib0,
-			int16_t& restrict er0,
+void merge_segment_with(const Seg_t ia, const Seg_t ib,
+			const Seg_t* restrict rlc0, const int32_t* restrict era0,
+			Seg_t len0, Seg_t& restrict ia0, Seg_t& restrict ib0,
+			Seg_t& restrict er0,
 			int32_t& restrict a, LabelsSolver& ET, Features& features) {
 
     
     
     int32_t r; 
 
-    int16_t dbg_counter = 0;
+    int dbg_counter = 0;
     
     while (ib0 < ia) {
 	next_erb(er0, ia0, ib0, rlc0);
@@ -136,14 +134,14 @@ void merge_segment_with(const int16_t ia, const int16_t ib,
 
 
 // Unification with temporary segments
-template <typename LabelsSolver, typename ConfFeatures>
-void unification_double_step1(const int16_t* restrict RLCi, int32_t* restrict ERAi, int16_t len,
-			       AdjState<int16_t, int32_t>& state, LabelsSolver& ET, Features& features,
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void unification_double_step1(const Seg_t* restrict RLCi, int32_t* restrict ERAi, Seg_t len,
+			       AdjState<Seg_t, int32_t>& state, LabelsSolver& ET, Features& features,
 			       const int16_t row, const int16_t slice, StateCounters& counters) {
-    int16_t j0a, j1a;
-    int16_t j0b, j1b;
-    int16_t j0t, j1t;
-    int16_t er_a = 1, er_b = 1, er_t = 1;
+    Seg_t j0a, j1a;
+    Seg_t j0b, j1b;
+    Seg_t j0t, j1t;
+    Seg_t er_a = 1, er_b = 1, er_t = 1;
     int32_t a, ea_b;
     int32_t r;
     
@@ -340,17 +338,17 @@ void unification_double_step1(const int16_t* restrict RLCi, int32_t* restrict ER
     return;    
 }
 
-template <typename LabelsSolver, typename ConfFeatures>
-void unification_combined_temp_segments(AdjState<int16_t, int32_t>& state, LabelsSolver& ET, Features& features,
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void unification_combined_temp_segments(AdjState<Seg_t, int32_t>& state, LabelsSolver& ET, Features& features,
 					StateCounters& counters) {
     
-    int16_t j0a, j1a;
-    int16_t j0b, j1b;
-    int16_t er_a, er_b;
+    Seg_t j0a, j1a;
+    Seg_t j0b, j1b;
+    Seg_t er_a, er_b;
     int32_t a;
     int32_t r;
 
-    int16_t len = state.l_len0;
+    Seg_t len = state.l_len0;
 
     
     // Nothing to merge
@@ -429,12 +427,12 @@ void unification_combined_temp_segments(AdjState<int16_t, int32_t>& state, Label
 
 
 
-template <typename LabelsSolver, typename ConfFeatures>
-inline int32_t unification_prev_temp(int16_t j0t, int16_t j1t, int32_t r,
-				     int16_t& restrict j0t2, int16_t& restrict j1t2, 
-				     const int16_t* restrict rlc_rowt2,
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+inline int32_t unification_prev_temp(Seg_t j0t, Seg_t j1t, int32_t r,
+				     Seg_t& restrict j0t2, Seg_t& restrict j1t2, 
+				     const Seg_t* restrict rlc_rowt2,
 				     const int32_t* restrict era_rowt2,
-				     int16_t& restrict ert2,
+				     Seg_t& restrict ert2,
 				     LabelsSolver& ET, Features& features) {
     int32_t r2;
     while (j1t2 < j0t) {
@@ -469,19 +467,18 @@ inline int32_t unification_prev_temp(int16_t j0t, int16_t j1t, int32_t r,
 
 // Unfication with temporary columns and a pipeline. This is implemented as a state machine and uses
 // gotos
-template <typename LabelsSolver, typename ConfFeatures>
-void unification_double_pipeline(const int16_t* restrict RLCi, int32_t* restrict ERAi,
-				 const int16_t len, AdjState<int16_t, int32_t>& state, LabelsSolver& ET, Features& features,
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void unification_double_pipeline(const Seg_t* restrict RLCi, int32_t* restrict ERAi,
+				 const Seg_t len, AdjState<Seg_t, int32_t>& state, LabelsSolver& ET, Features& features,
 				 const int16_t row, const int16_t slice, StateCounters& counters) {
 
-    using Seg_t = int16_t;
     using Label_t = int32_t;
     
     Seg_t j0a, j1a;
     Seg_t j0b, j1b;
     Seg_t j0t, j1t;
     Seg_t j0t2, j1t2;
-    int16_t er = 1, erb = 1, ert = 1, ert2 = 1;
+    Seg_t er = 1, erb = 1, ert = 1, ert2 = 1;
     Label_t a, ea_b;
     Label_t r;
 
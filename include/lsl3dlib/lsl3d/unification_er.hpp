@@ -4,6 +4,7 @@
 #include <cstdint>
 
 #include <lsl3dlib/lsl/lsl_utils.hpp>
+#include <lsl3dlib/rle/compact_er.hpp>
 #include "lsl3dlib/lsl3d/unification_common.hpp"
 #include <lsl3dlib/features.hpp>
 
@@ -15,72 +16,123 @@ namespace unify {
 
 // Utility functions
 
-inline void lsl_get_segment(const int16_t* restrict rlc_row, int32_t er, int32_t width,
-			    int16_t& segment_start, int16_t& segment_end);
+// Pixels of the neighbour rows to check for the segment er: the segment, and its corner neighbours
+// with Diag
+template <bool Diag = true, typename Seg_t>
+inline void lsl_get_segment(const Seg_t* restrict rlc_row, int32_t er, int32_t width,
+			    Seg_t& segment_start, Seg_t& segment_end);
 
-inline void lsl_get_segmentz(const int16_t* restrict rlc_row, int16_t er, int32_t width,
-		      int16_t& segment_start, int16_t& segment_end);
+template <bool Diag = true, typename Seg_t>
+inline void lsl_get_segmentz(const Seg_t* restrict rlc_row, Seg_t er, int32_t width,
+		      Seg_t& segment_start, Seg_t& segment_end);
 
-template <typename LabelsSolver, typename ConfFeatures>
-inline void lsl_3d_combine(int16_t er, int16_t segment_start, int16_t segment_end,
-			   const int16_t* restrict ER0, int32_t* restrict ERA0,
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+inline void lsl_3d_combine(int32_t er, Seg_t segment_start, Seg_t segment_end,
+			   const Seg_t* restrict ER0, int32_t* restrict ERA0,
 			   int32_t& restrict label, LabelsSolver ET,
 			   Features& features,
 			   const int16_t row, const int16_t slice);
 
-template <typename LabelsSolver, typename ConfFeatures>
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
 inline void unification_er(
-    int32_t width, int32_t height, int16_t* restrict ER0, int16_t* restrict ER1, int32_t*** ERA,
-    int16_t * restrict rlc_row, int32_t* restrict era_row,
+    int32_t width, int32_t height, Seg_t* restrict ER0, Seg_t* restrict ER1, int32_t*** ERA,
+    Seg_t * restrict rlc_row, int32_t* restrict era_row,
     int32_t segment_count, LabelsSolver ET, Features& features, int32_t row,
     int32_t slice, int32_t& nea);
 
-template <typename LabelsSolver, typename ConfFeatures>
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
 inline void unification_z_er(
-    int32_t width, int32_t height, int16_t* restrict ER0, int16_t* restrict ER1, int32_t*** ERA,
-    int16_t * restrict rlc_row, int32_t* restrict era_row,
+    int32_t width, int32_t height, Seg_t* restrict ER0, Seg_t* restrict ER1, int32_t*** ERA,
+    Seg_t * restrict rlc_row, int32_t* restrict era_row,
     int32_t segment_count, LabelsSolver& ET, Features& features,
     int32_t row, int32_t slice, int32_t& nea);
     
 
-template <typename LabelsSolver, typename ConfFeatures>
-void unification_z_er(int16_t * restrict RLCi, int32_t* restrict ERAi, int32_t len,
-		      AdjState<int16_t, int32_t>& state, LabelsSolver& ET,
+// [segment_start, segment_end) against the row of ER0/ERA0, with its corner neighbours with Diag.
+// Compact: ER0 is a rle::CompactER row of er_words words.
+template <typename LabelsSolver, typename ConfFeatures, bool Diag = true, bool Compact = false,
+	  typename Seg_t>
+inline void lsl_combine_z(int32_t er, Seg_t segment_start, Seg_t segment_end,
+			  const Seg_t* restrict ER0, int32_t* restrict ERA0, int32_t& restrict label,
+			  LabelsSolver& ET, Features& features, const int16_t row,
+			  const int16_t slice, size_t er_words = 0);
+
+// Only the rows of Conn (Connectivity) are read. Compact: the ER rows of state are
+// rle::CompactER rows.
+template <typename LabelsSolver, typename ConfFeatures, typename Conn = Connectivity<26>,
+	  bool Compact = false, typename Seg_t>
+void unification_z_er(Seg_t * restrict RLCi, int32_t* restrict ERAi, int32_t len,
+		      AdjState<Seg_t, int32_t>& state, LabelsSolver& ET,
 		      Features& features, int16_t row, int16_t slice,
-		      int16_t image_width);
+		      Seg_t image_width);
 
 
-struct Unify_ER {
+// N: 6, 18 or 26-connectivity
+template <int N>
+struct Unify_ER_Conn {
     
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
+	using Connectivity = ::Connectivity<N>;
 
 	static constexpr bool ER = true;
 	static constexpr bool ERA = true;
 	static constexpr bool Double = false;
     };
 
-    template <typename LabelsSolver, typename ConfFeatures>
-    static inline void Unify(AdjState<int16_t, int32_t>& state, int16_t* restrict RLCi, int32_t* restrict ERAi,
-			     int16_t segment_count, LabelsSolver& ET,
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static inline void Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi, int32_t* restrict ERAi,
+			     seg_arg_t<Seg_t> segment_count, LabelsSolver& ET,
 			     Features& features, const int16_t row,
-			     const int16_t slice, int16_t image_width) {
+			     const int16_t slice, seg_arg_t<Seg_t> image_width) {
 	
-        unification_z_er<LabelsSolver&, ConfFeatures>(RLCi, ERAi, segment_count, state, ET, features,
-						     row, slice, image_width);
+        unification_z_er<LabelsSolver&, ConfFeatures, typename Conf::Connectivity>(
+	    RLCi, ERAi, segment_count, state, ET, features, row, slice, image_width);
     }
 };
 
+using Unify_ER = Unify_ER_Conn<26>;
+
+// Unify_ER on compact ER rows (rle::CompactER): the drivers build them from the RLC rows, any
+// encoder can be used (Conf::ER = false). ER0[x] is a rank in a bitmap of the run boundaries.
+template <int N>
+struct Unify_ER_Compact_Conn {
+
+    struct Conf {
+	using Label_t = int32_t;
+	using Connectivity = ::Connectivity<N>;
+
+	static constexpr bool ER = false;
+	static constexpr bool CompactER = true;
+	static constexpr bool ERA = true;
+	static constexpr bool Double = false;
+    };
+
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static inline void Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi, int32_t* restrict ERAi,
+			     seg_arg_t<Seg_t> segment_count, LabelsSolver& ET,
+			     Features& features, const int16_t row,
+			     const int16_t slice, seg_arg_t<Seg_t> image_width) {
+	unification_z_er<LabelsSolver&, ConfFeatures, typename Conf::Connectivity, true>(
+	    RLCi, ERAi, segment_count, state, ET, features, row, slice, image_width);
+    }
+};
+
+using Unify_ER_Compact = Unify_ER_Compact_Conn<26>;
+
 
 
 // Implementations
 
-void lsl_get_segment(const int16_t* restrict rlc_row, int32_t er, int32_t width,
-		     int16_t& segment_start, int16_t& segment_end) {
+template <bool Diag, typename Seg_t>
+void lsl_get_segment(const Seg_t* restrict rlc_row, int32_t er, int32_t width,
+		     Seg_t& segment_start, Seg_t& segment_end) {
     segment_start = rlc_row[er - 1];
     segment_end =   rlc_row[er];
 
+    if (!Diag) {
+	return;
+    }
     // Take care of corner neighbours
     if (segment_start > 0) {
 	segment_start--;
@@ -90,11 +142,15 @@ void lsl_get_segment(const int16_t* restrict rlc_row, int32_t er, int32_t width,
     }
 }
 
-void lsl_get_segmentz(const int16_t* restrict rlc_row, int16_t er, int32_t width,
-		     int16_t& segment_start, int16_t& segment_end) {
+template <bool Diag, typename Seg_t>
+void lsl_get_segmentz(const Seg_t* restrict rlc_row, Seg_t er, int32_t width,
+		     Seg_t& segment_start, Seg_t& segment_end) {
     segment_start = rlc_row[er - 1];
     segment_end =   rlc_row[er] - 1; // Take care of zero addressing
 
+    if (!Diag) {
+	return;
+    }
     // Take care of corner neighbours
     if (segment_start > 0) {
 	segment_start--;
@@ -104,15 +160,15 @@ void lsl_get_segmentz(const int16_t* restrict rlc_row, int16_t er, int32_t width
     }
 }
 
-template <typename LabelsSolver, typename ConfFeatures>
-void lsl_3d_combine(int16_t er, int16_t segment_start, int16_t segment_end,
-		    const int16_t* restrict ER0, int32_t* restrict ERA0, int32_t& restrict label,
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void lsl_3d_combine(int32_t er, Seg_t segment_start, Seg_t segment_end,
+		    const Seg_t* restrict ER0, int32_t* restrict ERA0, int32_t& restrict label,
 		    LabelsSolver& ET, Features& features, const int16_t row,
 		    const int16_t slice) {
 
     
-    int16_t er0 = ER0[segment_start];
-    int16_t er1 = ER0[segment_end];
+    Seg_t er0 = ER0[segment_start];
+    Seg_t er1 = ER0[segment_end];
 
     // Does not work
     if (er0 % 2 == 0) {
@@ -139,7 +195,7 @@ void lsl_3d_combine(int16_t er, int16_t segment_start, int16_t segment_end,
 	    features.AddSegment3D<ConfFeatures>(ancestor, row, slice, segment_start, segment_end);
 	}
 	
-	for (int16_t erk = er0 + 2; erk <= er1; erk += 2) {
+	for (Seg_t erk = er0 + 2; erk <= er1; erk += 2) {
 	    segment_id = ::algo::to_era_index(erk);
 	    int32_t eak = ERA0[segment_id];
 	    int32_t ancestork = ET.FindRoot(eak);
@@ -147,7 +203,7 @@ void lsl_3d_combine(int16_t er, int16_t segment_start, int16_t segment_end,
 		ET.UpdateTable(ancestork, ancestor);
 		features.Merge<ConfFeatures>(ancestork, ancestor);
 	    } else if (ancestor > ancestork) {
-		ET.UpdateTAble(ancestor, ancestork);
+		ET.UpdateTable(ancestor, ancestork);
 		features.Merge<ConfFeatures>(ancestor, ancestork);
 		ancestor = ancestork;
 	    }
@@ -156,15 +212,22 @@ void lsl_3d_combine(int16_t er, int16_t segment_start, int16_t segment_end,
     } 
 }
 
-template <typename LabelsSolver, typename ConfFeatures>
-void lsl_combine_z(int16_t er, int16_t segment_start, int16_t segment_end,
-		    const int16_t* restrict ER0, int32_t* restrict ERA0, int32_t& restrict label,
+template <typename LabelsSolver, typename ConfFeatures, bool Diag, bool Compact, typename Seg_t>
+void lsl_combine_z(int32_t er, Seg_t segment_start, Seg_t segment_end,
+		    const Seg_t* restrict ER0, int32_t* restrict ERA0, int32_t& restrict label,
 		   LabelsSolver& ET, Features& features, const int16_t row,
-		   const int16_t slice) {
-
-    // Note: ER0 is expected to have left and right borders
-    int16_t er0 = ER0[segment_start - 1]; 
-    int16_t er1 = ER0[segment_end];    
+		   const int16_t slice, size_t er_words) {
+
+    // Note: ER0 is expected to have left and right borders (corner neighbours of the first and
+    // last pixels)
+    Seg_t er0, er1;
+    if (Compact) {
+	er0 = rle::CompactER<Seg_t>::Get(ER0, er_words, segment_start - Diag);
+	er1 = rle::CompactER<Seg_t>::Get(ER0, er_words, segment_end - !Diag);
+    } else {
+	er0 = ER0[segment_start - Diag];
+	er1 = ER0[segment_end - !Diag];
+    }
     
     // Does not work
     if (er0 % 2 == 0) {
@@ -192,7 +255,7 @@ void lsl_combine_z(int16_t er, int16_t segment_start, int16_t segment_end,
 	    
 	}
 	
-	for (int16_t erk = er0 + 2; erk <= er1; erk += 2) {
+	for (Seg_t erk = er0 + 2; erk <= er1; erk += 2) {
 	    segment_id = ::algo::to_era_index(erk);
 	    int32_t eak = ERA0[segment_id];
 	    int32_t ancestork = ET.FindRoot(eak);
@@ -215,10 +278,10 @@ void lsl_combine_z(int16_t er, int16_t segment_start, int16_t segment_end,
 
 
 
-template <typename LabelsSolver, typename ConfFeatures>
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
 void unification_er(
-    int32_t width, int32_t height, int16_t* restrict ER0, int16_t* restrict ER1, int32_t*** ERA,
-    int16_t * restrict rlc_row, int32_t* restrict era_row,
+    int32_t width, int32_t height, Seg_t* restrict ER0, Seg_t* restrict ER1, int32_t*** ERA,
+    Seg_t * restrict rlc_row, int32_t* restrict era_row,
     int32_t segment_count, LabelsSolver& ET, Features& features, int32_t row,
     int32_t slice, int32_t& nea) {
 
@@ -228,10 +291,10 @@ void unification_er(
 
     // Get the correct pointers for each row in the ER0/1 matrices
     // Also handles the borders at the beginning of each slice (line_border)
-    const int16_t* restrict er0_row = ER1 + row_pitch * (row - 1) + line_border;
-    const int16_t* restrict er1_row = ER0 + row_pitch * row + line_border;
-    const int16_t* restrict er2_row = er1_row - row_pitch;
-    const int16_t* restrict er3_row = er1_row + row_pitch;
+    const Seg_t* restrict er0_row = ER1 + row_pitch * (row - 1) + line_border;
+    const Seg_t* restrict er1_row = ER0 + row_pitch * row + line_border;
+    const Seg_t* restrict er2_row = er1_row - row_pitch;
+    const Seg_t* restrict er3_row = er1_row + row_pitch;
 
     // There may be an aliasing in the case of empty lines.
     // This should't an issue however as the content of an empty is never accessed
@@ -240,9 +303,9 @@ void unification_er(
     int32_t* restrict ERA2 = ERA[slice - 1][row - 1];
     int32_t* restrict ERA3 = ERA[slice - 1][row + 1];
     
-    int16_t ner = segment_count;
+    Seg_t ner = segment_count;
     for (int32_t er = 1; er < ner; er += 2) {
-	int16_t segment_start, segment_end;
+	Seg_t segment_start, segment_end;
 	lsl_get_segment(rlc_row, er, width, segment_start, segment_end);
 	
 	int32_t label = INT32_MAX;
@@ -262,43 +325,49 @@ void unification_er(
 	    features.NewComponent3D<ConfFeatures>(label, row, slice, segment_start, segment_end + 1);
 	    nea = label;
 	}
-	const int16_t era_offset = er / 2;
+	const uint32_t era_offset = er / 2;
 	era_row[era_offset] = label;
     }
 }
 
 
 
-template <typename LabelsSolver, typename ConfFeatures>
-void unification_z_er(int16_t * restrict RLCi, int32_t* restrict ERAi, int32_t len,
-		      AdjState<int16_t, int32_t>& state, LabelsSolver& ET,
+template <typename LabelsSolver, typename ConfFeatures, typename Conn, bool Compact,
+	  typename Seg_t>
+void unification_z_er(Seg_t * restrict RLCi, int32_t* restrict ERAi, int32_t len,
+		      AdjState<Seg_t, int32_t>& state, LabelsSolver& ET,
 		      Features& features, int16_t row, int16_t slice,
-		      int16_t image_width) {
+		      Seg_t image_width) {
     int32_t label;
+    const size_t words = Compact ? rle::CompactER<Seg_t>::Words(image_width) : 0;
     
     for (int32_t er = 1; er < len; er += 2) {
-	int16_t segment_start, segment_end;
+	Seg_t segment_start, segment_end;
 	//lsl_get_segmentz(RLCi, er, image_width, segment_start, segment_end);
 
 	segment_start = RLCi[er - 1];
 	segment_end   = RLCi[er];
 	
         label = INT32_MAX;
-        lsl_combine_z<LabelsSolver, ConfFeatures>(
+        lsl_combine_z<LabelsSolver, ConfFeatures, Conn::Diag0, Compact>(
 	    er, segment_start, segment_end, state.ER0, state.ERA0, label, ET, features,
-	    row, slice);
+	    row, slice, words);
 	
-	lsl_combine_z<LabelsSolver, ConfFeatures>(
-	    er, segment_start, segment_end, state.ER1, state.ERA1, label, ET, features,
-	    row, slice);
+	if (Conn::Row1) {
+	    lsl_combine_z<LabelsSolver, ConfFeatures, Conn::Diag1, Compact>(
+		er, segment_start, segment_end, state.ER1, state.ERA1, label, ET, features,
+		row, slice, words);
+	}
 	
-	lsl_combine_z<LabelsSolver, ConfFeatures>(
+	lsl_combine_z<LabelsSolver, ConfFeatures, Conn::Diag2, Compact>(
 	    er, segment_start, segment_end, state.ER2, state.ERA2, label, ET, features,
-	    row, slice);
+	    row, slice, words);
 	
-	lsl_combine_z<LabelsSolver, ConfFeatures>(
-	    er, segment_start, segment_end, state.ER3, state.ERA3, label, ET, features,
-	    row, slice);
+	if (Conn::Row3) {
+	    lsl_combine_z<LabelsSolver, ConfFeatures, Conn::Diag3, Compact>(
+		er, segment_start, segment_end, state.ER3, state.ERA3, label, ET, features,
+		row, slice, words);
+	}
 
 	// If label == EQ.Size() => No neighbour has been found
 	// Therefore create a new label
@@ -307,36 +376,36 @@ void unification_z_er(int16_t * restrict RLCi, int32_t* restrict ERAi, int32_t l
 	    //std::cout << "NewLabel() = " << label << "\n";
 	    features.NewComponent3D<ConfFeatures>(label, row, slice, segment_start, segment_end);
 	}
-	const int16_t era_offset = ::algo::to_era_index(er);
+	const uint32_t era_offset = ::algo::to_era_index(er);
         ERAi[era_offset] = label;
     }
 }
 
-template <typename LabelsSolver, typename ConfFeatures>
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
 void unification_z_er_double(
-    const int16_t* restrict ER0, const int16_t* restrict ER1,
-    const int16_t * restrict rlc1, const int16_t* rlc0,
-    int32_t* restrict era0, int16_t len0,
-    const int32_t* restrict era1, int16_t len1,
-    int16_t* restrict rlct,
-    int32_t* restrict erat, int16_t& lent, LabelsSolver& ET,
+    const Seg_t* restrict ER0, const Seg_t* restrict ER1,
+    const Seg_t * restrict rlc1, const Seg_t* rlc0,
+    int32_t* restrict era0, Seg_t len0,
+    const int32_t* restrict era1, Seg_t len1,
+    Seg_t* restrict rlct,
+    int32_t* restrict erat, Seg_t& lent, LabelsSolver& ET,
     Features& features, const int16_t row, const int16_t slice) {
 
 
-    int16_t er0 = 1, er1 = 1, ert = 1;
+    Seg_t er0 = 1, er1 = 1, ert = 1;
     int32_t label = INT32_MAX;
     int32_t ancestor = -1;
 
-    int16_t segment_start0, segment_end0; 
-    int16_t segment_start1, segment_end1;
-    int16_t segment_start = -1, segment_end = -1;
+    Seg_t segment_start0, segment_end0; 
+    Seg_t segment_start1, segment_end1;
+    Seg_t segment_start = -1, segment_end = -1;
 
     // For each segment on the current line
     for (er1 = 1; er1 < len1; er1 += 2) {
 
 	lsl_get_segmentz(rlc1, er1, len1, segment_start1, segment_end1);
 
-	int16_t sbeg0, send0;
+	Seg_t sbeg0, send0;
 	sbeg0 = ER0[segment_start1];
 	send0 = ER0[segment_end1];
 	if (sbeg0 % 2 == 0) {
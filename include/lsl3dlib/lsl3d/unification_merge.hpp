@@ -2,6 +2,7 @@
 #define CCL_ALGOS_3D_UNIFICATION_MERGE_HPP
 
 #include <cstdint>
+#include <algorithm>
 
 #include "lsl3dlib/lsl3d/unification_stats.hpp"
 #include "lsl3dlib/lsl3d/unification_common.hpp"
@@ -19,61 +20,77 @@ namespace unify {
 // 2. Merge with 2 other rows and use the temporary label to check if it is transisitve or not
 // 3. Merge with the last row, use the temporary label during individual merges and finally create
 // a new label if a segment was never merged
+// The transitions of the state machines are recorded in `counters` when Count is set (see
+// unification_stats.hpp, UseCounter by default).
 
-template <typename LabelsSolver, typename FeaturesConf>
-inline void unification_merge_first(const int16_t* restrict rlc_rowa, int16_t len_a,
-				    const int16_t* restrict rlc_rowb, int16_t len_b,
+template <typename LabelsSolver, typename FeaturesConf, bool Diag = true, bool Count = UseCounter,
+	  typename Seg_t>
+inline void unification_merge_first(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+				    const Seg_t* restrict rlc_rowb, Seg_t len_b,
 				    int32_t* restrict era_rowa, int32_t* restrict era_rowb,
 				    LabelsSolver& ET, Features& features, const int16_t row, const int16_t slice,
 				    StateCounters& counters);
 
-template <typename LabelsSolver, typename FeaturesConf>
-inline void unification_merge_transitive(const int16_t* restrict rlc_rowa, int16_t len_a,
-					 const int16_t* restrict rlc_rowb, int16_t len_b,
+template <typename LabelsSolver, typename FeaturesConf, bool Diag = true, bool Count = UseCounter,
+	  typename Seg_t>
+inline void unification_merge_transitive(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+					 const Seg_t* restrict rlc_rowb, Seg_t len_b,
 					 int32_t* restrict era_rowa, int32_t* restrict era_rowb,
 					 LabelsSolver& ET, Features& features, const int16_t row, const int16_t slice,
 					 StateCounters& counters);
 
-template <typename LabelsSolver, typename FeaturesConf>
-inline void unification_merge_last(const int16_t* restrict rlc_rowa, int16_t len_a,
-				   const int16_t* restrict rlc_rowb, int16_t len_b,
+template <typename LabelsSolver, typename FeaturesConf, bool Diag = true, bool Count = UseCounter,
+	  typename Seg_t>
+inline void unification_merge_last(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+				   const Seg_t* restrict rlc_rowb, Seg_t len_b,
 				   int32_t* restrict era_rowa, int32_t* restrict era_rowb,
 				   LabelsSolver& ET, Features& features, const int16_t row, const int16_t slice,
 				   StateCounters& counters);
 
 
 
-// Second way: Generalization of the 2 row merge
-// TODO: The state machine is more complex
-template <typename LabelsSolver, typename FeaturesConf>
-void unification_merge_generalized(int16_t const* restrict rlc_row, int16_t len,
-		      int16_t const* restrict rlc_row0, int16_t len0,
-		      int16_t const* restrict rlc_row1, int16_t len1,
-		      int16_t const* restrict rlc_row2, int16_t len2,
-		      int16_t const* restrict rlc_row3, int16_t len3,
+// Second way: Generalization of the 2 row merge. The row is read once: each segment is merged
+// with the 4 rows in turn (unification_merge_segment), keeping one position per row, and gets a
+// new label when it was not merged. Only the rows of Conn (Connectivity) are read.
+template <typename LabelsSolver, typename FeaturesConf, typename Conn = Connectivity<26>,
+	  typename Seg_t>
+void unification_merge_generalized(Seg_t const* restrict rlc_row, Seg_t len,
+		      Seg_t const* restrict rlc_row0, Seg_t len0,
+		      Seg_t const* restrict rlc_row1, Seg_t len1,
+		      Seg_t const* restrict rlc_row2, Seg_t len2,
+		      Seg_t const* restrict rlc_row3, Seg_t len3,
 		      int32_t* restrict era_rowa,
 		      int32_t* restrict era_row0,
 		      int32_t* restrict era_row1,
 		      int32_t* restrict era_row2,
 		      int32_t* restrict era_row3,
-		      LabelsSolver& ET, Features& features);
+		      LabelsSolver& ET, Features& features, const int16_t row, const int16_t slice);
+
+// Merge of the segment [j0a, j1a) with the runs of rowb from er_b. a is TEMP_LABEL or a root
+// (the smallest of the merged ones), er_b is left on the first run that may touch the next
+// segment.
+template <typename LabelsSolver, typename FeaturesConf, bool Diag = true, typename Seg_t>
+inline void unification_merge_segment(Seg_t j0a, Seg_t j1a, const Seg_t* restrict rlc_rowb,
+				      const int32_t* restrict era_rowb, Seg_t& er_b, int32_t& a,
+				      LabelsSolver& ET, Features& features, const int16_t row,
+				      const int16_t slice);
 
 // Third way: Similar as the first one but instead of allocating temporary labels, labels are
 // allocated in the union find structure
 // 2 Steps:
 // 1. Merge with the first row and create a new label if no adjacent segement
 // 2. Merge with the other rows.
-template <typename LabelsSolver, typename FeaturesConf>
-inline void unification_merge_first_bis(const int16_t* restrict rlc_rowa, int16_t len_a,
-					const int16_t* restrict rlc_rowb, int16_t len_b,
+template <typename LabelsSolver, typename FeaturesConf, typename Seg_t>
+inline void unification_merge_first_bis(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+					const Seg_t* restrict rlc_rowb, Seg_t len_b,
 					int32_t* restrict era_rowa,
 					int32_t* restrict era_rowb,
 					LabelsSolver& ET, Features& features, const int16_t row, const int16_t slice,
 					StateCounters& counters);
 
-template <typename LabelsSolver, typename FeaturesConf>
-inline void unification_merge_transitive_bis(const int16_t* restrict rlc_rowa, int16_t len_a,
-					     const int16_t* restrict rlc_rowb, int16_t len_b,
+template <typename LabelsSolver, typename FeaturesConf, typename Seg_t>
+inline void unification_merge_transitive_bis(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+					     const Seg_t* restrict rlc_rowb, Seg_t len_b,
 					     int32_t* restrict era_rowa, int32_t* restrict era_rowb,
 					     LabelsSolver& ET, Features& features, const int16_t row,
 					     const int16_t slice, StateCounters& counters);
@@ -81,24 +98,40 @@ inline void unification_merge_transitive_bis(const int16_t* restrict rlc_rowa, i
 
 // Fourth way: Fairly close the the third one. In this case, we only increment the size of the union
 // find after the last unification. This means that the UnionFind will remain compact than with the
-// third method
-// TODO
-template <typename LabelsSolver, typename FeaturesConf>
-inline void unification_merge_step1_third(const int16_t* restrict rlc_rowa, int16_t len_a,
-					  const int16_t* restrict rlc_rowb, int16_t len_b,
+// third method. 2 Steps, the row is read twice:
+// 1. Merge with the first row, temporary label if no adjacent segment
+// 2. Merge with the 3 rows of the previous slice at once, and create a new label if the segment
+//    was never merged
+template <typename LabelsSolver, typename FeaturesConf, typename Seg_t>
+inline void unification_merge_step1_third(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+					  const Seg_t* restrict rlc_rowb, Seg_t len_b,
 					  int32_t* restrict era_rowa, int32_t* restrict era_rowb,
-					  LabelsSolver& ET, Features& features,
-					  StateCounters& counters);
+					  LabelsSolver& ET, Features& features, const int16_t row,
+					  const int16_t slice);
 
-template <typename LabelsSolver, typename FeaturesConf>
-inline void unification_merge_step2_third(const int16_t* restrict rlc_rowa, int16_t len_a,
-					  const int16_t* restrict rlc_rowb, int16_t len_b,
+template <typename LabelsSolver, typename FeaturesConf, typename Seg_t>
+inline void unification_merge_step2_third(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+					  AdjState<Seg_t, int32_t>& state,
 					  int32_t* restrict era_rowa,
-					  int32_t* restrict era_rowb,
-					  LabelsSolver& ET, Features& features,
-					  StateCounters& counters);
+					  LabelsSolver& ET, Features& features, const int16_t row,
+					  const int16_t slice);
+
 
+// Fifth way: the rows RLC1..RLC3 of the previous slice are first combined into one list of runs
+// (unification_combine_z_rows), then the row is merged with RLC0 (unification_merge_first) and
+// with the combined list in a single pass. Runs of the previous slice that are known to be in the
+// same component are coalesced: on dense volumes, the row meets about one run where the separate
+// passes meet three, and FindRoot is called once per run met. The combination has a cost of its
+// own: sparse volumes are faster with the separate passes.
+template <typename Seg_t>
+inline Seg_t unification_combine_z_rows(AdjState<Seg_t, int32_t>& state);
 
+template <typename LabelsSolver, typename FeaturesConf, typename Seg_t>
+inline void unification_merge_combined(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+				       const Seg_t* restrict rlc_rowb, Seg_t len_b,
+				       int32_t* restrict era_rowa, const int32_t* restrict era_rowb,
+				       LabelsSolver& ET, Features& features, const int16_t row,
+				       const int16_t slice);
 
 
 
@@ -106,7 +139,6 @@ inline void unification_merge_step2_third(const int16_t* restrict rlc_rowa, int1
 struct Unify_Nothing {
 
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
 
 	static constexpr bool ER = false;
@@ -114,50 +146,137 @@ struct Unify_Nothing {
 	static constexpr bool Double = false;
     };
     
-    template <typename LabelsSolver, typename FeaturesConf>
-    static inline void Unify(AdjState<int16_t, int32_t>& state, int16_t* restrict RLCi,  int32_t* restrict ERAi,
-			     int16_t segment_count, LabelsSolver& ET, Features& features,
-			     const int16_t row, const int16_t slice, const int16_t image_width) {
+    template <typename LabelsSolver, typename FeaturesConf, typename Seg_t>
+    static inline void Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi,  int32_t* restrict ERAi,
+			     seg_arg_t<Seg_t> segment_count, LabelsSolver& ET, Features& features,
+			     const int16_t row, const int16_t slice, const seg_arg_t<Seg_t> image_width) {
 	// Do nothing
     }
 };
 
-struct Unify_SM_Separate {
+// N: 6, 18 or 26-connectivity. In 6-connectivity, the row is only merged with RLC0 and RLC2.
+template <int N>
+struct Unify_SM_Separate_Conn {
 
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
+	using Connectivity = ::Connectivity<N>;
 
 	static constexpr bool ER = false;
 	static constexpr bool ERA = true;
 	static constexpr bool Double = false;
     };
     
-    template <typename LabelsSolver, typename ConfFeatures>
-    static inline void Unify(AdjState<int16_t, int32_t>& state, int16_t* restrict RLCi, int32_t* restrict ERAi,
-			     int16_t segment_count, LabelsSolver& ET,
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static inline void Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi, int32_t* restrict ERAi,
+			     seg_arg_t<Seg_t> segment_count, LabelsSolver& ET,
 			     Features& features, 
-			     const int16_t row, const int16_t slice, const int16_t image_width) {
+			     const int16_t row, const int16_t slice, const seg_arg_t<Seg_t> image_width) {
+	using Conn = typename Conf::Connectivity;
+
+	StateCounters counters;
+	unification_merge_first<LabelsSolver, ConfFeatures, Conn::Diag0>(RLCi, segment_count, state.RLC0, state.len0, ERAi,
+					state.ERA0, ET, features, row, slice, counters);
+	if constexpr (Conn::Row1) {
+	    unification_merge_transitive<LabelsSolver, ConfFeatures, Conn::Diag1>(RLCi, segment_count, state.RLC1, state.len1, ERAi,
+					       state.ERA1, ET, features, row, slice, counters);
+	}
+	if constexpr (Conn::Row3) {
+	    unification_merge_transitive<LabelsSolver, ConfFeatures, Conn::Diag2>(RLCi, segment_count, state.RLC2, state.len2, ERAi,
+					       state.ERA2, ET, features, row, slice, counters);
+	    unification_merge_last<LabelsSolver, ConfFeatures, Conn::Diag3>(RLCi, segment_count, state.RLC3, state.len3, ERAi,
+						 state.ERA3, ET, features, row, slice, counters);
+	} else {
+	    unification_merge_last<LabelsSolver, ConfFeatures, Conn::Diag2>(RLCi, segment_count, state.RLC2, state.len2, ERAi,
+						 state.ERA2, ET, features, row, slice, counters);
+	}
+    }
+};
+
+using Unify_SM_Separate = Unify_SM_Separate_Conn<26>;
+
+// Same as Unify_SM_Separate, with the rows of the previous slice combined (fifth way)
+struct Unify_SM_Combined_Z {
+
+    struct Conf {
+	using Label_t = int32_t;
+
+	static constexpr bool ER = false;
+	static constexpr bool ERA = true;
+	static constexpr bool Double = false;
+    };
+
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static inline void Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi, int32_t* restrict ERAi,
+			     seg_arg_t<Seg_t> segment_count, LabelsSolver& ET,
+			     Features& features,
+			     const int16_t row, const int16_t slice, const seg_arg_t<Seg_t> image_width) {
 
 	StateCounters counters;
 	unification_merge_first<LabelsSolver, ConfFeatures>(RLCi, segment_count, state.RLC0, state.len0, ERAi,
 					state.ERA0, ET, features, row, slice, counters);
-	unification_merge_transitive<LabelsSolver, ConfFeatures>(RLCi, segment_count, state.RLC1, state.len1, ERAi,
-					   state.ERA1, ET, features, row, slice, counters);
-	unification_merge_transitive<LabelsSolver, ConfFeatures>(RLCi, segment_count, state.RLC2, state.len2, ERAi,
-					   state.ERA2, ET, features, row, slice, counters);
 
+	const Seg_t len = unification_combine_z_rows(state);
+	unification_merge_combined<LabelsSolver, ConfFeatures>(
+	    RLCi, segment_count, state.z_RLC, len, ERAi, state.z_ERA, ET, features, row, slice);
+    }
+};
 
-	unification_merge_last<LabelsSolver, ConfFeatures>(RLCi, segment_count, state.RLC3, state.len3, ERAi,
-					     state.ERA3, ET, features, row, slice, counters);
+// Single pass over the row (second way), N-connectivity
+template <int N>
+struct Unify_SM_Generalized_Conn {
+
+    struct Conf {
+	using Label_t = int32_t;
+	using Connectivity = ::Connectivity<N>;
 
+	static constexpr bool ER = false;
+	static constexpr bool ERA = true;
+	static constexpr bool Double = false;
+    };
+
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static inline void Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi, int32_t* restrict ERAi,
+			     seg_arg_t<Seg_t> segment_count, LabelsSolver& ET,
+			     Features& features,
+			     const int16_t row, const int16_t slice, const seg_arg_t<Seg_t> image_width) {
+
+	unification_merge_generalized<LabelsSolver, ConfFeatures, typename Conf::Connectivity>(
+	    RLCi, segment_count, state.RLC0, state.len0, state.RLC1, state.len1,
+	    state.RLC2, state.len2, state.RLC3, state.len3,
+	    ERAi, state.ERA0, state.ERA1, state.ERA2, state.ERA3, ET, features, row, slice);
+    }
+};
+
+using Unify_SM_Generalized = Unify_SM_Generalized_Conn<26>;
+
+// Two passes over the row, labels created by the last one (fourth way)
+struct Unify_SM_Third {
+
+    struct Conf {
+	using Label_t = int32_t;
+
+	static constexpr bool ER = false;
+	static constexpr bool ERA = true;
+	static constexpr bool Double = false;
+    };
+
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static inline void Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi, int32_t* restrict ERAi,
+			     seg_arg_t<Seg_t> segment_count, LabelsSolver& ET,
+			     Features& features,
+			     const int16_t row, const int16_t slice, const seg_arg_t<Seg_t> image_width) {
+
+	unification_merge_step1_third<LabelsSolver, ConfFeatures>(
+	    RLCi, segment_count, state.RLC0, state.len0, ERAi, state.ERA0, ET, features, row, slice);
+	unification_merge_step2_third<LabelsSolver, ConfFeatures>(
+	    RLCi, segment_count, state, ERAi, ET, features, row, slice);
     }
 };
 
 struct Unify_SM_Separate_V2 {
     
     struct Conf {
-	using Seg_t = int16_t;
 	using Label_t = int32_t;
 
 	static constexpr bool ER = false;
@@ -165,11 +284,11 @@ struct Unify_SM_Separate_V2 {
 	static constexpr bool Double = false;
     };
     
-    template <typename LabelsSolver, typename FeaturesConf>
-    static inline void Unify(AdjState<int16_t, int32_t>& state, int16_t* restrict RLCi, int32_t* restrict ERAi,
-			     int16_t* restrict ER, int16_t segment_count, LabelsSolver& ET,
+    template <typename LabelsSolver, typename FeaturesConf, typename Seg_t>
+    static inline void Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi, int32_t* restrict ERAi,
+			     seg_arg_t<Seg_t> segment_count, LabelsSolver& ET,
 			     Features& features, const int16_t row,
-			     const int16_t slice, const int16_t image_width) {
+			     const int16_t slice, const seg_arg_t<Seg_t> image_width) {
 
 	StateCounters counters;
 	unification_merge_first_bis<LabelsSolver, FeaturesConf>(
@@ -197,15 +316,15 @@ struct Unify_SM_Separate_V2 {
 // ================================================== //
 // Implementations
 // ================================================== //
-template <typename LabelsSolver, typename ConfFeatures>
-void unification_merge_first(const int16_t* restrict rlc_rowa, int16_t len_a,
-			     const int16_t* restrict rlc_rowb, int16_t len_b,
+template <typename LabelsSolver, typename ConfFeatures, bool Diag, bool Count, typename Seg_t>
+void unification_merge_first(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+			     const Seg_t* restrict rlc_rowb, Seg_t len_b,
 			     int32_t* restrict era_rowa, int32_t* restrict era_rowb,
 			     LabelsSolver& ET, Features& features, const int16_t row, const int16_t slice,
 			     StateCounters& counters) {
-    int16_t j0a, j1a;
-    int16_t j0b, j1b;
-    int16_t er_a, er_b;
+    Seg_t j0a, j1a;
+    Seg_t j0b, j1b;
+    Seg_t er_a, er_b;
     int32_t a, ea_b;
     int32_t r;
     // This is similar to the 2D version with one small difference when creating a new label
@@ -224,34 +343,34 @@ void unification_merge_first(const int16_t* restrict rlc_rowa, int16_t len_a,
     j0b = rlc_rowb[er_b - 1];
     j1b = rlc_rowb[er_b];
 
-    counters.SetAccessible<UseCounter>(UnificationState::MAIN, UnificationState::NEXT_ERB0);
-    counters.SetAccessible<UseCounter>(UnificationState::NEXT_ERB0, UnificationState::MAIN);
-    counters.SetAccessible<UseCounter>(UnificationState::MAIN, UnificationState::TEMP_LABEL);
-    counters.SetAccessible<UseCounter>(UnificationState::MAIN, UnificationState::MERGE);	
-    counters.Increment<UseCounter>(UnificationState::MERGE, UnificationState::NEXT_ERA);
-    counters.Increment<UseCounter>(UnificationState::MERGE, UnificationState::NEXT_ERB1);
-    counters.Increment<UseCounter>(UnificationState::NEXT_ERB1, UnificationState::NEXT_ERA);
-    counters.Increment<UseCounter>(UnificationState::NEXT_ERB1, UnificationState::UNION);
-    counters.Increment<UseCounter>(UnificationState::UNION, UnificationState::NEXT_ERA);
-    counters.Increment<UseCounter>(UnificationState::UNION, UnificationState::NEXT_ERB1);
-    counters.Increment<UseCounter>(UnificationState::TEMP_LABEL, UnificationState::NEXT_ERA);
-    counters.Increment<UseCounter>(UnificationState::NEXT_ERA, UnificationState::MAIN);
+    counters.SetAccessible<Count>(UnificationState::MAIN, UnificationState::NEXT_ERB0);
+    counters.SetAccessible<Count>(UnificationState::NEXT_ERB0, UnificationState::MAIN);
+    counters.SetAccessible<Count>(UnificationState::MAIN, UnificationState::TEMP_LABEL);
+    counters.SetAccessible<Count>(UnificationState::MAIN, UnificationState::MERGE);	
+    counters.SetAccessible<Count>(UnificationState::MERGE, UnificationState::NEXT_ERA);
+    counters.SetAccessible<Count>(UnificationState::MERGE, UnificationState::NEXT_ERB1);
+    counters.SetAccessible<Count>(UnificationState::NEXT_ERB1, UnificationState::NEXT_ERA);
+    counters.SetAccessible<Count>(UnificationState::NEXT_ERB1, UnificationState::UNION);
+    counters.SetAccessible<Count>(UnificationState::UNION, UnificationState::NEXT_ERA);
+    counters.SetAccessible<Count>(UnificationState::UNION, UnificationState::NEXT_ERB1);
+    counters.SetAccessible<Count>(UnificationState::TEMP_LABEL, UnificationState::NEXT_ERA);
+    counters.SetAccessible<Count>(UnificationState::NEXT_ERA, UnificationState::MAIN);
 	
     
   main:
-    if (j1b < j0a) {
-	counters.Increment<UseCounter>(UnificationState::MAIN, UnificationState::NEXT_ERB0);
+    if (seg_before<Diag>(j1b, j0a)) {
+	counters.Increment<Count>(UnificationState::MAIN, UnificationState::NEXT_ERB0);
 	er_b += 2;
 	j0b = rlc_rowb[er_b - 1];
 	j1b = rlc_rowb[er_b];
-	counters.Increment<UseCounter>(UnificationState::NEXT_ERB0, UnificationState::MAIN);
+	counters.Increment<Count>(UnificationState::NEXT_ERB0, UnificationState::MAIN);
 	goto main;
-    } else if (j1a < j0b) {
-	counters.Increment<UseCounter>(UnificationState::MAIN, UnificationState::TEMP_LABEL);
+    } else if (seg_before<Diag>(j1a, j0b)) {
+	counters.Increment<Count>(UnificationState::MAIN, UnificationState::TEMP_LABEL);
 	goto new_label;
     }
     // goto merge_label
-    counters.Increment<UseCounter>(UnificationState::MAIN, UnificationState::MERGE);
+    counters.Increment<Count>(UnificationState::MAIN, UnificationState::MERGE);
   merge_label:
 
     ea_b = era_rowb[er_b / 2];
@@ -260,11 +379,11 @@ void unification_merge_first(const int16_t* restrict rlc_rowa, int16_t len_a,
     features.AddSegment3D<ConfFeatures>(a, row, slice, j0a, j1a);
 
     if (j1a <= j1b) {
-	    counters.Increment<UseCounter>(UnificationState::MERGE, UnificationState::NEXT_ERA);
+	    counters.Increment<Count>(UnificationState::MERGE, UnificationState::NEXT_ERA);
 	goto next_er;
     }
     // goto next_er'
-    counters.Increment<UseCounter>(UnificationState::MERGE, UnificationState::NEXT_ERB1);
+    counters.Increment<Count>(UnificationState::MERGE, UnificationState::NEXT_ERB1);
   next_erb:
 
     er_b += 2;
@@ -272,11 +391,11 @@ void unification_merge_first(const int16_t* restrict rlc_rowa, int16_t len_a,
     // a virtual segment is expected at the end
     j0b = rlc_rowb[er_b - 1];
     j1b = rlc_rowb[er_b];
-    if (j1a < j0b) {
-	counters.Increment<UseCounter>(UnificationState::NEXT_ERB1, UnificationState::NEXT_ERA);
+    if (seg_before<Diag>(j1a, j0b)) {
+	counters.Increment<Count>(UnificationState::NEXT_ERB1, UnificationState::NEXT_ERA);
 	goto next_er;
     }
-    counters.Increment<UseCounter>(UnificationState::NEXT_ERB1, UnificationState::UNION);
+    counters.Increment<Count>(UnificationState::NEXT_ERB1, UnificationState::UNION);
     // else: goto transitive_merge
   transitive_merge:
 
@@ -288,10 +407,10 @@ void unification_merge_first(const int16_t* restrict rlc_rowa, int16_t len_a,
     ET.UpdateTable(r, a);
     features.Merge<ConfFeatures>(r, a);
     if (j1a <= j1b) {
-	counters.Increment<UseCounter>(UnificationState::UNION, UnificationState::NEXT_ERA);
+	counters.Increment<Count>(UnificationState::UNION, UnificationState::NEXT_ERA);
 	goto next_er;
     }
-    counters.Increment<UseCounter>(UnificationState::UNION, UnificationState::NEXT_ERB1);
+    counters.Increment<Count>(UnificationState::UNION, UnificationState::NEXT_ERB1);
     goto next_erb;    
   new_label:
 
@@ -301,7 +420,7 @@ void unification_merge_first(const int16_t* restrict rlc_rowa, int16_t len_a,
     // segments and used to later check if a new label has to be created (if not connected to any
     // other segment)
     a = TEMP_LABEL;
-    counters.Increment<UseCounter>(UnificationState::TEMP_LABEL, UnificationState::NEXT_ERA);
+    counters.Increment<Count>(UnificationState::TEMP_LABEL, UnificationState::NEXT_ERA);
   next_er:
     era_rowa[er_a / 2] = a;
     er_a += 2;
@@ -310,22 +429,22 @@ void unification_merge_first(const int16_t* restrict rlc_rowa, int16_t len_a,
     }
     j0a = rlc_rowa[er_a - 1];
     j1a = rlc_rowa[er_a];
-    counters.Increment<UseCounter>(UnificationState::NEXT_ERA, UnificationState::MAIN);
+    counters.Increment<Count>(UnificationState::NEXT_ERA, UnificationState::MAIN);
     goto main;
     
   end:
     return;    
 }
 
-template <typename LabelsSolver, typename ConfFeatures>
-void unification_merge_transitive(const int16_t* restrict rlc_rowa, int16_t len_a,
-				  const int16_t* restrict rlc_rowb, int16_t len_b,
+template <typename LabelsSolver, typename ConfFeatures, bool Diag, bool Count, typename Seg_t>
+void unification_merge_transitive(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+				  const Seg_t* restrict rlc_rowb, Seg_t len_b,
 				  int32_t* restrict era_rowa, int32_t* restrict era_rowb,
 				  LabelsSolver& ET, Features& features, const int16_t row, const int16_t slice,
 				  StateCounters& counters) {
-    int16_t j0a, j1a;
-    int16_t j0b, j1b;
-    int16_t er_a, er_b;
+    Seg_t j0a, j1a;
+    Seg_t j0b, j1b;
+    Seg_t er_a, er_b;
     int32_t a, ea_b;
     int32_t r;
     // Nothing to merge
@@ -341,44 +460,44 @@ void unification_merge_transitive(const int16_t* restrict rlc_rowa, int16_t len_
     j0b = rlc_rowb[er_b - 1];
     j1b = rlc_rowb[er_b];
 
-    counters.SetAccessible<UseCounter>(UnificationState::MAIN, UnificationState::NEXT_ERB0);
-    counters.SetAccessible<UseCounter>(UnificationState::NEXT_ERB0, UnificationState::MAIN);
-    counters.SetAccessible<UseCounter>(UnificationState::MAIN, UnificationState::NEXT_ERA);
-    counters.SetAccessible<UseCounter>(UnificationState::MAIN, UnificationState::UNION);
-    counters.SetAccessible<UseCounter>(UnificationState::MAIN, UnificationState::MERGE);
-    counters.SetAccessible<UseCounter>(UnificationState::MERGE, UnificationState::WRITE_ERA);
-    counters.SetAccessible<UseCounter>(UnificationState::MERGE, UnificationState::NEXT_ERB1);
-    counters.SetAccessible<UseCounter>(UnificationState::NEXT_ERB1, UnificationState::WRITE_ERA);
-    counters.SetAccessible<UseCounter>(UnificationState::NEXT_ERB1, UnificationState::UNION);
-    counters.SetAccessible<UseCounter>(UnificationState::UNION, UnificationState::WRITE_ERA);
-    counters.SetAccessible<UseCounter>(UnificationState::UNION, UnificationState::NEXT_ERB1);
-    counters.SetAccessible<UseCounter>(UnificationState::WRITE_ERA, UnificationState::NEXT_ERA);
-    counters.SetAccessible<UseCounter>(UnificationState::NEXT_ERA, UnificationState::MAIN);
+    counters.SetAccessible<Count>(UnificationState::MAIN, UnificationState::NEXT_ERB0);
+    counters.SetAccessible<Count>(UnificationState::NEXT_ERB0, UnificationState::MAIN);
+    counters.SetAccessible<Count>(UnificationState::MAIN, UnificationState::NEXT_ERA);
+    counters.SetAccessible<Count>(UnificationState::MAIN, UnificationState::UNION);
+    counters.SetAccessible<Count>(UnificationState::MAIN, UnificationState::MERGE);
+    counters.SetAccessible<Count>(UnificationState::MERGE, UnificationState::WRITE_ERA);
+    counters.SetAccessible<Count>(UnificationState::MERGE, UnificationState::NEXT_ERB1);
+    counters.SetAccessible<Count>(UnificationState::NEXT_ERB1, UnificationState::WRITE_ERA);
+    counters.SetAccessible<Count>(UnificationState::NEXT_ERB1, UnificationState::UNION);
+    counters.SetAccessible<Count>(UnificationState::UNION, UnificationState::WRITE_ERA);
+    counters.SetAccessible<Count>(UnificationState::UNION, UnificationState::NEXT_ERB1);
+    counters.SetAccessible<Count>(UnificationState::WRITE_ERA, UnificationState::NEXT_ERA);
+    counters.SetAccessible<Count>(UnificationState::NEXT_ERA, UnificationState::MAIN);
 
     
   main:
-    if (j1b < j0a) {
-	counters.Increment<UseCounter>(UnificationState::MAIN, UnificationState::NEXT_ERB0);
+    if (seg_before<Diag>(j1b, j0a)) {
+	counters.Increment<Count>(UnificationState::MAIN, UnificationState::NEXT_ERB0);
 	er_b += 2;
 	j0b = rlc_rowb[er_b - 1];
 	j1b = rlc_rowb[er_b];
-	counters.Increment<UseCounter>(UnificationState::NEXT_ERB0, UnificationState::MAIN);
+	counters.Increment<Count>(UnificationState::NEXT_ERB0, UnificationState::MAIN);
 	goto main;
-    } else if (j1a < j0b) {
+    } else if (seg_before<Diag>(j1a, j0b)) {
 	// No need to allocate a new label: it either has a temporary label or it is either already
 	// connected to another segment
-	counters.Increment<UseCounter>(UnificationState::MAIN, UnificationState::NEXT_ERA);
+	counters.Increment<Count>(UnificationState::MAIN, UnificationState::NEXT_ERA);
 	goto next_er; 
     }
     // always first encounter => can't optimize away
     a = era_rowa[er_a / 2];
     if (a != TEMP_LABEL) {
 	// Merged in a previous step
-	counters.Increment<UseCounter>(UnificationState::MAIN, UnificationState::UNION);
+	counters.Increment<Count>(UnificationState::MAIN, UnificationState::UNION);
 	goto transitive_merge;
     }
     // goto merge_label
-    counters.Increment<UseCounter>(UnificationState::MAIN, UnificationState::MERGE);
+    counters.Increment<Count>(UnificationState::MAIN, UnificationState::MERGE);
     
   merge_label:
     ea_b = era_rowb[er_b / 2];
@@ -387,10 +506,10 @@ void unification_merge_transitive(const int16_t* restrict rlc_rowa, int16_t len_
     features.AddSegment3D<ConfFeatures>(a, row, slice, j0a, j1a);
 
     if (j1a <= j1b) {
- 	counters.Increment<UseCounter>(UnificationState::MERGE, UnificationState::WRITE_ERA);
+ 	counters.Increment<Count>(UnificationState::MERGE, UnificationState::WRITE_ERA);
 	goto write_era;
     }
-    counters.Increment<UseCounter>(UnificationState::MERGE, UnificationState::NEXT_ERB1);
+    counters.Increment<Count>(UnificationState::MERGE, UnificationState::NEXT_ERB1);
     // goto next_er'
     
   next_erb:
@@ -399,11 +518,11 @@ void unification_merge_transitive(const int16_t* restrict rlc_rowa, int16_t len_
     // a virtual segment is expected at the end
     j0b = rlc_rowb[er_b - 1];
     j1b = rlc_rowb[er_b];
-    if (j1a < j0b) {
-	counters.Increment<UseCounter>(UnificationState::NEXT_ERB1, UnificationState::WRITE_ERA);
+    if (seg_before<Diag>(j1a, j0b)) {
+	counters.Increment<Count>(UnificationState::NEXT_ERB1, UnificationState::WRITE_ERA);
 	goto write_era;
     }
-    counters.Increment<UseCounter>(UnificationState::NEXT_ERB1, UnificationState::UNION);
+    counters.Increment<Count>(UnificationState::NEXT_ERB1, UnificationState::UNION);
     // else: goto transitive_merge
   transitive_merge:
     ea_b = era_rowb[er_b / 2];
@@ -419,14 +538,14 @@ void unification_merge_transitive(const int16_t* restrict rlc_rowa, int16_t len_
     features.Merge<ConfFeatures>(r, a);
     
     if (j1a <= j1b) {
-	counters.Increment<UseCounter>(UnificationState::UNION, UnificationState::WRITE_ERA);
+	counters.Increment<Count>(UnificationState::UNION, UnificationState::WRITE_ERA);
 	goto write_era;
     }
-    counters.Increment<UseCounter>(UnificationState::UNION, UnificationState::NEXT_ERB1);
+    counters.Increment<Count>(UnificationState::UNION, UnificationState::NEXT_ERB1);
     goto next_erb;    
   write_era:
     era_rowa[er_a / 2] = a;
-    counters.Increment<UseCounter>(UnificationState::WRITE_ERA, UnificationState::NEXT_ERA);
+    counters.Increment<Count>(UnificationState::WRITE_ERA, UnificationState::NEXT_ERA);
   next_er:
     er_a += 2;
     if (er_a >= len_a) {
@@ -434,22 +553,22 @@ void unification_merge_transitive(const int16_t* restrict rlc_rowa, int16_t len_
     }
     j0a = rlc_rowa[er_a - 1];
     j1a = rlc_rowa[er_a];
-    counters.Increment<UseCounter>(UnificationState::NEXT_ERA, UnificationState::MAIN);
+    counters.Increment<Count>(UnificationState::NEXT_ERA, UnificationState::MAIN);
     goto main;
     
   end:
     return;
 }
 
-template <typename LabelsSolver, typename ConfFeatures>
-void unification_merge_last(const int16_t* restrict rlc_rowa, int16_t len_a,
-			    const int16_t* restrict rlc_rowb, int16_t len_b,
+template <typename LabelsSolver, typename ConfFeatures, bool Diag, bool Count, typename Seg_t>
+void unification_merge_last(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+			    const Seg_t* restrict rlc_rowb, Seg_t len_b,
 			    int32_t* restrict era_rowa, int32_t* restrict era_rowb,
 			    LabelsSolver& ET, Features& features, const int16_t row, const int16_t slice,
 			    StateCounters& counters) {
-    int16_t j0a, j1a;
-    int16_t j0b, j1b;
-    int16_t er_a, er_b;
+    Seg_t j0a, j1a;
+    Seg_t j0b, j1b;
+    Seg_t er_a, er_b;
     int32_t a, ea_b;
     int32_t r;
     // Nothing to merge
@@ -466,50 +585,50 @@ void unification_merge_last(const int16_t* restrict rlc_rowa, int16_t len_a,
     j0b = rlc_rowb[er_b - 1];
     j1b = rlc_rowb[er_b];
     
-    counters.SetAccessible<UseCounter>(UnificationState::MAIN, UnificationState::NEXT_ERB0);
-    counters.SetAccessible<UseCounter>(UnificationState::NEXT_ERB0, UnificationState::MAIN);
-    counters.SetAccessible<UseCounter>(UnificationState::MAIN, UnificationState::NEW_LABEL);
-    counters.SetAccessible<UseCounter>(UnificationState::NEW_LABEL, UnificationState::WRITE_ERA);
-    counters.SetAccessible<UseCounter>(UnificationState::MAIN, UnificationState::NEXT_ERA);
-    counters.SetAccessible<UseCounter>(UnificationState::MAIN, UnificationState::UNION);
-    counters.SetAccessible<UseCounter>(UnificationState::MAIN, UnificationState::MERGE);
-    counters.SetAccessible<UseCounter>(UnificationState::MERGE, UnificationState::WRITE_ERA);
-    counters.SetAccessible<UseCounter>(UnificationState::MERGE, UnificationState::NEXT_ERB1);
-    counters.SetAccessible<UseCounter>(UnificationState::NEXT_ERB1, UnificationState::WRITE_ERA);
-    counters.SetAccessible<UseCounter>(UnificationState::NEXT_ERB1, UnificationState::UNION);
-    counters.SetAccessible<UseCounter>(UnificationState::UNION, UnificationState::WRITE_ERA);
-    counters.SetAccessible<UseCounter>(UnificationState::UNION, UnificationState::NEXT_ERB1);
-    counters.SetAccessible<UseCounter>(UnificationState::WRITE_ERA, UnificationState::NEXT_ERA);
-    counters.SetAccessible<UseCounter>(UnificationState::NEXT_ERA, UnificationState::MAIN);
+    counters.SetAccessible<Count>(UnificationState::MAIN, UnificationState::NEXT_ERB0);
+    counters.SetAccessible<Count>(UnificationState::NEXT_ERB0, UnificationState::MAIN);
+    counters.SetAccessible<Count>(UnificationState::MAIN, UnificationState::NEW_LABEL);
+    counters.SetAccessible<Count>(UnificationState::NEW_LABEL, UnificationState::WRITE_ERA);
+    counters.SetAccessible<Count>(UnificationState::MAIN, UnificationState::NEXT_ERA);
+    counters.SetAccessible<Count>(UnificationState::MAIN, UnificationState::UNION);
+    counters.SetAccessible<Count>(UnificationState::MAIN, UnificationState::MERGE);
+    counters.SetAccessible<Count>(UnificationState::MERGE, UnificationState::WRITE_ERA);
+    counters.SetAccessible<Count>(UnificationState::MERGE, UnificationState::NEXT_ERB1);
+    counters.SetAccessible<Count>(UnificationState::NEXT_ERB1, UnificationState::WRITE_ERA);
+    counters.SetAccessible<Count>(UnificationState::NEXT_ERB1, UnificationState::UNION);
+    counters.SetAccessible<Count>(UnificationState::UNION, UnificationState::WRITE_ERA);
+    counters.SetAccessible<Count>(UnificationState::UNION, UnificationState::NEXT_ERB1);
+    counters.SetAccessible<Count>(UnificationState::WRITE_ERA, UnificationState::NEXT_ERA);
+    counters.SetAccessible<Count>(UnificationState::NEXT_ERA, UnificationState::MAIN);
 
   main:
-    if (j1b < j0a) {
-	counters.Increment<UseCounter>(UnificationState::MAIN, UnificationState::NEXT_ERB0);
+    if (seg_before<Diag>(j1b, j0a)) {
+	counters.Increment<Count>(UnificationState::MAIN, UnificationState::NEXT_ERB0);
 	er_b += 2;
 	j0b = rlc_rowb[er_b - 1];
 	j1b = rlc_rowb[er_b];
-	counters.Increment<UseCounter>(UnificationState::NEXT_ERB0, UnificationState::MAIN);
+	counters.Increment<Count>(UnificationState::NEXT_ERB0, UnificationState::MAIN);
 	goto main;
     }
     a = era_rowa[er_a / 2]; // always first encounter => can't optimize away
-    if (j1a < j0b) {
+    if (seg_before<Diag>(j1a, j0b)) {
 	if (a == TEMP_LABEL) { // Commit new component
-	    counters.Increment<UseCounter>(UnificationState::MAIN, UnificationState::NEW_LABEL);
+	    counters.Increment<Count>(UnificationState::MAIN, UnificationState::NEW_LABEL);
 	    a = ET.NewLabel();
 	    features.NewComponent3D<ConfFeatures>(a, row, slice, j0a, j1a);       
 		
-	    counters.Increment<UseCounter>(UnificationState::NEW_LABEL, UnificationState::WRITE_ERA);
+	    counters.Increment<Count>(UnificationState::NEW_LABEL, UnificationState::WRITE_ERA);
 	    goto write_era; 
 	}
-	counters.Increment<UseCounter>(UnificationState::MAIN, UnificationState::NEXT_ERA);
+	counters.Increment<Count>(UnificationState::MAIN, UnificationState::NEXT_ERA);
 	goto next_er;
     }
     if (a != TEMP_LABEL) {
-	counters.Increment<UseCounter>(UnificationState::MAIN, UnificationState::UNION);
+	counters.Increment<Count>(UnificationState::MAIN, UnificationState::UNION);
 	// Merged in a previous step	
 	goto transitive_merge;
     }
-    counters.Increment<UseCounter>(UnificationState::MAIN, UnificationState::MERGE);
+    counters.Increment<Count>(UnificationState::MAIN, UnificationState::MERGE);
     // goto merge_label
     
   merge_label:
@@ -519,10 +638,10 @@ void unification_merge_last(const int16_t* restrict rlc_rowa, int16_t len_a,
     features.AddSegment3D<ConfFeatures>(a, row, slice, j0a, j1a);
 
     if (j1a <= j1b) {
-	counters.Increment<UseCounter>(UnificationState::MERGE, UnificationState::WRITE_ERA);
+	counters.Increment<Count>(UnificationState::MERGE, UnificationState::WRITE_ERA);
 	goto write_era;
     }
-    counters.Increment<UseCounter>(UnificationState::MERGE, UnificationState::NEXT_ERB1);
+    counters.Increment<Count>(UnificationState::MERGE, UnificationState::NEXT_ERB1);
     // goto next_er'
     
   next_erb:
@@ -531,11 +650,11 @@ void unification_merge_last(const int16_t* restrict rlc_rowa, int16_t len_a,
     // a virtual segment is expected at the end
     j0b = rlc_rowb[er_b - 1];
     j1b = rlc_rowb[er_b];
-    if (j1a < j0b) {
-	counters.Increment<UseCounter>(UnificationState::NEXT_ERB1, UnificationState::WRITE_ERA);
+    if (seg_before<Diag>(j1a, j0b)) {
+	counters.Increment<Count>(UnificationState::NEXT_ERB1, UnificationState::WRITE_ERA);
 	goto write_era;
     }
-    counters.Increment<UseCounter>(UnificationState::NEXT_ERB1, UnificationState::UNION);
+    counters.Increment<Count>(UnificationState::NEXT_ERB1, UnificationState::UNION);
     // else: goto transitive_merge
     
   transitive_merge:
@@ -552,15 +671,15 @@ void unification_merge_last(const int16_t* restrict rlc_rowa, int16_t len_a,
     features.Merge<ConfFeatures>(r, a);
     
     if (j1a <= j1b) {
-	counters.Increment<UseCounter>(UnificationState::UNION, UnificationState::WRITE_ERA);
+	counters.Increment<Count>(UnificationState::UNION, UnificationState::WRITE_ERA);
 	goto write_era;
     }
-    counters.Increment<UseCounter>(UnificationState::UNION, UnificationState::NEXT_ERB1);
+    counters.Increment<Count>(UnificationState::UNION, UnificationState::NEXT_ERB1);
     goto next_erb;
     
   write_era:
     era_rowa[er_a / 2] = a;    
-    counters.Increment<UseCounter>(UnificationState::WRITE_ERA, UnificationState::NEXT_ERA);
+    counters.Increment<Count>(UnificationState::WRITE_ERA, UnificationState::NEXT_ERA);
   next_er:
     er_a += 2;
     if (er_a >= len_a) {
@@ -568,22 +687,241 @@ void unification_merge_last(const int16_t* restrict rlc_rowa, int16_t len_a,
     }
     j0a = rlc_rowa[er_a - 1];
     j1a = rlc_rowa[er_a];
-    counters.Increment<UseCounter>(UnificationState::NEXT_ERA, UnificationState::MAIN);
+    counters.Increment<Count>(UnificationState::NEXT_ERA, UnificationState::MAIN);
     goto main;
     
   end:
     return;
 }
 
-template <typename LabelsSolver, typename ConfFeatures>
-void unification_merge_first_bis(const int16_t* restrict rlc_rowa, int16_t len_a,
-				 const int16_t* restrict rlc_rowb, int16_t len_b,
+template <typename Seg_t>
+Seg_t unification_combine_z_rows(AdjState<Seg_t, int32_t>& state) {
+    const Seg_t* restrict rlc[3] = {state.RLC1, state.RLC2, state.RLC3};
+    const int32_t* restrict era[3] = {state.ERA1, state.ERA2, state.ERA3};
+    Seg_t er[3] = {1, 1, 1};
+
+    // At most len1 + len2 + len3 + 2 elements (RLEArena::ZRLCPitch)
+    Seg_t* restrict rlc_rowt = state.z_RLC;
+    int32_t* restrict era_rowt = state.z_ERA;
+    Seg_t len = 0;
+
+    // Greatest end of the runs of each row coalesced into the last run of the list
+    Seg_t end[3];
+    const Seg_t sentinel = rle::rle_sentinel<Seg_t>();
+
+    for (;;) {
+	// Next run by start, the rows end with sentinels
+	int k = 0;
+	Seg_t j0 = rlc[0][er[0] - 1];
+	for (int i = 1; i < 3; i++) {
+	    if (rlc[i][er[i] - 1] < j0) {
+		k = i;
+		j0 = rlc[i][er[i] - 1];
+	    }
+	}
+	if (j0 == sentinel) {
+	    break;
+	}
+	const Seg_t j1 = rlc[k][er[k]];
+	const int32_t label = era[k][er[k] / 2];
+	er[k] += 2;
+
+	// Coalesced when connected to a run of an adjacent row of the last run (the previous slice
+	// is unified: same component) or with the same label. The last run stays contiguous, and a
+	// segment is connected to it if and only if it is connected to one of its runs.
+	if (len > 0 && j0 <= rlc_rowt[len - 1] &&
+	    (label == era_rowt[len / 2 - 1] ||
+	     (k > 0 && end[k - 1] >= j0) || (k < 2 && end[k + 1] >= j0))) {
+	    rlc_rowt[len - 1] = std::max(rlc_rowt[len - 1], j1);
+	    end[k] = std::max(end[k], j1);
+	    continue;
+	}
+
+	// Runs of rows row - 1 and row + 1 may overlap here without being connected
+	rlc_rowt[len] = j0;
+	rlc_rowt[len + 1] = j1;
+	era_rowt[len / 2] = label;
+	len += 2;
+	end[0] = end[1] = end[2] = -1;
+	end[k] = j1;
+    }
+    rlc_rowt[len] = sentinel;
+    rlc_rowt[len + 1] = sentinel;
+    return len;
+}
+
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void unification_merge_combined(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+				const Seg_t* restrict rlc_rowb, Seg_t len_b,
+				int32_t* restrict era_rowa, const int32_t* restrict era_rowb,
+				LabelsSolver& ET, Features& features, const int16_t row,
+				const int16_t slice) {
+    // The runs of rowb are sorted by start but may overlap: every run starting before the end of
+    // a segment is checked. The runs before er_first end before the current segment, and before
+    // every next one.
+    Seg_t er_first = 1;
+
+    for (Seg_t er_a = 1; er_a < len_a; er_a += 2) {
+	const Seg_t j0a = rlc_rowa[er_a - 1];
+	const Seg_t j1a = rlc_rowa[er_a];
+	int32_t a = era_rowa[er_a / 2];
+	// Merged with RLC0: the root may have been merged since by a previous segment
+	if (a != TEMP_LABEL) {
+	    a = ET.FindRoot(a);
+	}
+
+	while (rlc_rowb[er_first] < j0a) {
+	    er_first += 2;
+	}
+	for (Seg_t er_b = er_first; rlc_rowb[er_b - 1] <= j1a; er_b += 2) {
+	    if (rlc_rowb[er_b] < j0a) {
+		continue;
+	    }
+	    int32_t r = ET.FindRoot(era_rowb[er_b / 2]);
+	    if (a == TEMP_LABEL) {
+		a = r;
+		features.AddSegment3D<ConfFeatures>(a, row, slice, j0a, j1a);
+		continue;
+	    }
+	    // a stays the root: the smallest one wins
+	    if (r < a) {
+		std::swap(a, r);
+	    }
+	    if (r != a) {
+		ET.UpdateTable(r, a);
+		features.Merge<ConfFeatures>(r, a);
+	    }
+	}
+
+	if (a == TEMP_LABEL) {
+	    a = ET.NewLabel();
+	    features.NewComponent3D<ConfFeatures>(a, row, slice, j0a, j1a);
+	}
+	era_rowa[er_a / 2] = a;
+    }
+}
+
+template <typename LabelsSolver, typename ConfFeatures, bool Diag, typename Seg_t>
+void unification_merge_segment(Seg_t j0a, Seg_t j1a, const Seg_t* restrict rlc_rowb,
+			       const int32_t* restrict era_rowb, Seg_t& er_b, int32_t& a,
+			       LabelsSolver& ET, Features& features, const int16_t row,
+			       const int16_t slice) {
+    for_each_overlap<Diag>(j0a, j1a, rlc_rowb, er_b, [&](Seg_t er) {
+	int32_t r = ET.FindRoot(era_rowb[er / 2]);
+	if (a == TEMP_LABEL) {
+	    a = r;
+	    features.AddSegment3D<ConfFeatures>(a, row, slice, j0a, j1a);
+	    return;
+	}
+	if (r < a) {
+	    std::swap(a, r);
+	}
+	if (r != a) {
+	    ET.UpdateTable(r, a);
+	    features.Merge<ConfFeatures>(r, a);
+	}
+    });
+}
+
+template <typename LabelsSolver, typename ConfFeatures, typename Conn, typename Seg_t>
+void unification_merge_generalized(Seg_t const* restrict rlc_row, Seg_t len,
+				   Seg_t const* restrict rlc_row0, Seg_t len0,
+				   Seg_t const* restrict rlc_row1, Seg_t len1,
+				   Seg_t const* restrict rlc_row2, Seg_t len2,
+				   Seg_t const* restrict rlc_row3, Seg_t len3,
+				   int32_t* restrict era_rowa,
+				   int32_t* restrict era_row0,
+				   int32_t* restrict era_row1,
+				   int32_t* restrict era_row2,
+				   int32_t* restrict era_row3,
+				   LabelsSolver& ET, Features& features, const int16_t row,
+				   const int16_t slice) {
+    Seg_t er0 = 1, er1 = 1, er2 = 1, er3 = 1;
+
+    for (Seg_t er_a = 1; er_a < len; er_a += 2) {
+	const Seg_t j0a = rlc_row[er_a - 1];
+	const Seg_t j1a = rlc_row[er_a];
+	int32_t a = TEMP_LABEL;
+
+	unification_merge_segment<LabelsSolver, ConfFeatures, Conn::Diag0>(
+	    j0a, j1a, rlc_row0, era_row0, er0, a, ET, features, row, slice);
+	if (Conn::Row1) {
+	    unification_merge_segment<LabelsSolver, ConfFeatures, Conn::Diag1>(
+		j0a, j1a, rlc_row1, era_row1, er1, a, ET, features, row, slice);
+	}
+	unification_merge_segment<LabelsSolver, ConfFeatures, Conn::Diag2>(
+	    j0a, j1a, rlc_row2, era_row2, er2, a, ET, features, row, slice);
+	if (Conn::Row3) {
+	    unification_merge_segment<LabelsSolver, ConfFeatures, Conn::Diag3>(
+		j0a, j1a, rlc_row3, era_row3, er3, a, ET, features, row, slice);
+	}
+
+	if (a == TEMP_LABEL) {
+	    a = ET.NewLabel();
+	    features.NewComponent3D<ConfFeatures>(a, row, slice, j0a, j1a);
+	}
+	era_rowa[er_a / 2] = a;
+    }
+}
+
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void unification_merge_step1_third(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+				   const Seg_t* restrict rlc_rowb, Seg_t len_b,
+				   int32_t* restrict era_rowa, int32_t* restrict era_rowb,
+				   LabelsSolver& ET, Features& features, const int16_t row,
+				   const int16_t slice) {
+    Seg_t er_b = 1;
+
+    for (Seg_t er_a = 1; er_a < len_a; er_a += 2) {
+	int32_t a = TEMP_LABEL;
+	unification_merge_segment<LabelsSolver, ConfFeatures>(
+	    rlc_rowa[er_a - 1], rlc_rowa[er_a], rlc_rowb, era_rowb, er_b, a, ET, features, row,
+	    slice);
+	era_rowa[er_a / 2] = a;
+    }
+}
+
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void unification_merge_step2_third(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+				   AdjState<Seg_t, int32_t>& state,
+				   int32_t* restrict era_rowa,
+				   LabelsSolver& ET, Features& features, const int16_t row,
+				   const int16_t slice) {
+    Seg_t er1 = 1, er2 = 1, er3 = 1;
+
+    for (Seg_t er_a = 1; er_a < len_a; er_a += 2) {
+	const Seg_t j0a = rlc_rowa[er_a - 1];
+	const Seg_t j1a = rlc_rowa[er_a];
+	int32_t a = era_rowa[er_a / 2];
+	// Merged in step 1: the root may have been merged since by a previous segment
+	if (a != TEMP_LABEL) {
+	    a = ET.FindRoot(a);
+	}
+
+	unification_merge_segment<LabelsSolver, ConfFeatures>(j0a, j1a, state.RLC1, state.ERA1, er1,
+							      a, ET, features, row, slice);
+	unification_merge_segment<LabelsSolver, ConfFeatures>(j0a, j1a, state.RLC2, state.ERA2, er2,
+							      a, ET, features, row, slice);
+	unification_merge_segment<LabelsSolver, ConfFeatures>(j0a, j1a, state.RLC3, state.ERA3, er3,
+							      a, ET, features, row, slice);
+
+	if (a == TEMP_LABEL) {
+	    a = ET.NewLabel();
+	    features.NewComponent3D<ConfFeatures>(a, row, slice, j0a, j1a);
+	}
+	era_rowa[er_a / 2] = a;
+    }
+}
+
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void unification_merge_first_bis(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+				 const Seg_t* restrict rlc_rowb, Seg_t len_b,
 				 int32_t* restrict era_rowa, int32_t* restrict era_rowb,
 				 LabelsSolver& ET, Features& features, const int16_t row, const int16_t slice,
 				 StateCounters& counters) {
-    int16_t j0a, j1a;
-    int16_t j0b, j1b;
-    int16_t er_a, er_b;
+    Seg_t j0a, j1a;
+    Seg_t j0b, j1b;
+    Seg_t er_a, er_b;
     int32_t a, ea_b;
     int32_t r;
     // This is similar to the 2D version with one small difference when creating a new label
@@ -634,6 +972,7 @@ void unification_merge_first_bis(const int16_t* restrict rlc_rowa, int16_t len_a
     ea_b = era_rowb[er_b / 2];
     r = ET.FindRoot(ea_b);
     a = r;
+    features.AddSegment3D<ConfFeatures>(a, row, slice, j0a, j1a);
     if (j1a <= j1b) {
 	counters.Increment<UseCounter>(UnificationState::MERGE, UnificationState::NEXT_ERA);
 	goto next_er;
@@ -677,6 +1016,7 @@ void unification_merge_first_bis(const int16_t* restrict rlc_rowa, int16_t len_a
     // segments and used to later check if a new label has to be created (if not connected to any
     // other segment)
     a = ET.NewLabel();    
+    features.NewComponent3D<ConfFeatures>(a, row, slice, j0a, j1a);
     counters.Increment<UseCounter>(UnificationState::NEW_LABEL, UnificationState::NEXT_ERA);
     
   next_er:
@@ -694,15 +1034,15 @@ void unification_merge_first_bis(const int16_t* restrict rlc_rowa, int16_t len_a
     return;    
 }
 
-template <typename LabelsSolver, typename ConfFeatures>
-void unification_merge_transitive_bis(const int16_t* restrict rlc_rowa, int16_t len_a,
-				      const int16_t* restrict rlc_rowb, int16_t len_b,
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void unification_merge_transitive_bis(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+				      const Seg_t* restrict rlc_rowb, Seg_t len_b,
 				      int32_t* restrict era_rowa, int32_t* restrict era_rowb,
 				      LabelsSolver& ET, Features& features, const int16_t row, const int16_t slice,
 				      StateCounters& counters) {
-    int16_t j0a, j1a;
-    int16_t j0b, j1b;
-    int16_t er_a, er_b;
+    Seg_t j0a, j1a;
+    Seg_t j0b, j1b;
+    Seg_t er_a, er_b;
     int32_t a, ea_b;
     int32_t r;
     // Nothing to merge
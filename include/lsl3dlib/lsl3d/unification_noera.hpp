@@ -0,0 +1,120 @@
+#ifndef CCL_ALGOS_3D_UNIFICATION_NOERA_HPP
+#define CCL_ALGOS_3D_UNIFICATION_NOERA_HPP
+
+#include <cstdint>
+#include <cassert>
+#include <algorithm>
+
+#include <simdhelpers/restrict.hpp>
+
+#include "lsl3dlib/features.hpp"
+#include "lsl3dlib/lsl3d/unification_common.hpp"
+
+namespace unify {
+
+// ERA-less unification (ConfNoERA): the label of a segment is implicit, it is its index in raster
+// order. The segment er of a row is label uf_offset + er / 2 of ET (state.uf_offset*, filled by
+// LSL3D::UnifySlice from ccl.row_label): no ERA is read or written, the union-find table is the
+// only per segment state.
+// Every segment gets a new label, in order, which is then attached to the root of the runs it
+// touches (lowest root wins): there are more labels than with ERA (one per segment, see
+// LSL3D::MaxLabels) and a FindRoot per overlap, in exchange for the int32_t per segment of ERA.
+// Relabeling: Relabeling_Z_NOERA.
+
+// Runs of rowb touching [j0a, j1a) from er_b, their labels starting at offset_b. `a` is
+// TEMP_LABEL or the root of the segment.
+template <bool Diag = true, typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+inline void unification_noera_segment(Seg_t j0a, Seg_t j1a, const Seg_t* restrict rlc_rowb,
+				      int32_t offset_b, Seg_t& er_b, int32_t& a,
+				      LabelsSolver& ET, Features& features);
+
+// N: 6, 18 or 26-connectivity
+template <int N>
+struct Unify_SM_NoERA_Conn {
+
+    struct Conf {
+	using Label_t = int32_t;
+	using Connectivity = ::Connectivity<N>;
+
+	static constexpr bool ER = false;
+	static constexpr bool ERA = false;
+	static constexpr bool Double = false;
+    };
+
+    // ERAi is not used (nullptr)
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static inline void Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi, int32_t* restrict ERAi,
+			     seg_arg_t<Seg_t> segment_count, LabelsSolver& ET,
+			     Features& features,
+			     const int16_t row, const int16_t slice, const seg_arg_t<Seg_t> image_width);
+};
+
+using Unify_SM_NoERA = Unify_SM_NoERA_Conn<26>;
+
+
+
+// Implementations
+
+template <bool Diag, typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void unification_noera_segment(Seg_t j0a, Seg_t j1a, const Seg_t* restrict rlc_rowb,
+			       int32_t offset_b, Seg_t& er_b, int32_t& a, LabelsSolver& ET,
+			       Features& features) {
+    for_each_overlap<Diag>(j0a, j1a, rlc_rowb, er_b, [&](Seg_t er) {
+	int32_t r = ET.FindRoot(offset_b + er / 2);
+	if (a == TEMP_LABEL) {
+	    a = r;
+	    return;
+	}
+	if (r < a) {
+	    std::swap(a, r);
+	}
+	if (r != a) {
+	    ET.UpdateTable(r, a);
+	    features.Merge<ConfFeatures>(r, a);
+	}
+    });
+}
+
+template <int N>
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void Unify_SM_NoERA_Conn<N>::Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi,
+				   int32_t* restrict ERAi, seg_arg_t<Seg_t> segment_count,
+				   LabelsSolver& ET, Features& features, const int16_t row,
+				   const int16_t slice, const seg_arg_t<Seg_t> image_width) {
+    using Conn = typename Conf::Connectivity;
+
+    Seg_t er0 = 1, er1 = 1, er2 = 1, er3 = 1;
+    for (Seg_t er_a = 1; er_a < segment_count; er_a += 2) {
+	const Seg_t j0a = RLCi[er_a - 1];
+	const Seg_t j1a = RLCi[er_a];
+	int32_t a = TEMP_LABEL;
+
+	unification_noera_segment<Conn::Diag0, LabelsSolver, ConfFeatures>(
+	    j0a, j1a, state.RLC0, state.uf_offset0, er0, a, ET, features);
+	if (Conn::Row1) {
+	    unification_noera_segment<Conn::Diag1, LabelsSolver, ConfFeatures>(
+		j0a, j1a, state.RLC1, state.uf_offset1, er1, a, ET, features);
+	}
+	unification_noera_segment<Conn::Diag2, LabelsSolver, ConfFeatures>(
+	    j0a, j1a, state.RLC2, state.uf_offset2, er2, a, ET, features);
+	if (Conn::Row3) {
+	    unification_noera_segment<Conn::Diag3, LabelsSolver, ConfFeatures>(
+		j0a, j1a, state.RLC3, state.uf_offset3, er3, a, ET, features);
+	}
+
+	// Labels are created in raster order: this one is the segment
+	const int32_t label = ET.NewLabel();
+	assert(label == state.uf_offset + er_a / 2);
+	if (a == TEMP_LABEL) {
+	    features.NewComponent3D<ConfFeatures>(label);
+	    a = label;
+	} else {
+	    ET.UpdateTable(label, a);
+	}
+	features.AddSegment3D<ConfFeatures>(a, row, slice, j0a, j1a);
+    }
+}
+
+}
+
+#endif // CCL_ALGOS_3D_UNIFICATION_NOERA_HPP
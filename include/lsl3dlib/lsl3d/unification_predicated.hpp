@@ -0,0 +1,178 @@
+#ifndef CCL_ALGOS_3D_UNIFICATION_PREDICATED_HPP
+#define CCL_ALGOS_3D_UNIFICATION_PREDICATED_HPP
+
+#include <cstdint>
+#include <algorithm>
+
+#include <simdhelpers/restrict.hpp>
+
+#include "lsl3dlib/features.hpp"
+#include "lsl3dlib/lsl3d/unification_stats.hpp"
+#include "lsl3dlib/lsl3d/unification_common.hpp"
+
+namespace unify {
+
+// Branch-reduced version of the separate passes (unification_merge_first/transitive/last).
+// The state machines of the merges branch at each step on the relative positions of the current
+// runs (MAIN -> NEXT_ERB0 / MERGE / NEXT_ERA, MERGE/UNION -> NEXT_ERB1 / NEXT_ERA). When the
+// rows hold as many short runs as gaps (foreground density 30-60%), these branches are close to
+// random and most of them are mispredicted.
+// Here the two rows are walked as in a merge of sorted lists: each step compares the current
+// run a of the row and run b of the neighbour row once, and advances the one ending first, with
+// conditional moves (er_a += 2 * adv_a, er_b += 2 * !adv_a). The label of a is stored at each
+// step, whether a is done or not. The only data dependent branch left is the overlap test, the
+// union being done under it: a union at every step with conditional operands (r = a when there
+// is no overlap) was slower, the FindRoot/UpdateTable of each step then being on the critical
+// path of the next one. A step per run of either row is done, where the state machines skip the
+// runs of b before a in a tight loop.
+// Measured with lsl3d-bench-states (2048 wide random rows): the transitions are those expected,
+// but the state machines stay faster at every density, by 20-30% where their branches are the
+// most balanced (40-65%) and up to 60% on sparse or dense rows. Hence Unify_SM_Separate remains
+// the default and this is opt-in only: check with lsl3d-bench-states and lsl3d-bench-unify that it
+// wins on the target CPU before using it.
+// New labels are created by a last pass over the ERA row, for the segments still labeled
+// TEMP_LABEL.
+// The transitions are recorded as MAIN -> NEXT_ERB0 (b advanced), MAIN -> NEXT_ERA (a advanced),
+// MAIN -> MERGE (first overlap of a) and MAIN -> UNION (other overlaps), with the same meaning
+// as for the state machines: both count the same overlaps.
+
+// First: segments of rowa are not labeled yet (TEMP_LABEL), rowa is merged with its first row
+template <typename LabelsSolver, typename ConfFeatures, bool Diag = true, bool First = false,
+	  bool Count = UseCounter, typename Seg_t>
+inline void unification_merge_predicated(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+					 const Seg_t* restrict rlc_rowb,
+					 int32_t* restrict era_rowa,
+					 const int32_t* restrict era_rowb,
+					 LabelsSolver& ET, Features& features, const int16_t row,
+					 const int16_t slice, StateCounters& counters);
+
+// New labels of the segments of rowa that were not merged
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+inline void unification_new_labels(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+				   int32_t* restrict era_rowa, LabelsSolver& ET,
+				   Features& features, const int16_t row, const int16_t slice);
+
+// N: 6, 18 or 26-connectivity
+template <int N>
+struct Unify_SM_Predicated_Conn {
+
+    struct Conf {
+	using Label_t = int32_t;
+	using Connectivity = ::Connectivity<N>;
+
+	static constexpr bool ER = false;
+	static constexpr bool ERA = true;
+	static constexpr bool Double = false;
+    };
+
+    template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+    static inline void Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi, int32_t* restrict ERAi,
+			     seg_arg_t<Seg_t> segment_count, LabelsSolver& ET,
+			     Features& features,
+			     const int16_t row, const int16_t slice, const seg_arg_t<Seg_t> image_width);
+};
+
+using Unify_SM_Predicated = Unify_SM_Predicated_Conn<26>;
+
+
+// Implementations
+
+template <typename LabelsSolver, typename ConfFeatures, bool Diag, bool First, bool Count,
+	  typename Seg_t>
+void unification_merge_predicated(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+				  const Seg_t* restrict rlc_rowb, int32_t* restrict era_rowa,
+				  const int32_t* restrict era_rowb, LabelsSolver& ET,
+				  Features& features, const int16_t row, const int16_t slice,
+				  StateCounters& counters) {
+    if (len_a == 0) {
+	return;
+    }
+
+    Seg_t er_a = 1;
+    Seg_t er_b = 1;
+    int32_t a = First ? (int32_t)TEMP_LABEL : era_rowa[0];
+    for (;;) {
+	const Seg_t j0a = rlc_rowa[er_a - 1];
+	const Seg_t j1a = rlc_rowa[er_a];
+	const Seg_t j0b = rlc_rowb[er_b - 1];
+	const Seg_t j1b = rlc_rowb[er_b];
+
+	// The sentinels of rowb start after every segment: b never goes past them
+	const bool touch = !seg_before<Diag>(j1b, j0a) & !seg_before<Diag>(j1a, j0b);
+	if (touch) {
+	    int32_t r = ET.FindRoot(era_rowb[er_b / 2]);
+	    if (a == (int32_t)TEMP_LABEL) {
+		counters.Increment<Count>(UnificationState::MAIN, UnificationState::MERGE);
+		a = r;
+		features.AddSegment3D<ConfFeatures>(a, row, slice, j0a, j1a);
+	    } else {
+		counters.Increment<Count>(UnificationState::MAIN, UnificationState::UNION);
+		// a may have been merged by a previous pass
+		a = ET.FindRoot(a);
+		if (r < a) {
+		    std::swap(a, r);
+		}
+		if (r != a) {
+		    ET.UpdateTable(r, a);
+		    features.Merge<ConfFeatures>(r, a);
+		}
+	    }
+	}
+
+	// With equal ends, neither run touches the next run of the other row
+	const bool adv_a = j1a <= j1b;
+	era_rowa[er_a / 2] = a;
+	er_a += 2 * adv_a;
+	er_b += 2 * !adv_a;
+	if (er_a >= len_a) {
+	    counters.Increment<Count>(UnificationState::MAIN, UnificationState::NEXT_ERA);
+	    break;
+	}
+	const int32_t next_a = First ? (int32_t)TEMP_LABEL : era_rowa[er_a / 2];
+	a = adv_a ? next_a : a;
+	counters.Increment<Count>(UnificationState::MAIN, adv_a ? UnificationState::NEXT_ERA :
+				  UnificationState::NEXT_ERB0);
+    }
+}
+
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void unification_new_labels(const Seg_t* restrict rlc_rowa, Seg_t len_a,
+			    int32_t* restrict era_rowa, LabelsSolver& ET, Features& features,
+			    const int16_t row, const int16_t slice) {
+    for (Seg_t er = 1; er < len_a; er += 2) {
+	if (era_rowa[er / 2] == (int32_t)TEMP_LABEL) {
+	    const int32_t a = ET.NewLabel();
+	    features.NewComponent3D<ConfFeatures>(a, row, slice, rlc_rowa[er - 1], rlc_rowa[er]);
+	    era_rowa[er / 2] = a;
+	}
+    }
+}
+
+template <int N>
+template <typename LabelsSolver, typename ConfFeatures, typename Seg_t>
+void Unify_SM_Predicated_Conn<N>::Unify(AdjState<Seg_t, int32_t>& state, Seg_t* restrict RLCi,
+					int32_t* restrict ERAi, seg_arg_t<Seg_t> segment_count,
+					LabelsSolver& ET, Features& features, const int16_t row,
+					const int16_t slice, const seg_arg_t<Seg_t> image_width) {
+    using Conn = typename Conf::Connectivity;
+
+    StateCounters counters;
+    unification_merge_predicated<LabelsSolver, ConfFeatures, Conn::Diag0, true>(
+	RLCi, segment_count, state.RLC0, ERAi, state.ERA0, ET, features, row, slice, counters);
+    if constexpr (Conn::Row1) {
+	unification_merge_predicated<LabelsSolver, ConfFeatures, Conn::Diag1>(
+	    RLCi, segment_count, state.RLC1, ERAi, state.ERA1, ET, features, row, slice, counters);
+    }
+    unification_merge_predicated<LabelsSolver, ConfFeatures, Conn::Diag2>(
+	RLCi, segment_count, state.RLC2, ERAi, state.ERA2, ET, features, row, slice, counters);
+    if constexpr (Conn::Row3) {
+	unification_merge_predicated<LabelsSolver, ConfFeatures, Conn::Diag3>(
+	    RLCi, segment_count, state.RLC3, ERAi, state.ERA3, ET, features, row, slice, counters);
+    }
+    unification_new_labels<LabelsSolver, ConfFeatures>(RLCi, segment_count, ERAi, ET, features,
+							 row, slice);
+}
+
+}
+
+#endif // CCL_ALGOS_3D_UNIFICATION_PREDICATED_HPP
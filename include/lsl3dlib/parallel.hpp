@@ -0,0 +1,149 @@
+#ifndef CCL_PARALLEL_HPP
+#define CCL_PARALLEL_HPP
+
+#include <thread>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+namespace parallel {
+
+// Number of hardware threads (1 when unknown)
+inline int hardware_threads() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : (int)n;
+}
+
+// Run fun(i) for i in [0, n), one thread per index. The calling thread runs index 0.
+// Returns once every call has returned.
+template <typename Fun>
+void parallel_for(int n, Fun fun) {
+    if (n <= 0) {
+	return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(n - 1);
+    for (int i = 1; i < n; i++) {
+	threads.emplace_back(fun, i);
+    }
+    fun(0);
+    for (std::thread& thread : threads) {
+	thread.join();
+    }
+}
+
+// Reusable barrier for `count` threads. The last thread to arrive runs `completion` before the
+// others are released.
+struct Barrier {
+
+    explicit Barrier(int count) : count(count) {}
+
+    template <typename Completion>
+    void ArriveAndWait(Completion completion);
+    void ArriveAndWait() { ArriveAndWait([] {}); }
+
+private:
+    std::mutex mutex;
+    std::condition_variable released;
+    const int count;
+    int waiting = 0;
+    uint64_t generation = 0;
+};
+
+template <typename Completion>
+void Barrier::ArriveAndWait(Completion completion) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (++waiting == count) {
+	completion();
+	waiting = 0;
+	generation++;
+	released.notify_all();
+	return;
+    }
+    const uint64_t current = generation;
+    released.wait(lock, [&] { return generation != current; });
+}
+
+// Work stealing scheduler. Tasks are integers run by fun(task, thread). Each thread owns a deque:
+// it runs its own tasks from the back and, when it is empty, steals from the front of the others.
+// A task can push new tasks (dependent tasks that became ready) on its thread: Run() returns when
+// every task, including the pushed ones, is done.
+struct WorkStealing {
+
+    explicit WorkStealing(int threads)
+	: thread_count(threads), queues(new Queue[threads]), pending(0) {}
+
+    // Before Run() or from a task running on `thread`
+    void Push(int thread, int task);
+
+    template <typename Fun>
+    void Run(Fun fun);
+
+private:
+    struct Queue {
+	std::mutex mutex;
+	std::deque<int> tasks;
+    };
+
+    bool Pop(int thread, int& task);
+    bool Steal(int thread, int& task);
+
+    const int thread_count;
+    std::unique_ptr<Queue[]> queues;
+    std::atomic<int> pending; // Pushed and not done
+};
+
+inline void WorkStealing::Push(int thread, int task) {
+    pending.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(queues[thread].mutex);
+    queues[thread].tasks.push_back(task);
+}
+
+inline bool WorkStealing::Pop(int thread, int& task) {
+    std::lock_guard<std::mutex> lock(queues[thread].mutex);
+    if (queues[thread].tasks.empty()) {
+	return false;
+    }
+    task = queues[thread].tasks.back();
+    queues[thread].tasks.pop_back();
+    return true;
+}
+
+inline bool WorkStealing::Steal(int thread, int& task) {
+    for (int i = 1; i < thread_count; i++) {
+	Queue& victim = queues[(thread + i) % thread_count];
+	std::lock_guard<std::mutex> lock(victim.mutex);
+	if (!victim.tasks.empty()) {
+	    task = victim.tasks.front();
+	    victim.tasks.pop_front();
+	    return true;
+	}
+    }
+    return false;
+}
+
+template <typename Fun>
+void WorkStealing::Run(Fun fun) {
+    parallel_for(thread_count, [&](int thread) {
+	int task;
+	// A task pushes its dependent tasks before it is counted as done: pending only reaches 0
+	// once everything has run
+	while (pending.load(std::memory_order_acquire) > 0) {
+	    if (Pop(thread, task) || Steal(thread, task)) {
+		fun(task, thread);
+		pending.fetch_sub(1, std::memory_order_acq_rel);
+	    } else {
+		std::this_thread::yield();
+	    }
+	}
+    });
+}
+
+}
+
+#endif // CCL_PARALLEL_HPP
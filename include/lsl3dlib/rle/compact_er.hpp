@@ -0,0 +1,88 @@
+#ifndef CCL_ALGOS_RLE_COMPACT_ER_HPP
+#define CCL_ALGOS_RLE_COMPACT_ER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include <simdhelpers/restrict.hpp>
+
+
+namespace rle {
+
+// Compact ER row: the ER row (run index of each pixel, see rle_stdz_er) as a bitmap of the run
+// boundaries and a rank index.
+// - bits: bit x + 1 is set when a run starts or ends at x (x < width), bit 0 stands for ER[-1]
+// - rank: rank[k] is the number of bits set in bits[0..k), one sample per 64-bit word
+// ER[x] = rank[p / 64] + popcount(bits[p / 64] & (bits up to p % 64)), p = x + 1, for x in
+// [-1, width]: ER[-1] = 0 and ER[width] = ER[width - 1] as with the borders of the ER rows.
+// A row takes width / 8 + width / 32 bytes (int16_t) instead of 2 * width: the planes of a 2k
+// wide slice fit in L2. A row of zeros has no run.
+//
+// The row is stored as Seg_t: words 64-bit words then words Seg_t rank samples, 8-byte aligned.
+template <typename Seg_t>
+struct CompactER {
+
+    // 64-bit words of a row (and rank samples)
+    static inline size_t Words(int width) { return ((size_t)width + 2 + 63) / 64; }
+
+    // Size of a row, in Seg_t elements
+    static inline size_t RowSize(int width) {
+	return Words(width) * (sizeof(uint64_t) + sizeof(Seg_t)) / sizeof(Seg_t);
+    }
+
+    // Compact ER row of the RLC row (len entries) into er_row
+    static inline void Build(const Seg_t* restrict rlc_row, Seg_t len, Seg_t* restrict er_row,
+			     int width);
+
+    // ER[x] of the row, x in [-1, width]
+    static inline Seg_t Get(const Seg_t* restrict er_row, size_t words, int32_t x);
+};
+
+
+template <typename Seg_t>
+void CompactER<Seg_t>::Build(const Seg_t* restrict rlc_row, Seg_t len, Seg_t* restrict er_row,
+			     int width) {
+    const size_t words = Words(width);
+    uint64_t* restrict bits = reinterpret_cast<uint64_t*>(er_row);
+    Seg_t* restrict rank = reinterpret_cast<Seg_t*>(bits + words);
+
+    // Words are accumulated in a register, the rank is the number of edges before the word
+    size_t k = 0;
+    uint64_t word = 0;
+    for (Seg_t i = 0; i < len; i++) {
+	// A run ending at width does not change ER[width] (border)
+	const uint32_t p = (uint32_t)rlc_row[i] + 1;
+	if (p > (uint32_t)width) {
+	    break;
+	}
+	for (; k < p / 64; k++) {
+	    bits[k] = word;
+	    rank[k + 1] = i;
+	    word = 0;
+	}
+	word |= UINT64_C(1) << (p % 64);
+    }
+    rank[0] = 0;
+    const Seg_t count = (Seg_t)(rank[k] + __builtin_popcountll(word));
+    bits[k] = word;
+    for (k++; k < words; k++) {
+	bits[k] = 0;
+	rank[k] = count;
+    }
+}
+
+template <typename Seg_t>
+Seg_t CompactER<Seg_t>::Get(const Seg_t* restrict er_row, size_t words, int32_t x) {
+    const uint64_t* restrict bits = reinterpret_cast<const uint64_t*>(er_row);
+    const Seg_t* restrict rank = reinterpret_cast<const Seg_t*>(bits + words);
+
+    const uint32_t p = (uint32_t)(x + 1);
+    // Bits 0..p % 64 of the word (2 << 63 wraps around to 0: every bit)
+    const uint64_t mask = (UINT64_C(2) << (p % 64)) - 1;
+    return rank[p / 64] + (Seg_t)__builtin_popcountll(bits[p / 64] & mask);
+}
+
+}
+
+#endif // CCL_ALGOS_RLE_COMPACT_ER_HPP
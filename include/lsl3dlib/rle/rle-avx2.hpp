@@ -0,0 +1,294 @@
+#ifndef CCL_ALGOS_RLE_AVX2_HPP
+#define CCL_ALGOS_RLE_AVX2_HPP
+
+#ifndef __x86_64__
+#error "X86-64 included despite non-x86-64 platform"
+#endif // __x86_64__
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <immintrin.h>
+
+#include <simdhelpers/restrict.hpp>
+
+#include "lsl3dlib/rle/rle.hpp"
+#include "lsl3dlib/rle/rle-lut.hpp"
+
+namespace rle {
+
+#ifdef __AVX2__
+
+namespace avx2 {
+
+// AVX2 versions of the STDZ encoders: same output as rle_stdz/rle_stdz_er, 32 pixels per
+// iteration.
+// The last (width % 32) pixels are loaded with a 128 bits load when possible, meaning that no
+// more than RLE_IMG_MARGIN_AFTER elements are read after the end of the row. The content of the
+// margin does not need to be 0.
+// Unpadded = true: the last pixels are copied to a local buffer instead, the input row needs no
+// margin (see the *_Unpadded structs).
+template <uint8_t FG = 1, bool Unpadded = false>
+inline int16_t rle_stdz_avx2(const uint8_t* restrict image_row,
+			     int16_t* restrict rlc_row,
+			     int16_t width);
+
+template <uint8_t FG = 1, bool Unpadded = false>
+inline int16_t rle_stdz_er_avx2(const uint8_t* restrict image_row,
+				int16_t* restrict rlc_row,
+				int16_t* restrict ER,
+				int16_t width);
+
+
+struct STDZ {
+
+    struct Conf {
+	static constexpr bool IsBitonal = false;
+	using Seg_t = int16_t;
+	static constexpr bool ER = false;
+	static constexpr size_t SIMD_WORDS = 4; // Number of 64-bits words per SIMD vector
+    };
+
+    template <uint8_t FG = 1>
+    static inline int16_t Line(const uint8_t* restrict image_row, Conf::Seg_t* restrict RLCi,
+			       int16_t* restrict ERi, int16_t width) {
+	return rle_stdz_avx2<FG>(image_row, RLCi, width);
+    }
+};
+
+struct STDZ_ER {
+
+    struct Conf {
+	static constexpr bool IsBitonal = false;
+	using Seg_t = int16_t;
+	static constexpr bool ER = true;
+	static constexpr size_t SIMD_WORDS = 4; // Number of 64-bits words per SIMD vector
+    };
+
+    template <uint8_t FG = 1>
+    static inline int16_t Line(const uint8_t* restrict image_row, Conf::Seg_t* restrict RLCi,
+			       int16_t* restrict ERi, int16_t width) {
+	return rle_stdz_er_avx2<FG>(image_row, RLCi, ERi, width);
+    }
+};
+
+// Variants for rows without margin (memory that is not owned, see create_mat_view).
+// Output rows (RLC, ER) keep their margins.
+struct STDZ_Unpadded {
+
+    struct Conf {
+	static constexpr bool IsBitonal = false;
+	using Seg_t = int16_t;
+	static constexpr bool ER = false;
+	static constexpr size_t SIMD_WORDS = 4; // Number of 64-bits words per SIMD vector
+    };
+
+    template <uint8_t FG = 1>
+    static inline int16_t Line(const uint8_t* restrict image_row, Conf::Seg_t* restrict RLCi,
+			       int16_t* restrict ERi, int16_t width) {
+	return rle_stdz_avx2<FG, true>(image_row, RLCi, width);
+    }
+};
+
+struct STDZ_ER_Unpadded {
+
+    struct Conf {
+	static constexpr bool IsBitonal = false;
+	using Seg_t = int16_t;
+	static constexpr bool ER = true;
+	static constexpr size_t SIMD_WORDS = 4; // Number of 64-bits words per SIMD vector
+    };
+
+    template <uint8_t FG = 1>
+    static inline int16_t Line(const uint8_t* restrict image_row, Conf::Seg_t* restrict RLCi,
+			       int16_t* restrict ERi, int16_t width) {
+	return rle_stdz_er_avx2<FG, true>(image_row, RLCi, ERi, width);
+    }
+};
+
+
+// Shift `in` by one byte toward the most significant byte.
+// The least significant byte is taken from the most significant byte of `last`.
+inline __m256i vec_right_8x32(__m256i last, __m256i in) {
+    // [last.hi, in.lo]: needed because _mm256_alignr_epi8 works on each 128 bits lane
+    __m256i carry = _mm256_permute2x128_si256(last, in, 0x21);
+    return _mm256_alignr_epi8(in, carry, 15);
+}
+
+// Edge detection: 0xff wherever a pixel differs from its left neighbour
+template <uint8_t FG>
+inline __m256i edges_8x32(__m256i last, __m256i in) {
+    __m256i shift = vec_right_8x32(last, in);
+    if (FG == 0xff) {
+	return _mm256_xor_si256(in, shift);
+    }
+    __m256i f = _mm256_cmpeq_epi8(in, shift);
+    return _mm256_xor_si256(f, _mm256_set1_epi8(-1));
+}
+
+// Load the last `rem` (< 32) pixels of a row.
+// Never reads more than RLE_IMG_MARGIN_AFTER elements after the end of the row.
+inline __m256i load_tail_8x32(const uint8_t* restrict image_row, int16_t rem) {
+    if (rem > 16) {
+	return _mm256_loadu_si256((const __m256i*)image_row);
+    }
+    return _mm256_zextsi128_si256(_mm_loadu_si128((const __m128i*)image_row));
+}
+
+// Load the last `rem` (< 32) pixels of a row. Elements after `rem` are set to 0.
+// Nothing is read after the end of the row.
+inline __m256i load_partial_8x32(const uint8_t* restrict image_row, int16_t rem) {
+    alignas(32) uint8_t buffer[32] = {0};
+    memcpy(buffer, image_row, rem);
+    return _mm256_load_si256((const __m256i*)buffer);
+}
+
+template <bool Unpadded>
+inline __m256i load_last_8x32(const uint8_t* restrict image_row, int16_t rem) {
+    return Unpadded ? load_partial_8x32(image_row, rem) : load_tail_8x32(image_row, rem);
+}
+
+// Store the column index of every bit set in `mask` (16 bits).
+// `ids` holds the indices of the 16 columns covered by `mask`.
+inline int16_t* compress_store_16x16(uint32_t mask, __m256i ids, int16_t* restrict RLCi) {
+    uint32_t m0 = mask & 0xff;
+    uint32_t m1 = (mask >> 8) & 0xff;
+
+    __m128i shuf0 = _mm_load_si128((const __m128i*)(rle::LUT16x8 + 16 * m0));
+    __m128i shuf1 = _mm_load_si128((const __m128i*)(rle::LUT16x8 + 16 * m1));
+    __m256i shuffle = _mm256_inserti128_si256(_mm256_castsi128_si256(shuf0), shuf1, 1);
+    __m256i rlc = _mm256_shuffle_epi8(ids, shuffle);
+
+    int popcnt0 = __builtin_popcount(m0);
+    _mm_storeu_si128((__m128i*)RLCi, _mm256_castsi256_si128(rlc));
+    _mm_storeu_si128((__m128i*)(RLCi + popcnt0), _mm256_extracti128_si256(rlc, 1));
+    return RLCi + popcnt0 + __builtin_popcount(m1);
+}
+
+template <uint8_t FG, bool Unpadded>
+int16_t rle_stdz_avx2(const uint8_t* restrict image_row,
+		      int16_t* restrict rlc_row,
+		      int16_t width) {
+
+    int16_t* restrict RLCi = rlc_row;
+
+    __m256i last = _mm256_setzero_si256();
+    // Used to get proper line numbers after applying a mask
+    __m256i index0 = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7,
+				       8, 9, 10, 11, 12, 13, 14, 15);
+    __m256i index1 = _mm256_add_epi16(index0, _mm256_set1_epi16(16));
+    const __m256i incr32 = _mm256_set1_epi16(32);
+
+    int i = 0;
+    for (; i + 32 <= width; i += 32) {
+	__m256i in = _mm256_loadu_si256((const __m256i*)(image_row + i));
+	uint32_t mask = _mm256_movemask_epi8(edges_8x32<FG>(last, in));
+	last = in;
+
+	// Background and foreground areas: nothing to write
+	if (mask != 0) {
+	    RLCi = compress_store_16x16(mask & 0xffff, index0, RLCi);
+	    RLCi = compress_store_16x16(mask >> 16, index1, RLCi);
+	}
+
+	index0 = _mm256_add_epi16(index0, incr32);
+	index1 = _mm256_add_epi16(index1, incr32);
+    }
+
+    if (i < width) {
+	int16_t rem = width - i;
+	__m256i in = load_last_8x32<Unpadded>(image_row + i, rem);
+	uint32_t mask = _mm256_movemask_epi8(edges_8x32<FG>(last, in));
+	mask &= (1U << rem) - 1; // Ignore whatever is after the end of the row
+
+	RLCi = compress_store_16x16(mask & 0xffff, index0, RLCi);
+	RLCi = compress_store_16x16(mask >> 16, index1, RLCi);
+    }
+
+    return rle_stdz_end(rlc_row, RLCi, width);
+}
+
+template <uint8_t FG, bool Unpadded>
+int16_t rle_stdz_er_avx2(const uint8_t* restrict image_row,
+			 int16_t* restrict rlc_row,
+			 int16_t* restrict ER,
+			 int16_t width) {
+
+    int16_t* restrict RLCi = rlc_row;
+    int16_t er = 0;
+
+    __m256i last = _mm256_setzero_si256();
+    __m256i index0 = _mm256_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7,
+				       8, 9, 10, 11, 12, 13, 14, 15);
+    __m256i index1 = _mm256_add_epi16(index0, _mm256_set1_epi16(16));
+    const __m256i incr32 = _mm256_set1_epi16(32);
+
+    ER[-1] = 0;
+
+    for (int i = 0; i < width; i += 32) {
+	int16_t rem = width - i;
+
+	__m256i in;
+	if (rem >= 32) {
+	    in = _mm256_loadu_si256((const __m256i*)(image_row + i));
+	} else {
+	    in = load_last_8x32<Unpadded>(image_row + i, rem);
+	}
+	__m256i f = edges_8x32<FG>(last, in);
+	uint32_t mask = _mm256_movemask_epi8(f);
+	if (rem < 32) {
+	    mask &= (1U << rem) - 1;
+	}
+	last = in;
+
+	RLCi = compress_store_16x16(mask & 0xffff, index0, RLCi);
+	RLCi = compress_store_16x16(mask >> 16, index1, RLCi);
+
+	// Prefix sum of the edges on each 128 bits lane
+	__m256i fscan = _mm256_and_si256(f, _mm256_set1_epi8(1));
+	fscan = _mm256_add_epi8(fscan, _mm256_slli_si256(fscan, 1));
+	fscan = _mm256_add_epi8(fscan, _mm256_slli_si256(fscan, 2));
+	fscan = _mm256_add_epi8(fscan, _mm256_slli_si256(fscan, 4));
+	fscan = _mm256_add_epi8(fscan, _mm256_slli_si256(fscan, 8));
+
+	// Propagate the total of the low lane to the high lane
+	__m256i carry = _mm256_shuffle_epi8(fscan, _mm256_set1_epi8(15));
+	carry = _mm256_permute2x128_si256(carry, carry, 0x08);
+	fscan = _mm256_add_epi8(fscan, carry);
+
+	__m256i ver = _mm256_set1_epi16(er);
+	__m256i lver = _mm256_add_epi16(ver, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(fscan)));
+	__m256i hver = _mm256_add_epi16(ver, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(fscan, 1)));
+
+	if (rem >= 32) {
+	    _mm256_storeu_si256((__m256i*)(ER + i), lver);
+	    _mm256_storeu_si256((__m256i*)(ER + i + 16), hver);
+	} else {
+	    // Write by blocks of 8 elements to stay within RLE_ER_MARGIN_AFTER
+	    _mm_storeu_si128((__m128i*)(ER + i), _mm256_castsi256_si128(lver));
+	    if (rem > 8) {
+		_mm_storeu_si128((__m128i*)(ER + i + 8), _mm256_extracti128_si256(lver, 1));
+	    }
+	    if (rem > 16) {
+		_mm_storeu_si128((__m128i*)(ER + i + 16), _mm256_castsi256_si128(hver));
+	    }
+	    if (rem > 24) {
+		_mm_storeu_si128((__m128i*)(ER + i + 24), _mm256_extracti128_si256(hver, 1));
+	    }
+	}
+
+	er += __builtin_popcount(mask);
+	index0 = _mm256_add_epi16(index0, incr32);
+	index1 = _mm256_add_epi16(index1, incr32);
+    }
+
+    return rle_stdz_end(rlc_row, RLCi, width);
+}
+
+}
+
+#endif // __AVX2__
+
+}
+
+#endif // CCL_ALGOS_RLE_AVX2_HPP
@@ -0,0 +1,224 @@
+#ifndef CCL_ALGOS_RLE_AVX512_HPP
+#define CCL_ALGOS_RLE_AVX512_HPP
+
+#ifndef __x86_64__
+#error "X86-64 included despite non-x86-64 platform"
+#endif // __x86_64__
+
+#include <cstdint>
+#include <cstddef>
+#include <immintrin.h>
+
+#include <simdhelpers/restrict.hpp>
+
+#include "lsl3dlib/rle/rle.hpp"
+
+namespace rle {
+
+#if defined(__AVX512BW__) && defined(__AVX512VBMI2__)
+
+namespace avx512 {
+
+// AVX512 versions of the STDZ encoders: 64 pixels per iteration.
+// Edge detection is done on the 64 bits foreground mask and segment bounds are compacted with
+// vpcompressw: no shuffle table is involved (compare to sse::LUT8x16, 1 MB).
+// The tail of the row is read with masked loads: no margin is required after the input row.
+template <uint8_t FG = 1>
+inline int16_t rle_stdz_avx512(const uint8_t* restrict image_row,
+			       int16_t* restrict rlc_row,
+			       int16_t width);
+
+template <uint8_t FG = 1>
+inline int16_t rle_stdz_er_avx512(const uint8_t* restrict image_row,
+				  int16_t* restrict rlc_row,
+				  int16_t* restrict ER,
+				  int16_t width);
+
+
+struct STDZ {
+
+    struct Conf {
+	static constexpr bool IsBitonal = false;
+	using Seg_t = int16_t;
+	static constexpr bool ER = false;
+	static constexpr size_t SIMD_WORDS = 8; // Number of 64-bits words per SIMD vector
+    };
+
+    template <uint8_t FG = 1>
+    static inline int16_t Line(const uint8_t* restrict image_row, Conf::Seg_t* restrict RLCi,
+			       int16_t* restrict ERi, int16_t width) {
+	return rle_stdz_avx512<FG>(image_row, RLCi, width);
+    }
+};
+
+struct STDZ_ER {
+
+    struct Conf {
+	static constexpr bool IsBitonal = false;
+	using Seg_t = int16_t;
+	static constexpr bool ER = true;
+	static constexpr size_t SIMD_WORDS = 8; // Number of 64-bits words per SIMD vector
+    };
+
+    template <uint8_t FG = 1>
+    static inline int16_t Line(const uint8_t* restrict image_row, Conf::Seg_t* restrict RLCi,
+			       int16_t* restrict ERi, int16_t width) {
+	return rle_stdz_er_avx512<FG>(image_row, RLCi, ERi, width);
+    }
+};
+
+// Masked loads: the encoders above never need a margin on the input row
+using STDZ_Unpadded = STDZ;
+using STDZ_ER_Unpadded = STDZ_ER;
+
+
+// Load up to 64 pixels. Elements after `rem` are set to 0 and never read.
+inline __m512i load_8x64(const uint8_t* restrict image_row, int16_t rem) {
+    if (rem >= 64) {
+	return _mm512_loadu_si512((const void*)image_row);
+    }
+    return _mm512_maskz_loadu_epi8((1ULL << rem) - 1, image_row);
+}
+
+// 1 bit per foreground pixel
+// Same as the scalar versions: & 1 is enough for {0; 1} images, {0; 255} images may use FG=0xff
+template <uint8_t FG>
+inline uint64_t foreground_8x64(__m512i in) {
+    return _mm512_test_epi8_mask(in, _mm512_set1_epi8(FG));
+}
+
+// Store the column index of every bit set in `mask`.
+// `index0` and `index1` hold the indices of the first and last 32 columns covered by `mask`
+inline int16_t* compress_store_16x64(uint64_t mask, __m512i index0, __m512i index1,
+				     int16_t* restrict RLCi) {
+    __mmask32 m0 = (__mmask32)mask;
+    __mmask32 m1 = (__mmask32)(mask >> 32);
+    int popcnt0 = __builtin_popcount(m0);
+    int popcnt1 = __builtin_popcount(m1);
+
+    __m512i rlc0 = _mm512_maskz_compress_epi16(m0, index0);
+    __m512i rlc1 = _mm512_maskz_compress_epi16(m1, index1);
+
+    // Masked stores: only the compacted elements are written
+    _mm512_mask_storeu_epi16(RLCi, (__mmask32)((1ULL << popcnt0) - 1), rlc0);
+    RLCi += popcnt0;
+    _mm512_mask_storeu_epi16(RLCi, (__mmask32)((1ULL << popcnt1) - 1), rlc1);
+    return RLCi + popcnt1;
+}
+
+template <uint8_t FG>
+int16_t rle_stdz_avx512(const uint8_t* restrict image_row,
+			int16_t* restrict rlc_row,
+			int16_t width) {
+
+    int16_t* restrict RLCi = rlc_row;
+
+    __m512i index0 = _mm512_set_epi16(31, 30, 29, 28, 27, 26, 25, 24,
+				      23, 22, 21, 20, 19, 18, 17, 16,
+				      15, 14, 13, 12, 11, 10, 9, 8,
+				      7, 6, 5, 4, 3, 2, 1, 0);
+    __m512i index1 = _mm512_add_epi16(index0, _mm512_set1_epi16(32));
+    const __m512i incr64 = _mm512_set1_epi16(64);
+
+    uint64_t carry = 0; // Last pixel of the previous block
+
+    for (int i = 0; i < width; i += 64) {
+	int16_t rem = width - i;
+	__m512i in = load_8x64(image_row + i, rem);
+	uint64_t fg = foreground_8x64<FG>(in);
+
+	// Edge detection in the mask domain
+	uint64_t edges = fg ^ ((fg << 1) | carry);
+	carry = fg >> 63;
+	if (rem < 64) {
+	    edges &= (1ULL << rem) - 1; // Closing edge is added by rle_stdz_end
+	}
+
+	if (edges != 0) {
+	    RLCi = compress_store_16x64(edges, index0, index1, RLCi);
+	}
+
+	index0 = _mm512_add_epi16(index0, incr64);
+	index1 = _mm512_add_epi16(index1, incr64);
+    }
+
+    return rle_stdz_end(rlc_row, RLCi, width);
+}
+
+template <uint8_t FG>
+int16_t rle_stdz_er_avx512(const uint8_t* restrict image_row,
+			   int16_t* restrict rlc_row,
+			   int16_t* restrict ER,
+			   int16_t width) {
+
+    int16_t* restrict RLCi = rlc_row;
+    int16_t er = 0;
+
+    __m512i index0 = _mm512_set_epi16(31, 30, 29, 28, 27, 26, 25, 24,
+				      23, 22, 21, 20, 19, 18, 17, 16,
+				      15, 14, 13, 12, 11, 10, 9, 8,
+				      7, 6, 5, 4, 3, 2, 1, 0);
+    __m512i index1 = _mm512_add_epi16(index0, _mm512_set1_epi16(32));
+    const __m512i incr64 = _mm512_set1_epi16(64);
+    constexpr uint64_t BYTES = 0x0101010101010101ULL;
+
+    uint64_t carry = 0;
+
+    ER[-1] = 0;
+
+    for (int i = 0; i < width; i += 64) {
+	int16_t rem = width - i;
+	__m512i in = load_8x64(image_row + i, rem);
+	uint64_t fg = foreground_8x64<FG>(in);
+
+	uint64_t edges = fg ^ ((fg << 1) | carry);
+	carry = fg >> 63;
+	if (rem < 64) {
+	    edges &= (1ULL << rem) - 1; // Closing edge is added by rle_stdz_end
+	}
+
+	RLCi = compress_store_16x64(edges, index0, index1, RLCi);
+
+	// Prefix sum of the edges on each 128 bits lane
+	__m512i fscan = _mm512_maskz_mov_epi8(edges, _mm512_set1_epi8(1));
+	fscan = _mm512_add_epi8(fscan, _mm512_bslli_epi128(fscan, 1));
+	fscan = _mm512_add_epi8(fscan, _mm512_bslli_epi128(fscan, 2));
+	fscan = _mm512_add_epi8(fscan, _mm512_bslli_epi128(fscan, 4));
+	fscan = _mm512_add_epi8(fscan, _mm512_bslli_epi128(fscan, 8));
+
+	// Propagate the totals of the previous lanes
+	uint64_t c1 = __builtin_popcountll(edges & 0xffff);
+	uint64_t c2 = c1 + __builtin_popcountll(edges & 0xffff0000);
+	uint64_t c3 = c2 + __builtin_popcountll(edges & 0xffff00000000);
+	__m512i lanes = _mm512_set_epi64(c3 * BYTES, c3 * BYTES, c2 * BYTES, c2 * BYTES,
+					 c1 * BYTES, c1 * BYTES, 0, 0);
+	fscan = _mm512_add_epi8(fscan, lanes);
+
+	__m512i ver = _mm512_set1_epi16(er);
+	__m512i lver = _mm512_add_epi16(ver, _mm512_cvtepu8_epi16(_mm512_castsi512_si256(fscan)));
+	__m512i hver = _mm512_add_epi16(ver, _mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(fscan, 1)));
+
+	if (rem >= 64) {
+	    _mm512_storeu_si512((void*)(ER + i), lver);
+	    _mm512_storeu_si512((void*)(ER + i + 32), hver);
+	} else {
+	    uint64_t tail = (1ULL << rem) - 1;
+	    _mm512_mask_storeu_epi16(ER + i, (__mmask32)tail, lver);
+	    _mm512_mask_storeu_epi16(ER + i + 32, (__mmask32)(tail >> 32), hver);
+	}
+
+	er += __builtin_popcountll(edges);
+	index0 = _mm512_add_epi16(index0, incr64);
+	index1 = _mm512_add_epi16(index1, incr64);
+    }
+
+    return rle_stdz_end(rlc_row, RLCi, width);
+}
+
+}
+
+#endif // __AVX512BW__ && __AVX512VBMI2__
+
+}
+
+#endif // CCL_ALGOS_RLE_AVX512_HPP
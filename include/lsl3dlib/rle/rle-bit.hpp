@@ -0,0 +1,166 @@
+#ifndef CCL_ALGOS_RLE_BIT_HPP
+#define CCL_ALGOS_RLE_BIT_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#include <simdhelpers/restrict.hpp>
+
+#include "lsl3dlib/rle/rle.hpp"
+
+namespace rle {
+
+namespace bit {
+
+// RLE of bit-packed rows (1 bit per pixel): pixel `col` is bit (col % 64) of word (col / 64),
+// least significant bit first. A row of `width` pixels is stored in (width + 63) / 64 words.
+// Bits after the end of the row are ignored: no margin is required for the input. ER rows need
+// RLE_ER_MARGIN_AFTER elements, as for the other encoders.
+// The drivers read the rows of the image as words (Conf::Pixel_t, see rle::pixel_t): the image
+// of LSL3D is a byte header over them (create_byte_view).
+//
+// Output is the same as rle_stdz/rle_stdz_er. Edges are found 64 pixels at a time, and words
+// without any edge (only background or only foreground) cost a single test.
+
+inline int16_t rle_stdz_bit(const uint64_t* restrict image_row,
+			    int16_t* restrict rlc_row,
+			    int16_t width);
+
+inline int16_t rle_stdz_er_bit(const uint64_t* restrict image_row,
+			       int16_t* restrict rlc_row,
+			       int16_t* restrict ER,
+			       int16_t width);
+
+
+struct STDZ {
+
+    struct Conf {
+	static constexpr bool IsBitonal = true;
+	using Seg_t = int16_t;
+	using Word_t = uint64_t;
+	using Pixel_t = Word_t; // Rows read by the drivers (rle::pixel_t)
+	static constexpr bool ER = false;
+	static constexpr size_t SIMD_WORDS = 1; // Number of 64-bits words per SIMD vector
+    };
+
+    // FG is only here for compatibility with the other encoders: set bits are foreground
+    template <uint8_t FG = 1>
+    static inline int16_t Line(const Conf::Word_t* restrict image_row, Conf::Seg_t* restrict RLCi,
+			       int16_t* restrict ERi, int16_t width) {
+	return rle_stdz_bit(image_row, RLCi, width);
+    }
+};
+
+struct STDZ_ER {
+
+    struct Conf {
+	static constexpr bool IsBitonal = true;
+	using Seg_t = int16_t;
+	using Word_t = uint64_t;
+	using Pixel_t = Word_t; // Rows read by the drivers (rle::pixel_t)
+	static constexpr bool ER = true;
+	static constexpr size_t SIMD_WORDS = 1; // Number of 64-bits words per SIMD vector
+    };
+
+    template <uint8_t FG = 1>
+    static inline int16_t Line(const Conf::Word_t* restrict image_row, Conf::Seg_t* restrict RLCi,
+			       int16_t* restrict ERi, int16_t width) {
+	return rle_stdz_er_bit(image_row, RLCi, ERi, width);
+    }
+};
+
+
+// 4-bit edge mask -> ER increments of each of the 4 pixels (4x16 bits)
+constexpr uint64_t ER_LUT_4x16[16] = {
+    0x0000000000000000, 0x0001000100010001, 0x0001000100010000, 0x0002000200020001,
+    0x0001000100000000, 0x0002000200010001, 0x0002000200010000, 0x0003000300020001,
+    0x0001000000000000, 0x0002000100010001, 0x0002000100010000, 0x0003000200020001,
+    0x0002000100000000, 0x0003000200010001, 0x0003000200010000, 0x0004000300020001,
+};
+
+// Bit i is set when pixel i differs from pixel i - 1.
+// `carry` holds the last pixel of the previous word and is updated.
+inline uint64_t edges_1x64(uint64_t word, uint64_t& carry) {
+    uint64_t edges = word ^ ((word << 1) | carry);
+    carry = word >> 63;
+    return edges;
+}
+
+int16_t rle_stdz_bit(const uint64_t* restrict image_row,
+		     int16_t* restrict rlc_row,
+		     int16_t width) {
+
+    int16_t* restrict RLCi = rlc_row;
+    uint64_t carry = 0;
+
+    for (int i = 0; i < width; i += 64) {
+	uint64_t word = image_row[i / 64];
+	uint64_t edges = edges_1x64(word, carry);
+	int rem = width - i;
+	if (rem < 64) {
+	    edges &= (1ULL << rem) - 1; // Closing edge is added by rle_stdz_end
+	}
+
+	while (edges != 0) {
+	    *RLCi++ = i + __builtin_ctzll(edges);
+	    edges &= edges - 1; // Clear lowest bit
+	}
+    }
+
+    return rle_stdz_end(rlc_row, RLCi, width);
+}
+
+int16_t rle_stdz_er_bit(const uint64_t* restrict image_row,
+			int16_t* restrict rlc_row,
+			int16_t* restrict ER,
+			int16_t width) {
+
+    int16_t* restrict RLCi = rlc_row;
+    uint64_t carry = 0;
+    int16_t er = 0;
+
+    ER[-1] = 0;
+
+    for (int i = 0; i < width; i += 64) {
+	uint64_t word = image_row[i / 64];
+	uint64_t edges = edges_1x64(word, carry);
+	int rem = width - i;
+	int end = 64;
+	if (rem < 64) {
+	    edges &= (1ULL << rem) - 1;
+	    end = rem;
+	}
+
+	int16_t* restrict ERi = ER + i;
+	if (edges == 0) {
+	    // ER is constant over the whole word
+	    for (int col = 0; col < end; col++) {
+		ERi[col] = er;
+	    }
+	    continue;
+	}
+
+	// 4 pixels at a time: the position of the edges is not predictable, avoid branches
+	uint64_t e = edges;
+	for (int col = 0; col < end; col += 4) {
+	    uint64_t ver = ER_LUT_4x16[e & 0xf] + (uint64_t)(uint16_t)er * 0x0001000100010001ULL;
+	    memcpy(ERi + col, &ver, sizeof(ver)); // Up to 3 elements in RLE_ER_MARGIN_AFTER
+	    er += __builtin_popcountll(e & 0xf);
+	    e >>= 4;
+	}
+
+	while (edges != 0) {
+	    *RLCi++ = i + __builtin_ctzll(edges);
+	    edges &= edges - 1;
+	}
+    }
+
+    return rle_stdz_end(rlc_row, RLCi, width);
+}
+
+}
+
+}
+
+#endif // CCL_ALGOS_RLE_BIT_HPP
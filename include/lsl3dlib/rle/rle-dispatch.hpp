@@ -0,0 +1,58 @@
+#ifndef CCL_ALGOS_RLE_DISPATCH_HPP
+#define CCL_ALGOS_RLE_DISPATCH_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+#include <simdhelpers/restrict.hpp>
+
+#include <lsl3dlib/dispatch.hpp>
+
+namespace rle {
+
+namespace dispatch {
+
+// STDZ encoders selected at runtime: scalar, sse::STDZ_Unpadded / sse::STDZ_ER_Unpadded, avx2::
+// or avx512:: depending on cpu::level(). No margin is required after the input row, ER rows need
+// RLE_ER_MARGIN_AFTER elements.
+// Only FG = 1 and FG = 0xff are available.
+
+struct STDZ {
+
+    struct Conf {
+	static constexpr bool IsBitonal = false;
+	using Seg_t = int16_t;
+	static constexpr bool ER = false;
+	static constexpr size_t SIMD_WORDS = 8; // Widest kernel (AVX512)
+    };
+
+    template <uint8_t FG = 1>
+    static inline int16_t Line(const uint8_t* restrict image_row, Conf::Seg_t* restrict RLCi,
+			       int16_t* restrict ERi, int16_t width) {
+	static_assert(FG == 1 || FG == 0xff, "Only FG = 1 and FG = 0xff are dispatched");
+	return ::dispatch::kernels.stdz[FG == 0xff](image_row, RLCi, ERi, width);
+    }
+};
+
+struct STDZ_ER {
+
+    struct Conf {
+	static constexpr bool IsBitonal = false;
+	using Seg_t = int16_t;
+	static constexpr bool ER = true;
+	static constexpr size_t SIMD_WORDS = 8; // Widest kernel (AVX512)
+    };
+
+    template <uint8_t FG = 1>
+    static inline int16_t Line(const uint8_t* restrict image_row, Conf::Seg_t* restrict RLCi,
+			       int16_t* restrict ERi, int16_t width) {
+	static_assert(FG == 1 || FG == 0xff, "Only FG = 1 and FG = 0xff are dispatched");
+	return ::dispatch::kernels.stdz_er[FG == 0xff](image_row, RLCi, ERi, width);
+    }
+};
+
+}
+
+}
+
+#endif // CCL_ALGOS_RLE_DISPATCH_HPP
@@ -0,0 +1,22 @@
+#ifndef CCL_ALGOS_RLE_LUT_HPP
+#define CCL_ALGOS_RLE_LUT_HPP
+
+// Shuffle tables of the SIMD encoders, defined in rle-sse.cpp, which is compiled with the
+// baseline flags when LSL_SIMD_DISPATCH is set: the encoders of every ISA share them.
+
+namespace rle {
+
+// 8-bit mask -> shuffle selecting the matching 16 bits words.
+// Only 4KB: unlike sse::LUT8x16, it stays in L1 during the whole RLE.
+extern unsigned char LUT16x8[256 * 16] __attribute__ ((aligned (16)));
+
+namespace sse {
+
+// 16-bit mask -> shuffle selecting the matching bytes (1 MB, filled by lut_init_8x16)
+extern unsigned char LUT8x16[256 * 256 * 16] __attribute__((aligned(16)));
+
+}
+
+}
+
+#endif // CCL_ALGOS_RLE_LUT_HPP
@@ -11,6 +11,7 @@
 #include <emmintrin.h>
 
 #include <cassert>
+#include <cstring>
 
 
 #include <lsl3dlib/utility.hpp>
@@ -19,16 +20,14 @@
 #include <simdhelpers/compress/compress-sse.hpp>
 #include <simdhelpers/restrict.hpp>
 
-namespace rle {
+#include <lsl3dlib/rle/rle-lut.hpp>
 
-extern unsigned char LUT16x8[256 * 16] __attribute__ ((aligned (16)));
+namespace rle {
 
 #ifdef __SSE4_2__
 
 namespace sse {
 
-extern unsigned char LUT8x16[256 * 256 * 16] __attribute__((aligned(16)));
-
 inline int lut_init_8x16() {
     for (int i = 0; i < 65536; i++) {
 
@@ -78,10 +77,22 @@ inline uint16_t compress_16x16(__m128i entry, __m128i ids, __m128i& res) {
     return __builtin_popcount(mask);
 }
 
+// Load the last `rem` (< 16) pixels of a row. Elements after `rem` are set to 0.
+// Nothing is read after the end of the row.
+inline __m128i load_partial_8x16(const uint8_t* restrict image_row, int rem) {
+    alignas(16) uint8_t buffer[16] = {0};
+    memcpy(buffer, image_row, rem);
+    return _mm_load_si128((const __m128i*)buffer);
+}
+
+// Only reads the `width` pixels of the row: rle_stdz_sse4 works on unpadded rows.
 inline int16_t rle_stdz_sse4(const uint8_t* restrict image_row,
 			     int16_t* restrict rlc_row,
 			     int16_t width);
-template<uint8_t FG = 1>
+
+// Unpadded = false: reads up to RLE_IMG_MARGIN_AFTER pixels after the row, they must be 0.
+// Unpadded = true: the last block is loaded with load_partial_8x16, the input row needs no margin.
+template<uint8_t FG = 1, bool Unpadded = false>
 inline int16_t rle_stdz_er_sse4(const uint8_t* restrict image_row,
 				int16_t* restrict RLC,
 				int16_t* restrict ER,
@@ -149,6 +160,26 @@ struct STDZ_ER {
     }
 };
 
+// Variants for rows without margin (memory that is not owned, see create_mat_view).
+// Output rows (RLC, ER) keep their margins.
+using STDZ_Unpadded = STDZ;
+
+struct STDZ_ER_Unpadded {
+    
+    struct Conf {
+	static constexpr bool IsBitonal = false;
+	using Seg_t = int16_t;
+	static constexpr bool ER = true;
+	static constexpr size_t SIMD_WORDS = 2; // Number of 64-bits words per SIMD vector
+    };
+
+    template <uint8_t FG = 1>
+    static inline uint16_t Line(const uint8_t* restrict image_row, Conf::Seg_t* restrict RLCi,
+			       int16_t* restrict ERi, int16_t width) {
+	return rle_stdz_er_sse4<FG, true>(image_row, RLCi, ERi, width);
+    }
+};
+
 
 inline int16_t rle_stdz_sse4(const uint8_t* restrict image_row,
 			     int16_t* restrict rlc_row,
@@ -330,7 +361,7 @@ int16_t STDZ_V3::Line(const uint8_t *restrict line, Conf::Seg_t *restrict RLC, i
     return n;
 }
 
-template<uint8_t FG>
+template<uint8_t FG, bool Unpadded>
 inline int16_t rle_stdz_er_sse4(const uint8_t* restrict image,
 			     int16_t* restrict RLC,
 			     int16_t* restrict ER,
@@ -350,7 +381,12 @@ inline int16_t rle_stdz_er_sse4(const uint8_t* restrict image,
     int i = 0;
     
     for (i = 0; i < width; i += 16) {
-          __m128i in = _mm_loadu_si128((__m128i*)(image + i));
+          __m128i in;
+          if (Unpadded && i + 16 > width) {
+            in = load_partial_8x16(image + i, width - i);
+          } else {
+            in = _mm_loadu_si128((__m128i*)(image + i));
+          }
           __m128i f;
           if (FG == 0xff) {
             f = _mm_xor_si128(in, _mm_alignr_epi8(in, last, 15));
@@ -0,0 +1,299 @@
+#ifndef CCL_ALGOS_RLE_THRESHOLD_HPP
+#define CCL_ALGOS_RLE_THRESHOLD_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+#include <simdhelpers/restrict.hpp>
+
+#include "lsl3dlib/rle/rle.hpp"
+#include "lsl3dlib/rle/rle-lut.hpp"
+#include "lsl3dlib/rle/rle-bit.hpp"
+
+#ifdef __SSE4_2__
+#include <immintrin.h>
+#endif // __SSE4_2__
+
+namespace rle {
+
+// Binarization fused with the RLE: the encoders below read grayscale rows (uint8_t, uint16_t or
+// float) and a pixel is foreground when it satisfies the predicate. Output is the same as
+// rle_stdz/rle_stdz_er on the binarized row.
+//
+// Predicates are evaluated 16 pixels at a time (Mask16, SSE4.2 when available). The end of the
+// row is evaluated pixel by pixel: no margin is required after the input row.
+//
+// The levels are part of the type, as FG for the binary encoders: Line() is static and the
+// encoders are used by the drivers as any other (rows read as Conf::Pixel_t, see rle::pixel_t).
+// A level is a type with a static constexpr value (no floating point template parameters in
+// C++17): Level<uint16_t, 1000>, or struct Half { static constexpr float value = 0.5f; }.
+// Usage: LSL3D<rle::STDZ_Threshold<rle::Threshold<uint16_t, rle::Level<uint16_t, 1000>>>, ...>
+
+template <typename T, T V>
+using Level = std::integral_constant<T, V>;
+
+// Foreground: pixel >= Low::value
+template <typename T, typename Low>
+struct Threshold {
+    using Pixel_t = T;
+
+    static inline bool Test(T v) { return v >= (T)Low::value; }
+    static inline uint32_t Mask16(const T* restrict row);
+};
+
+// Foreground: Low::value <= pixel <= High::value
+template <typename T, typename Low, typename High>
+struct Interval {
+    using Pixel_t = T;
+
+    static inline bool Test(T v) { return v >= (T)Low::value && v <= (T)High::value; }
+    static inline uint32_t Mask16(const T* restrict row);
+};
+
+
+template <typename Predicate>
+inline int16_t rle_stdz_pred(const typename Predicate::Pixel_t* restrict image_row,
+			     int16_t* restrict rlc_row,
+			     int16_t width);
+
+template <typename Predicate>
+inline int16_t rle_stdz_er_pred(const typename Predicate::Pixel_t* restrict image_row,
+				int16_t* restrict rlc_row,
+				int16_t* restrict ER,
+				int16_t width);
+
+
+template <typename Predicate>
+struct STDZ_Threshold {
+
+    struct Conf {
+	static constexpr bool IsBitonal = false;
+	using Seg_t = int16_t;
+	using Pixel_t = typename Predicate::Pixel_t;
+	static constexpr bool ER = false;
+	static constexpr size_t SIMD_WORDS = 2; // Number of 64-bits words per SIMD vector
+    };
+
+    // FG is only here for compatibility with the other encoders: Predicate selects the foreground
+    template <uint8_t FG = 1>
+    static inline int16_t Line(const typename Conf::Pixel_t* restrict image_row,
+			       typename Conf::Seg_t* restrict RLCi,
+			       int16_t* restrict ERi, int16_t width) {
+	return rle_stdz_pred<Predicate>(image_row, RLCi, width);
+    }
+};
+
+template <typename Predicate>
+struct STDZ_ER_Threshold {
+
+    struct Conf {
+	static constexpr bool IsBitonal = false;
+	using Seg_t = int16_t;
+	using Pixel_t = typename Predicate::Pixel_t;
+	static constexpr bool ER = true;
+	static constexpr size_t SIMD_WORDS = 2; // Number of 64-bits words per SIMD vector
+    };
+
+    template <uint8_t FG = 1>
+    static inline int16_t Line(const typename Conf::Pixel_t* restrict image_row,
+			       typename Conf::Seg_t* restrict RLCi,
+			       int16_t* restrict ERi, int16_t width) {
+	return rle_stdz_er_pred<Predicate>(image_row, RLCi, ERi, width);
+    }
+};
+
+
+namespace threshold {
+
+// 1 bit per pixel of row[0:16] (bit i <=> row[i] >= t / row[i] <= t)
+#ifdef __SSE4_2__
+
+inline uint32_t mask_ge_16(const uint8_t* restrict row, uint8_t t) {
+    __m128i in = _mm_loadu_si128((const __m128i*)row);
+    __m128i ge = _mm_cmpeq_epi8(_mm_max_epu8(in, _mm_set1_epi8(t)), in);
+    return _mm_movemask_epi8(ge);
+}
+
+inline uint32_t mask_le_16(const uint8_t* restrict row, uint8_t t) {
+    __m128i in = _mm_loadu_si128((const __m128i*)row);
+    __m128i le = _mm_cmpeq_epi8(_mm_min_epu8(in, _mm_set1_epi8(t)), in);
+    return _mm_movemask_epi8(le);
+}
+
+inline uint32_t mask_ge_16(const uint16_t* restrict row, uint16_t t) {
+    __m128i vt = _mm_set1_epi16(t);
+    __m128i in0 = _mm_loadu_si128((const __m128i*)row);
+    __m128i in1 = _mm_loadu_si128((const __m128i*)(row + 8));
+    __m128i ge0 = _mm_cmpeq_epi16(_mm_max_epu16(in0, vt), in0);
+    __m128i ge1 = _mm_cmpeq_epi16(_mm_max_epu16(in1, vt), in1);
+    return _mm_movemask_epi8(_mm_packs_epi16(ge0, ge1)); // 0 / -1: no saturation issue
+}
+
+inline uint32_t mask_le_16(const uint16_t* restrict row, uint16_t t) {
+    __m128i vt = _mm_set1_epi16(t);
+    __m128i in0 = _mm_loadu_si128((const __m128i*)row);
+    __m128i in1 = _mm_loadu_si128((const __m128i*)(row + 8));
+    __m128i le0 = _mm_cmpeq_epi16(_mm_min_epu16(in0, vt), in0);
+    __m128i le1 = _mm_cmpeq_epi16(_mm_min_epu16(in1, vt), in1);
+    return _mm_movemask_epi8(_mm_packs_epi16(le0, le1));
+}
+
+inline uint32_t mask_ge_16(const float* restrict row, float t) {
+    __m128 vt = _mm_set1_ps(t);
+    uint32_t mask = 0;
+    for (int k = 0; k < 4; k++) {
+	__m128 in = _mm_loadu_ps(row + 4 * k);
+	mask |= _mm_movemask_ps(_mm_cmpge_ps(in, vt)) << (4 * k);
+    }
+    return mask;
+}
+
+inline uint32_t mask_le_16(const float* restrict row, float t) {
+    __m128 vt = _mm_set1_ps(t);
+    uint32_t mask = 0;
+    for (int k = 0; k < 4; k++) {
+	__m128 in = _mm_loadu_ps(row + 4 * k);
+	mask |= _mm_movemask_ps(_mm_cmple_ps(in, vt)) << (4 * k);
+    }
+    return mask;
+}
+
+#else
+
+template <typename T>
+inline uint32_t mask_ge_16(const T* restrict row, T t) {
+    uint32_t mask = 0;
+    for (int k = 0; k < 16; k++) {
+	mask |= (uint32_t)(row[k] >= t) << k;
+    }
+    return mask;
+}
+
+template <typename T>
+inline uint32_t mask_le_16(const T* restrict row, T t) {
+    uint32_t mask = 0;
+    for (int k = 0; k < 16; k++) {
+	mask |= (uint32_t)(row[k] <= t) << k;
+    }
+    return mask;
+}
+
+#endif // __SSE4_2__
+
+// Last `rem` (< 16) pixels of a row
+template <typename Predicate>
+inline uint32_t mask_tail(const typename Predicate::Pixel_t* restrict row, int rem) {
+    uint32_t mask = 0;
+    for (int k = 0; k < rem; k++) {
+	mask |= (uint32_t)Predicate::Test(row[k]) << k;
+    }
+    return mask;
+}
+
+// Store the column index of every bit set in `edges` (16 bits), `col` being the index of bit 0
+inline int16_t* compress_store_16(uint32_t edges, int16_t col, int16_t* restrict RLCi) {
+#ifdef __SSE4_2__
+    uint32_t m0 = edges & 0xff;
+    uint32_t m1 = edges >> 8;
+    __m128i ids0 = _mm_add_epi16(_mm_set1_epi16(col), _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7));
+    __m128i ids1 = _mm_add_epi16(ids0, _mm_set1_epi16(8));
+    __m128i shuf0 = _mm_load_si128((const __m128i*)(rle::LUT16x8 + 16 * m0));
+    __m128i shuf1 = _mm_load_si128((const __m128i*)(rle::LUT16x8 + 16 * m1));
+    _mm_storeu_si128((__m128i*)RLCi, _mm_shuffle_epi8(ids0, shuf0));
+    RLCi += __builtin_popcount(m0);
+    _mm_storeu_si128((__m128i*)RLCi, _mm_shuffle_epi8(ids1, shuf1));
+    return RLCi + __builtin_popcount(m1);
+#else
+    while (edges != 0) {
+	*RLCi++ = col + __builtin_ctz(edges);
+	edges &= edges - 1;
+    }
+    return RLCi;
+#endif // __SSE4_2__
+}
+
+// ER[0:16] from the edges of 16 pixels. May write up to 15 elements after the end of the row.
+inline int16_t store_er_16(uint32_t edges, int16_t er, int16_t* restrict ERi) {
+    uint64_t ver = (uint64_t)(uint16_t)er * 0x0001000100010001ULL;
+    for (int k = 0; k < 4; k++) {
+	uint64_t v = bit::ER_LUT_4x16[(edges >> (4 * k)) & 0xf] + ver;
+	memcpy(ERi + 4 * k, &v, sizeof(v));
+	ver += (uint64_t)__builtin_popcount((edges >> (4 * k)) & 0xf) * 0x0001000100010001ULL;
+    }
+    return er + __builtin_popcount(edges);
+}
+
+}
+
+
+template <typename T, typename Low>
+uint32_t Threshold<T, Low>::Mask16(const T* restrict row) {
+    return threshold::mask_ge_16(row, (T)Low::value);
+}
+
+template <typename T, typename Low, typename High>
+uint32_t Interval<T, Low, High>::Mask16(const T* restrict row) {
+    return threshold::mask_ge_16(row, (T)Low::value) & threshold::mask_le_16(row, (T)High::value);
+}
+
+
+template <typename Predicate>
+int16_t rle_stdz_pred(const typename Predicate::Pixel_t* restrict image_row,
+		      int16_t* restrict rlc_row,
+		      int16_t width) {
+
+    int16_t* restrict RLCi = rlc_row;
+    uint32_t carry = 0; // Last pixel of the previous block
+
+    for (int i = 0; i < width; i += 16) {
+	int rem = width - i;
+	uint32_t fg = (rem >= 16) ? Predicate::Mask16(image_row + i)
+	                          : threshold::mask_tail<Predicate>(image_row + i, rem);
+	uint32_t edges = (fg ^ ((fg << 1) | carry)) & 0xffff;
+	carry = (fg >> 15) & 1;
+	if (rem < 16) {
+	    edges &= (1U << rem) - 1; // Closing edge is added by rle_stdz_end
+	}
+
+	if (edges != 0) {
+	    RLCi = threshold::compress_store_16(edges, i, RLCi);
+	}
+    }
+
+    return rle_stdz_end(rlc_row, RLCi, width);
+}
+
+template <typename Predicate>
+int16_t rle_stdz_er_pred(const typename Predicate::Pixel_t* restrict image_row,
+			 int16_t* restrict rlc_row,
+			 int16_t* restrict ER,
+			 int16_t width) {
+
+    int16_t* restrict RLCi = rlc_row;
+    uint32_t carry = 0;
+    int16_t er = 0;
+
+    ER[-1] = 0;
+
+    for (int i = 0; i < width; i += 16) {
+	int rem = width - i;
+	uint32_t fg = (rem >= 16) ? Predicate::Mask16(image_row + i)
+	                          : threshold::mask_tail<Predicate>(image_row + i, rem);
+	uint32_t edges = (fg ^ ((fg << 1) | carry)) & 0xffff;
+	carry = (fg >> 15) & 1;
+	if (rem < 16) {
+	    edges &= (1U << rem) - 1;
+	}
+
+	RLCi = threshold::compress_store_16(edges, i, RLCi);
+	er = threshold::store_er_16(edges, er, ER + i);
+    }
+
+    return rle_stdz_end(rlc_row, RLCi, width);
+}
+
+}
+
+#endif // CCL_ALGOS_RLE_THRESHOLD_HPP
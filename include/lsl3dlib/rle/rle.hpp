@@ -3,6 +3,8 @@
 
 #include <cstdint>
 #include <cstddef>
+#include <limits>
+#include <type_traits>
 
 #include <simdhelpers/restrict.hpp>
 
@@ -14,6 +16,8 @@ namespace rle {
 // This is important to take into consideration as some algorithms (ie: the SIMD one)
 // may perform out-of-bounds accesses (for implentation simplicity)
 // As a result, input/output data should have extra allocated space
+// The scalar encoders and the *_Unpadded SIMD ones never read after the end of the image row:
+// they can be used on memory that is not owned (see create_mat_view).
 constexpr int16_t RLE_IMG_MARGIN_BEFORE = 1; // Image rows should have at least 1 element before
 constexpr int16_t RLE_IMG_MARGIN_AFTER = 16; // Image rows should have at least 16 elements after
 constexpr int16_t RLE_IMG_EXTRA_SPACE = RLE_IMG_MARGIN_BEFORE + RLE_IMG_MARGIN_AFTER;
@@ -24,109 +28,159 @@ constexpr int16_t RLE_ER_MARGIN_AFTER = 16; // RLC rows should have 2 elements a
 
 
 
-inline int16_t rle_std_er(const uint8_t* restrict image_row,
-			  int16_t* restrict rlc_row,
-			  int16_t* restrict ER, int16_t width);
-
-inline int16_t rle_rlc_er(const uint8_t* restrict image_row,
-			  int16_t* restrict rlc_row,
-			  int16_t* restrict ER, int16_t width);
-
-inline int16_t rle_std(const uint8_t* restrict image_row,
-		       int16_t* restrict rlc_row,
-		       int16_t width);
-
-inline int16_t rle_stdz_er(const uint8_t* restrict image_row,
-			   int16_t* restrict rlc_row,
-			   int16_t* restrict ER, int16_t width);
-
+// Value of the two border entries written after each RLC row (see rle_stdz).
+// Bigger than any column: keeps the unification loops from reading past the end of a row.
+// Also caps the width of the rows: width < rle_sentinel<Seg_t>().
+template <typename Seg_t>
+constexpr Seg_t rle_sentinel() {
+    return std::numeric_limits<Seg_t>::max() - 1;
+}
 
-inline int16_t rle_stdz(const uint8_t* restrict image_row,
-			int16_t* restrict rlc_row,
-			int16_t width);
+// Element type of the input rows of an encoder: RLE::Conf::Pixel_t when defined (words of the
+// bit-packed encoders, grayscale pixels of the threshold ones), uint8_t otherwise. The drivers
+// read the rows of the image as pixel_t<RLE>.
+template <typename RLE, typename = void>
+struct pixel_of {
+    using type = uint8_t;
+};
 
+template <typename RLE>
+struct pixel_of<RLE, std::void_t<typename RLE::Conf::Pixel_t>> {
+    using type = typename RLE::Conf::Pixel_t;
+};
 
-struct STD {
+template <typename RLE>
+using pixel_t = typename pixel_of<RLE>::type;
+
+// The scalar encoders are generic on Seg_t (int16_t by default, int32_t for rows of 32k pixels
+// and more). ER values have the same type as the segments.
+template <typename Seg_t>
+inline Seg_t rle_std_er(const uint8_t* restrict image_row,
+			Seg_t* restrict rlc_row,
+			Seg_t* restrict ER, int width);
+
+template <typename Seg_t>
+inline Seg_t rle_rlc_er(const uint8_t* restrict image_row,
+			Seg_t* restrict rlc_row,
+			Seg_t* restrict ER, int width);
+
+template <typename Seg_t>
+inline Seg_t rle_std(const uint8_t* restrict image_row,
+		     Seg_t* restrict rlc_row,
+		     int width);
+
+template <typename Seg_t>
+inline Seg_t rle_stdz_er(const uint8_t* restrict image_row,
+			 Seg_t* restrict rlc_row,
+			 Seg_t* restrict ER, int width);
+
+
+template <typename Seg_t>
+inline Seg_t rle_stdz(const uint8_t* restrict image_row,
+		      Seg_t* restrict rlc_row,
+		      int width);
+
+// End of a STDZ row written edge by edge (SIMD and bit-packed encoders), RLCi being past the
+// last edge: `width` is always written as a closing edge and dropped when the number of edges
+// was even (last segment already closed). Adds the border entries, returns the length.
+// Always inlined, and only uses constant expressions: it is called by the dispatch kernels
+// (src/rle/rle-dispatch-*.cpp), no copy of it compiled with their ISA flags must be emitted.
+template <typename Seg_t>
+__attribute__((always_inline))
+inline Seg_t rle_stdz_end(Seg_t* rlc_row, Seg_t* RLCi, int width);
+
+
+template <typename Seg_T>
+struct STD_Generic {
 public:
-    
+
     struct Conf {
 	static constexpr bool IsBitonal = false;
-	using Seg_t = int16_t;
+	using Seg_t = Seg_T;
 	static constexpr bool ER = false;
 	static constexpr size_t SIMD_WORDS = 1; // Number of 64-bits words per SIMD vector
     };
 
     template <uint8_t FG = 1>
-    static inline int16_t Line(const uint8_t* restrict input, Conf::Seg_t* restrict RLCi,
-			       int16_t* restrict ERi, int16_t width) {
+    static inline Seg_T Line(const uint8_t* restrict input, Seg_T* restrict RLCi,
+			     Seg_T* restrict ERi, int width) {
 	return rle_std(input, RLCi, width);
     }
 };
 
-struct STD_ER {
+template <typename Seg_T>
+struct STD_ER_Generic {
 public:
 
     struct Conf {
 	static constexpr bool IsBitonal = false;
-	using Seg_t = int16_t;
+	using Seg_t = Seg_T;
 	static constexpr bool ER = true;
 	static constexpr size_t SIMD_WORDS = 1; // Number of 64-bits words per SIMD vector
     };
-	
+
     template <uint8_t FG = 1>
-    static inline int16_t Line(const uint8_t* restrict input, Conf::Seg_t* restrict RLCi,
-			       int16_t* restrict ERi, uint16_t width) {
+    static inline Seg_T Line(const uint8_t* restrict input, Seg_T* restrict RLCi,
+			     Seg_T* restrict ERi, int width) {
 	return rle_std_er(input, RLCi, ERi, width);
     }
 };
 
-struct STDZ {
+template <typename Seg_T>
+struct STDZ_Generic {
 public:
 
     struct Conf {
 	static constexpr bool IsBitonal = false;
-	using Seg_t = int16_t;
+	using Seg_t = Seg_T;
 	static constexpr bool ER = false;
 	static constexpr size_t SIMD_WORDS = 1; // Number of 64-bits words per SIMD vector
     };
-    
+
     template <uint8_t FG = 1>
-    static inline int16_t Line(const uint8_t* restrict input, Conf::Seg_t* restrict RLCi,
-			       int16_t* restrict ERi, int16_t width) {
+    static inline Seg_T Line(const uint8_t* restrict input, Seg_T* restrict RLCi,
+			     Seg_T* restrict ERi, int width) {
 	return rle_stdz(input, RLCi, width);
     }
 };
 
-struct STDZ_ER {
+template <typename Seg_T>
+struct STDZ_ER_Generic {
 public:
 
     struct Conf {
 	static constexpr bool IsBitonal = false;
-	using Seg_t = int16_t;
+	using Seg_t = Seg_T;
 	static constexpr bool ER = true;
 	static constexpr size_t SIMD_WORDS = 1; // Number of 64-bits words per SIMD vector
     };
-    
+
     template <uint8_t FG = 1>
-    static inline int16_t Line(const uint8_t* restrict input, Conf::Seg_t* restrict RLCi,
-			       int16_t* restrict ERi, int16_t width) {
+    static inline Seg_T Line(const uint8_t* restrict input, Seg_T* restrict RLCi,
+			     Seg_T* restrict ERi, int width) {
 	return rle_stdz_er(input, RLCi, ERi, width);
     }
 };
 
+using STD = STD_Generic<int16_t>;
+using STD_ER = STD_ER_Generic<int16_t>;
+using STDZ = STDZ_Generic<int16_t>;
+using STDZ_ER = STDZ_ER_Generic<int16_t>;
+
 
 
 // Implementations
-int16_t rle_std_er(const uint8_t* restrict image_row,
-		   int16_t* restrict rlc_row,
-		   int16_t* restrict ER, int16_t width) {
+template <typename Seg_t>
+Seg_t rle_std_er(const uint8_t* restrict image_row,
+		 Seg_t* restrict rlc_row,
+		 Seg_t* restrict ER, int width) {
     int8_t prev = 0;
     int8_t front = 0;
     int8_t b = 0;
-    int16_t er = 0;
+    Seg_t er = 0;
     int8_t val;
 
-    for (int16_t col = 0; col < width; col++) {
+    for (int col = 0; col < width; col++) {
         val = image_row[col] & 1; // > 0 is only needed when processing image in YACCLAB
 	front = val ^ prev;
 	rlc_row[er] = col - b;
@@ -143,17 +197,18 @@ int16_t rle_std_er(const uint8_t* restrict image_row,
 }
 
 
-int16_t rle_std(const uint8_t* restrict image_row,
-		int16_t* restrict rlc_row,
-		int16_t width) {
+template <typename Seg_t>
+Seg_t rle_std(const uint8_t* restrict image_row,
+	      Seg_t* restrict rlc_row,
+	      int width) {
     
     uint8_t prev = 0;
     uint8_t front = 0;
     uint8_t b = 0;
-    int16_t er = 0;
+    Seg_t er = 0;
     uint8_t val;
 
-    for (int16_t col = 0; col < width; col++) {
+    for (int col = 0; col < width; col++) {
 	 // & 1 is only needed when processing image in YACCLAB as the input images are {0; 255}
 	// rather than {0; 1}
         val = image_row[col] & 1;
@@ -169,21 +224,22 @@ int16_t rle_std(const uint8_t* restrict image_row,
     er += front;
 
     // Border management: used to simplify  unfication step
-    rlc_row[er] = INT16_MAX - 1;
-    rlc_row[er + 1] = INT16_MAX - 1;
+    rlc_row[er] = rle_sentinel<Seg_t>();
+    rlc_row[er + 1] = rle_sentinel<Seg_t>();
 
     return er;
 }
 
-int16_t rle_stdz_er(const uint8_t* restrict image_row,
-		    int16_t* restrict rlc_row,
-		    int16_t* restrict ER, int16_t width) {
+template <typename Seg_t>
+Seg_t rle_stdz_er(const uint8_t* restrict image_row,
+		  Seg_t* restrict rlc_row,
+		  Seg_t* restrict ER, int width) {
     uint8_t prev = 0;
     uint8_t front = 0;
-    int16_t er = 0;
+    Seg_t er = 0;
     uint8_t val;
     
-    for (uint16_t col = 0; col < width; col++) {
+    for (int col = 0; col < width; col++) {
 	// & 1 is only needed when processing image in YACCLAB as the input images are {0; 255}
 	// rather than {0; 1}
         val = image_row[col] & 1; 
@@ -199,22 +255,23 @@ int16_t rle_stdz_er(const uint8_t* restrict image_row,
     er += prev;
 
     // Border management: used to simplify  unfication step
-    rlc_row[er] = INT16_MAX - 1;
-    rlc_row[er + 1] = INT16_MAX - 1;
+    rlc_row[er] = rle_sentinel<Seg_t>();
+    rlc_row[er + 1] = rle_sentinel<Seg_t>();
     
     return er;
 }
 
-int16_t rle_stdz(const uint8_t* restrict image_row,
-		 int16_t* restrict rlc_row,
-		 int16_t width) {
+template <typename Seg_t>
+Seg_t rle_stdz(const uint8_t* restrict image_row,
+	       Seg_t* restrict rlc_row,
+	       int width) {
     
     uint8_t prev = 0;
     uint8_t front = 0;
-    int16_t er = 0;
+    Seg_t er = 0;
     uint8_t val;
     
-    for (int16_t col = 0; col < width; col++) {
+    for (int col = 0; col < width; col++) {
 	// & 1 is only needed when processing image in YACCLAB as the input images are {0; 255}
 	// rather than {0; 1}
         val = image_row[col] & 1; 
@@ -229,23 +286,37 @@ int16_t rle_stdz(const uint8_t* restrict image_row,
     er += prev;
 
     // Border management: used to simplify  unfication step
-    rlc_row[er] = INT16_MAX - 1;
-    rlc_row[er + 1] = INT16_MAX - 1;
+    rlc_row[er] = rle_sentinel<Seg_t>();
+    rlc_row[er + 1] = rle_sentinel<Seg_t>();
 
     return er;
 }
 
+template <typename Seg_t>
+Seg_t rle_stdz_end(Seg_t* rlc_row, Seg_t* RLCi, int width) {
+    *RLCi++ = width;
+    Seg_t n = RLCi - rlc_row;
+    n -= n % 2;
+
+    // Border management: used to simplify the unification step
+    constexpr Seg_t sentinel = rle_sentinel<Seg_t>();
+    rlc_row[n] = sentinel;
+    rlc_row[n + 1] = sentinel;
+    return n;
+}
+
 
-int16_t rle_rlc_er(const uint8_t* restrict image_row,
-		   int16_t* restrict rlc_row,
-		   int16_t* restrict ER, int16_t width) {
+template <typename Seg_t>
+Seg_t rle_rlc_er(const uint8_t* restrict image_row,
+		 Seg_t* restrict rlc_row,
+		 Seg_t* restrict ER, int width) {
     int8_t prev = 0;
     int8_t front = 0;
     int8_t b = 0;
-    int16_t er = 0;
+    Seg_t er = 0;
     int8_t val;
 
-    for (int16_t col = 0; col < width; col++) {
+    for (int col = 0; col < width; col++) {
         val = image_row[col];
 	front = val ^ prev;
 	if (front != 0){
@@ -262,8 +333,8 @@ int16_t rle_rlc_er(const uint8_t* restrict image_row,
     er += front;
     
     // Border management: used to simplify  unfication step
-    rlc_row[er] = INT16_MAX - 1;
-    rlc_row[er + 1] = INT16_MAX - 1;
+    rlc_row[er] = rle_sentinel<Seg_t>();
+    rlc_row[er + 1] = rle_sentinel<Seg_t>();
     
     return er;
 }
@@ -0,0 +1,184 @@
+#ifndef CCL_ALGOS_SOLVERS_CONCURRENT_HPP
+#define CCL_ALGOS_SOLVERS_CONCURRENT_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <atomic>
+#include <algorithm>
+#include <utility>
+
+// Lock-free equivalence table shared by several threads.
+//
+// Same interface as the sequential LabelsSolvers (Alloc, Setup, Dealloc, NewLabel, FindRoot,
+// UpdateTable, GetLabel, Flatten) with these differences:
+// - FindRoot() and UpdateTable() can be called concurrently. A parent is always smaller than its
+//   child: unions link the bigger root to the smaller one with a CAS (lowest root wins) and are
+//   retried when the root changed in between. UpdateTable() accepts any two labels, roots or not.
+//   FindRoot() halves the paths with a CAS as well.
+// - Threads create labels through a Handle: labels are reserved by blocks of BLOCK with a single
+//   atomic add, NewLabel() is then thread local. Labels left in a block are marked as unused when
+//   the Handle is released. The table needs BLOCK extra entries per Handle.
+// - Flatten() and GetLabel() are sequential: they are called once every Handle has been released.
+//
+// Labels are not consecutive before Flatten() (blocks are interleaved between threads).
+struct ConcurrentLabelsSolver {
+
+    static constexpr int32_t UNUSED = -1;
+    static constexpr int32_t BLOCK = 256;
+
+    struct Handle;
+
+    std::atomic<int32_t>* T = nullptr;
+    int32_t size = 0;
+    std::atomic<int32_t> next{1}; // First label of the next block
+
+    ConcurrentLabelsSolver() = default;
+    ConcurrentLabelsSolver(const ConcurrentLabelsSolver&) = delete;
+    ConcurrentLabelsSolver& operator=(const ConcurrentLabelsSolver&) = delete;
+
+    void Alloc(size_t size);
+    void Dealloc();
+    inline void Setup();
+
+    // Single label, without Handle (one atomic add per label)
+    inline int32_t NewLabel();
+    inline int32_t NewComponent() { return NewLabel(); }
+
+    inline int32_t FindRoot(int32_t e) const;
+    // Union of the sets of e0 and e1, returns the root of the union
+    inline int32_t UpdateTable(int32_t e0, int32_t e1) const;
+
+    // Consecutive final labels, returns the number of labels (background included)
+    inline int32_t Flatten();
+    inline int32_t GetLabel(int32_t e) const { return T[e].load(std::memory_order_relaxed); }
+
+    // [first, last) labels for a Handle
+    inline void Reserve(int32_t& first, int32_t& last);
+};
+
+// Per thread view of a ConcurrentLabelsSolver, with the LabelsSolver interface expected by the
+// unification kernels
+struct ConcurrentLabelsSolver::Handle {
+
+    ConcurrentLabelsSolver& ET;
+    int32_t current = 0;
+    int32_t last = 0;
+
+    explicit Handle(ConcurrentLabelsSolver& ET) : ET(ET) {}
+    Handle(const Handle&) = delete;
+    Handle& operator=(const Handle&) = delete;
+    ~Handle() { Release(); }
+
+    inline int32_t NewLabel();
+    inline int32_t NewComponent() { return NewLabel(); }
+
+    inline int32_t FindRoot(int32_t e) const { return ET.FindRoot(e); }
+    inline int32_t UpdateTable(int32_t e0, int32_t e1) const { return ET.UpdateTable(e0, e1); }
+    inline int32_t GetLabel(int32_t e) const { return ET.GetLabel(e); }
+
+    // Mark the rest of the block as unused
+    inline void Release();
+};
+
+
+inline void ConcurrentLabelsSolver::Alloc(size_t size) {
+    assert(size <= (size_t)INT32_MAX && "Too many labels for int32_t");
+    Dealloc();
+    T = new std::atomic<int32_t>[size];
+    this->size = (int32_t)size;
+}
+
+inline void ConcurrentLabelsSolver::Dealloc() {
+    delete[] T;
+    T = nullptr;
+    size = 0;
+}
+
+void ConcurrentLabelsSolver::Setup() {
+    T[0].store(0, std::memory_order_relaxed);
+    next.store(1, std::memory_order_relaxed);
+}
+
+int32_t ConcurrentLabelsSolver::NewLabel() {
+    const int32_t label = next.fetch_add(1, std::memory_order_relaxed);
+    assert(label < size && "Equivalence table too small");
+    T[label].store(label, std::memory_order_release);
+    return label;
+}
+
+void ConcurrentLabelsSolver::Reserve(int32_t& first, int32_t& last) {
+    first = next.fetch_add(BLOCK, std::memory_order_relaxed);
+    assert(first < size && "Equivalence table too small");
+    last = std::min(first + BLOCK, size);
+}
+
+int32_t ConcurrentLabelsSolver::FindRoot(int32_t e) const {
+    while (true) {
+	int32_t parent = T[e].load(std::memory_order_acquire);
+	if (parent == e) {
+	    return e;
+	}
+	const int32_t grandparent = T[parent].load(std::memory_order_acquire);
+	if (grandparent == parent) {
+	    return parent;
+	}
+	// Path halving. When T[e] changed in between, it was set to an ancestor of e by another
+	// thread: the CAS fails and the walk goes on from grandparent, which is an ancestor too.
+	T[e].compare_exchange_weak(parent, grandparent, std::memory_order_acq_rel,
+				   std::memory_order_relaxed);
+	e = grandparent;
+    }
+}
+
+int32_t ConcurrentLabelsSolver::UpdateTable(int32_t e0, int32_t e1) const {
+    while (true) {
+	e0 = FindRoot(e0);
+	e1 = FindRoot(e1);
+	if (e0 == e1) {
+	    return e0;
+	}
+	if (e0 < e1) {
+	    std::swap(e0, e1);
+	}
+	// e0 is only linked if it is still a root
+	int32_t expected = e0;
+	if (T[e0].compare_exchange_strong(expected, e1, std::memory_order_acq_rel,
+					  std::memory_order_acquire)) {
+	    return e1;
+	}
+    }
+}
+
+int32_t ConcurrentLabelsSolver::Flatten() {
+    const int32_t end = std::min(next.load(std::memory_order_acquire), size);
+
+    int32_t k = 1;
+    for (int32_t i = 1; i < end; i++) {
+	const int32_t parent = T[i].load(std::memory_order_relaxed);
+	if (parent == UNUSED) {
+	    continue;
+	}
+	// parent < i has already been given its final label
+	const int32_t label = parent == i ? k++ : T[parent].load(std::memory_order_relaxed);
+	T[i].store(label, std::memory_order_relaxed);
+    }
+    return k;
+}
+
+int32_t ConcurrentLabelsSolver::Handle::NewLabel() {
+    if (current == last) {
+	ET.Reserve(current, last);
+    }
+    ET.T[current].store(current, std::memory_order_release);
+    return current++;
+}
+
+void ConcurrentLabelsSolver::Handle::Release() {
+    for (int32_t i = current; i < last; i++) {
+	ET.T[i].store(UNUSED, std::memory_order_relaxed);
+    }
+    current = last = 0;
+}
+
+#endif // CCL_ALGOS_SOLVERS_CONCURRENT_HPP
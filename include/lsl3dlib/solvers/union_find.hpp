@@ -0,0 +1,370 @@
+#ifndef CCL_ALGOS_SOLVERS_UNION_FIND_HPP
+#define CCL_ALGOS_SOLVERS_UNION_FIND_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+#include <utility>
+#include <algorithm>
+
+#include <simdhelpers/restrict.hpp>
+#include <simdhelpers/aligned_alloc.hpp>
+
+// Sequential LabelsSolvers (see LSL3D for the contract):
+// - UF: no compression, reference
+// - UFPC: path compression
+// - UFPH: path halving
+// - RemSP: Rem's algorithm with splicing
+// - UFSize: union by size + path compression on a separate forest
+// - UFSliceFlatten: no compression in FindRoot, the labels created by a slice are flattened when
+//   the slice is complete (EndSlice(), called by LSL3D::LabelSlices)
+//
+// The kernels expect the root of a set to be its smallest label (lowest root wins): they call
+// UpdateTable(e0, e1) with two roots e0 >= e1 and keep using e1 as the root of the union. Except
+// for RemSP, UpdateTable() only sets T[e0] = e1, and Flatten() is a single ascending pass.
+// UFSize balances its trees by size in a separate forest and reports the smallest label of the
+// tree as the root.
+//
+// Flatten() gives consecutive labels in the order of the smallest label of each component.
+// SetLabel(e, label) sets the final label of e (GetLabel), for the drivers that flatten the table
+// themselves (LSL3D_Parallel).
+// NewLabels(first, last) creates the labels [first, last) without changing n, for the drivers
+// that create disjoint ranges of labels from several threads (LSL3D_Parallel): the caller sets n.
+//
+// Prefetch(e) is optional (solver::prefetch): it brings the entry of e in the cache before a
+// FindRoot(e), for the unifications resolving their equivalences in batches.
+
+namespace solver {
+
+// Table and label allocation shared by the solvers with smallest label roots
+struct UFTable {
+
+    static constexpr size_t ALIGNMENT = 64;
+
+    int32_t* T = nullptr;
+    int32_t n = 1; // Next label
+
+    void Alloc(size_t size);
+    void Dealloc();
+
+    inline void Setup();
+    inline int32_t NewLabel();
+    inline void NewLabels(int32_t first, int32_t last);
+    inline int32_t NewComponent() { return NewLabel(); }
+    inline int32_t GetLabel(int32_t e) const { return T[e]; }
+    inline void SetLabel(int32_t e, int32_t label) { T[e] = label; }
+    inline void Prefetch(int32_t e) const { __builtin_prefetch(T + e); }
+
+    inline int32_t Flatten();
+};
+
+struct UF : UFTable {
+    inline int32_t FindRoot(int32_t e) const;
+    inline int32_t UpdateTable(int32_t e0, int32_t e1);
+};
+
+struct UFPC : UFTable {
+    inline int32_t FindRoot(int32_t e);
+    inline int32_t UpdateTable(int32_t e0, int32_t e1);
+};
+
+struct UFPH : UFTable {
+    inline int32_t FindRoot(int32_t e);
+    inline int32_t UpdateTable(int32_t e0, int32_t e1);
+};
+
+// Union of any two labels, walking both paths at once and splicing them on the way
+struct RemSP : UFTable {
+    inline int32_t FindRoot(int32_t e) const;
+    inline int32_t UpdateTable(int32_t e0, int32_t e1);
+};
+
+// T is only used for the final labels (GetLabel). P is the forest, S the size of the trees and M
+// their smallest label.
+struct UFSize : UFTable {
+
+    int32_t* P = nullptr;
+    int32_t* S = nullptr;
+    int32_t* M = nullptr;
+
+    void Alloc(size_t size);
+    void Dealloc();
+
+    inline int32_t NewLabel();
+    inline void NewLabels(int32_t first, int32_t last);
+    inline int32_t NewComponent() { return NewLabel(); }
+
+    inline void Prefetch(int32_t e) const { __builtin_prefetch(P + e); }
+
+    // Smallest label of the set of e
+    inline int32_t FindRoot(int32_t e);
+    inline int32_t UpdateTable(int32_t e0, int32_t e1);
+
+    inline int32_t Flatten();
+
+    // Root of e in P
+    inline int32_t FindTree(int32_t e);
+};
+
+// EndSlice() only flattens the labels created since the previous call. The labels of earlier
+// slices are never flattened again: each later merge of their root adds a step to their path,
+// which FindRoot does not compress. The per slice flatten only bounds the paths of the new
+// labels; lsl3d-bench-uf measures this, not a flatten of the whole table after each slice.
+struct UFSliceFlatten : UFTable {
+
+    int32_t flattened = 1; // Labels before are flattened
+
+    inline void Setup();
+
+    inline int32_t FindRoot(int32_t e) const;
+    inline int32_t UpdateTable(int32_t e0, int32_t e1);
+
+    // Every label created since the previous call points to its root
+    inline void EndSlice();
+};
+
+// ET.EndSlice() for the solvers that have it
+template <typename LabelsSolver>
+inline auto end_slice(LabelsSolver& ET, int) -> decltype(ET.EndSlice(), void()) {
+    ET.EndSlice();
+}
+
+template <typename LabelsSolver>
+inline void end_slice(LabelsSolver& ET, long) {}
+
+template <typename LabelsSolver>
+inline void end_slice(LabelsSolver& ET) {
+    end_slice(ET, 0);
+}
+
+// ET.Prefetch(e) for the solvers that have it
+template <typename LabelsSolver>
+inline auto prefetch(const LabelsSolver& ET, int32_t e, int) -> decltype(ET.Prefetch(e), void()) {
+    ET.Prefetch(e);
+}
+
+template <typename LabelsSolver>
+inline void prefetch(const LabelsSolver& ET, int32_t e, long) {}
+
+template <typename LabelsSolver>
+inline void prefetch(const LabelsSolver& ET, int32_t e) {
+    prefetch(ET, e, 0);
+}
+
+
+inline void UFTable::Alloc(size_t size) {
+    assert(size <= (size_t)INT32_MAX && "Too many labels for int32_t");
+    Dealloc();
+    T = aligned_new<int32_t>(size, ALIGNMENT);
+}
+
+inline void UFTable::Dealloc() {
+    if (T != nullptr) {
+	aligned_delete(T, ALIGNMENT);
+    }
+    T = nullptr;
+}
+
+void UFTable::Setup() {
+    T[0] = 0;
+    n = 1;
+}
+
+int32_t UFTable::NewLabel() {
+    T[n] = n;
+    return n++;
+}
+
+void UFTable::NewLabels(int32_t first, int32_t last) {
+    for (int32_t e = first; e < last; e++) {
+	T[e] = e;
+    }
+}
+
+int32_t UFTable::Flatten() {
+    int32_t* restrict t = T;
+    int32_t k = 1;
+    for (int32_t i = 1; i < n; i++) {
+	// t[i] < i has already been given its final label
+	t[i] = t[i] < i ? t[t[i]] : k++;
+    }
+    return k;
+}
+
+// UF
+int32_t UF::FindRoot(int32_t e) const {
+    while (T[e] < e) {
+	e = T[e];
+    }
+    return e;
+}
+
+int32_t UF::UpdateTable(int32_t e0, int32_t e1) {
+    T[e0] = e1;
+    return e1;
+}
+
+// UFPC
+int32_t UFPC::FindRoot(int32_t e) {
+    int32_t root = e;
+    while (T[root] < root) {
+	root = T[root];
+    }
+    while (T[e] < e) {
+	const int32_t parent = T[e];
+	T[e] = root;
+	e = parent;
+    }
+    return root;
+}
+
+int32_t UFPC::UpdateTable(int32_t e0, int32_t e1) {
+    T[e0] = e1;
+    return e1;
+}
+
+// UFPH
+int32_t UFPH::FindRoot(int32_t e) {
+    while (T[e] < e) {
+	T[e] = T[T[e]];
+	e = T[e];
+    }
+    return e;
+}
+
+int32_t UFPH::UpdateTable(int32_t e0, int32_t e1) {
+    T[e0] = e1;
+    return e1;
+}
+
+// RemSP
+int32_t RemSP::FindRoot(int32_t e) const {
+    while (T[e] < e) {
+	e = T[e];
+    }
+    return e;
+}
+
+int32_t RemSP::UpdateTable(int32_t e0, int32_t e1) {
+    while (T[e0] != T[e1]) {
+	if (T[e0] < T[e1]) {
+	    std::swap(e0, e1);
+	}
+	// T[e0] > T[e1]: e0 is spliced under the parent of e1
+	const int32_t parent = T[e0];
+	T[e0] = T[e1];
+	if (parent == e0) {
+	    break;
+	}
+	e0 = parent;
+    }
+    return FindRoot(e1);
+}
+
+// UFSize
+inline void UFSize::Alloc(size_t size) {
+    Dealloc();
+    UFTable::Alloc(size);
+    P = aligned_new<int32_t>(size, ALIGNMENT);
+    S = aligned_new<int32_t>(size, ALIGNMENT);
+    M = aligned_new<int32_t>(size, ALIGNMENT);
+}
+
+inline void UFSize::Dealloc() {
+    UFTable::Dealloc();
+    for (int32_t** table : {&P, &S, &M}) {
+	if (*table != nullptr) {
+	    aligned_delete(*table, ALIGNMENT);
+	}
+	*table = nullptr;
+    }
+}
+
+int32_t UFSize::NewLabel() {
+    P[n] = n;
+    S[n] = 1;
+    M[n] = n;
+    return UFTable::NewLabel();
+}
+
+void UFSize::NewLabels(int32_t first, int32_t last) {
+    for (int32_t e = first; e < last; e++) {
+	P[e] = e;
+	S[e] = 1;
+	M[e] = e;
+    }
+    UFTable::NewLabels(first, last);
+}
+
+int32_t UFSize::FindTree(int32_t e) {
+    int32_t root = e;
+    while (P[root] != root) {
+	root = P[root];
+    }
+    while (P[e] != root) {
+	const int32_t parent = P[e];
+	P[e] = root;
+	e = parent;
+    }
+    return root;
+}
+
+int32_t UFSize::FindRoot(int32_t e) {
+    return M[FindTree(e)];
+}
+
+int32_t UFSize::UpdateTable(int32_t e0, int32_t e1) {
+    int32_t tree0 = FindTree(e0);
+    int32_t tree1 = FindTree(e1);
+    if (tree0 == tree1) {
+	return M[tree0];
+    }
+    if (S[tree0] < S[tree1]) {
+	std::swap(tree0, tree1);
+    }
+    P[tree1] = tree0;
+    S[tree0] += S[tree1];
+    M[tree0] = std::min(M[tree0], M[tree1]);
+    return M[tree0];
+}
+
+int32_t UFSize::Flatten() {
+    int32_t k = 1;
+    for (int32_t i = 1; i < n; i++) {
+	// The smallest label of the set is either i or has already been given its final label
+	const int32_t root = FindRoot(i);
+	T[i] = root == i ? k++ : T[root];
+    }
+    return k;
+}
+
+// UFSliceFlatten
+void UFSliceFlatten::Setup() {
+    UFTable::Setup();
+    flattened = 1;
+}
+
+int32_t UFSliceFlatten::FindRoot(int32_t e) const {
+    while (T[e] < e) {
+	e = T[e];
+    }
+    return e;
+}
+
+int32_t UFSliceFlatten::UpdateTable(int32_t e0, int32_t e1) {
+    T[e0] = e1;
+    return e1;
+}
+
+void UFSliceFlatten::EndSlice() {
+    for (int32_t i = flattened; i < n; i++) {
+	// A parent >= flattened has just been flattened, older labels may have been merged since
+	const int32_t parent = T[i];
+	T[i] = parent >= flattened ? T[parent] : FindRoot(parent);
+    }
+    flattened = n;
+}
+
+}
+
+#endif // CCL_ALGOS_SOLVERS_UNION_FIND_HPP
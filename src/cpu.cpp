@@ -0,0 +1,65 @@
+#include <lsl3dlib/cpu.hpp>
+
+#include <cstdlib>
+#include <cstring>
+
+namespace cpu {
+
+SIMDLevel detect() {
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init();
+
+    // __builtin_cpu_supports also checks that the OS saves the AVX/AVX512 registers (XCR0)
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+	__builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512vbmi2") &&
+	__builtin_cpu_supports("bmi2")) {
+	return SIMDLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2")) {
+	return SIMDLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+	return SIMDLevel::SSE4_2;
+    }
+#endif // __x86_64__
+    return SIMDLevel::Scalar;
+}
+
+static SIMDLevel parse_level(const char* str, SIMDLevel fallback) {
+    for (int i = (int)SIMDLevel::Scalar; i <= (int)SIMDLevel::AVX512; i++) {
+	if (strcmp(str, name((SIMDLevel)i)) == 0) {
+	    return (SIMDLevel)i;
+	}
+    }
+    return fallback;
+}
+
+SIMDLevel level() {
+    static const SIMDLevel simd_level = [] {
+	SIMDLevel l = detect();
+	const char* env = getenv("LSL3D_SIMD");
+	if (env != nullptr) {
+	    SIMDLevel requested = parse_level(env, l);
+	    // Never go above what the CPU supports
+	    l = (requested < l) ? requested : l;
+	}
+	return l;
+    }();
+    return simd_level;
+}
+
+const char* name(SIMDLevel level) {
+    switch (level) {
+    case SIMDLevel::Scalar:
+	return "scalar";
+    case SIMDLevel::SSE4_2:
+	return "sse4.2";
+    case SIMDLevel::AVX2:
+	return "avx2";
+    case SIMDLevel::AVX512:
+	return "avx512";
+    }
+    return "unknown";
+}
+
+}
@@ -2,7 +2,7 @@
 
 namespace algo {
 
-void relabel_nothing(cv::Mat1i& labels, int32_t*** ERA, int16_t*** RLC) {
+void relabel_nothing(cv::Mat1i& labels, const void* state) {
     // Do nothing
 }
 
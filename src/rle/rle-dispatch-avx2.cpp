@@ -0,0 +1,73 @@
+// AVX2 kernels. Compiled with -mavx2 -mbmi2 (see LSL_SIMD_DISPATCH in CMakeLists.txt): must only
+// be called after checking cpu::level(). Linkage: see rle-dispatch-sse.cpp.
+#include <cstdint>
+#include <immintrin.h>
+
+#include <lsl3dlib/dispatch.hpp>
+#include <lsl3dlib/rle/rle-avx2.hpp>
+
+namespace dispatch {
+
+namespace {
+
+namespace isa = rle::avx2;
+
+template <typename RLE, uint8_t FG>
+int16_t rle_line(const uint8_t* restrict image_row, int16_t* restrict RLCi,
+		 int16_t* restrict ERi, int16_t width) {
+    return RLE::template Line<FG>(image_row, RLCi, ERi, width);
+}
+
+// Same as fill_4x32 (rle-dispatch-sse.cpp) with 8 labels per store
+inline void fill_8x32(int32_t* restrict line, int32_t label,
+		      int segment_start, int segment_end) {
+    int n = segment_end - segment_start;
+    if (n < 8) {
+	if (n >= 4) {
+	    __m128i val = _mm_set1_epi32(label);
+	    _mm_storeu_si128((__m128i*)(line + segment_start), val);
+	    _mm_storeu_si128((__m128i*)(line + segment_end - 4), val);
+	    return;
+	}
+	for (int i = segment_start; i < segment_end; i++) {
+	    line[i] = label;
+	}
+	return;
+    }
+    __m256i val = _mm256_set1_epi32(label);
+    for (int i = segment_start; i + 8 <= segment_end; i += 8) {
+	_mm256_storeu_si256((__m256i*)(line + i), val);
+    }
+    _mm256_storeu_si256((__m256i*)(line + segment_end - 8), val);
+}
+
+void write_segment_avx2(int32_t* restrict line, int32_t label,
+			int segment_start, int segment_end) {
+    fill_8x32(line, label, segment_start, segment_end);
+}
+
+void write_row_avx2(int32_t* restrict line, const int16_t* restrict RLCi,
+		    const int32_t* restrict labels, int16_t len, int16_t width) {
+    int16_t segment_end = 0;
+    for (int er = 1; er < len; er += 2) {
+	int16_t segment_start = RLCi[er - 1];
+	fill_8x32(line, 0, segment_end, segment_start);
+	segment_end = RLCi[er];
+	fill_8x32(line, labels[er / 2], segment_start, segment_end);
+    }
+    fill_8x32(line, 0, segment_end, width);
+}
+
+}
+
+void fill_kernels_avx2(Kernels& k) {
+    k.level = cpu::SIMDLevel::AVX2;
+    k.stdz[0] = &rle_line<isa::STDZ_Unpadded, 1>;
+    k.stdz[1] = &rle_line<isa::STDZ_Unpadded, 0xff>;
+    k.stdz_er[0] = &rle_line<isa::STDZ_ER_Unpadded, 1>;
+    k.stdz_er[1] = &rle_line<isa::STDZ_ER_Unpadded, 0xff>;
+    k.write_segment = &write_segment_avx2;
+    k.write_row = &write_row_avx2;
+}
+
+}
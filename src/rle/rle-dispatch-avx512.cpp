@@ -0,0 +1,64 @@
+// AVX512 kernels. Compiled with -mavx512f -mavx512bw -mavx512vl -mavx512vbmi2 -mbmi2 (see
+// LSL_SIMD_DISPATCH in CMakeLists.txt): must only be called after checking cpu::level().
+// Linkage: see rle-dispatch-sse.cpp.
+#include <cstdint>
+#include <immintrin.h>
+
+#include <lsl3dlib/dispatch.hpp>
+#include <lsl3dlib/rle/rle-avx512.hpp>
+
+namespace dispatch {
+
+namespace {
+
+namespace isa = rle::avx512;
+
+template <typename RLE, uint8_t FG>
+int16_t rle_line(const uint8_t* restrict image_row, int16_t* restrict RLCi,
+		 int16_t* restrict ERi, int16_t width) {
+    return RLE::template Line<FG>(image_row, RLCi, ERi, width);
+}
+
+// 16 labels per store, the end of the segment is written with a masked store
+inline void fill_16x32(int32_t* restrict line, int32_t label,
+		       int segment_start, int segment_end) {
+    __m512i val = _mm512_set1_epi32(label);
+    int i = segment_start;
+    for (; i + 16 <= segment_end; i += 16) {
+	_mm512_storeu_si512((void*)(line + i), val);
+    }
+    if (i < segment_end) {
+	_mm512_mask_storeu_epi32(line + i, (__mmask16)((1U << (segment_end - i)) - 1), val);
+    }
+}
+
+void write_segment_avx512(int32_t* restrict line, int32_t label,
+			  int segment_start, int segment_end) {
+    fill_16x32(line, label, segment_start, segment_end);
+}
+
+void write_row_avx512(int32_t* restrict line, const int16_t* restrict RLCi,
+		      const int32_t* restrict labels, int16_t len, int16_t width) {
+    int16_t segment_end = 0;
+    for (int er = 1; er < len; er += 2) {
+	int16_t segment_start = RLCi[er - 1];
+	fill_16x32(line, 0, segment_end, segment_start);
+	segment_end = RLCi[er];
+	fill_16x32(line, labels[er / 2], segment_start, segment_end);
+    }
+    fill_16x32(line, 0, segment_end, width);
+}
+
+}
+
+void fill_kernels_avx512(Kernels& k) {
+    k.level = cpu::SIMDLevel::AVX512;
+    k.stdz[0] = &rle_line<isa::STDZ, 1>;
+    k.stdz[1] = &rle_line<isa::STDZ, 0xff>;
+    k.stdz_er[0] = &rle_line<isa::STDZ_ER, 1>;
+    k.stdz_er[1] = &rle_line<isa::STDZ_ER, 0xff>;
+    k.write_segment = &write_segment_avx512;
+    k.write_row = &write_row_avx512;
+}
+
+}
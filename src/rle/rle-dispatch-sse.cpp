@@ -0,0 +1,75 @@
+// SSE4.2 kernels. Compiled with -msse4.2 (see LSL_SIMD_DISPATCH in CMakeLists.txt): must only be
+// called after checking cpu::level().
+// The kernels have internal linkage, the kernel header of an ISA is only used by the TU of that
+// ISA, and the helper shared with the scalar encoders is always inlined (rle::rle_stdz_end): no
+// code compiled with the flags of a TU can be picked by the linker for another one.
+#include <cstdint>
+#include <immintrin.h>
+
+#include <lsl3dlib/dispatch.hpp>
+#include <lsl3dlib/rle/rle-sse.hpp>
+
+namespace dispatch {
+
+namespace {
+
+namespace isa = rle::sse;
+
+template <typename RLE, uint8_t FG>
+int16_t rle_line(const uint8_t* restrict image_row, int16_t* restrict RLCi,
+		 int16_t* restrict ERi, int16_t width) {
+    return RLE::template Line<FG>(image_row, RLCi, ERi, width);
+}
+
+// Segments shorter than a vector are written with scalar stores: nothing is written outside of
+// [segment_start, segment_end), which allows to write rows without margin.
+inline void fill_4x32(int32_t* restrict line, int32_t label,
+		      int segment_start, int segment_end) {
+    if (segment_end - segment_start < 4) {
+	for (int i = segment_start; i < segment_end; i++) {
+	    line[i] = label;
+	}
+	return;
+    }
+    __m128i val = _mm_set1_epi32(label);
+    for (int i = segment_start; i + 4 <= segment_end; i += 4) {
+	_mm_storeu_si128((__m128i*)(line + i), val);
+    }
+    _mm_storeu_si128((__m128i*)(line + segment_end - 4), val); // Overlaps the previous store
+}
+
+void write_segment_sse4_2(int32_t* restrict line, int32_t label,
+			  int segment_start, int segment_end) {
+    fill_4x32(line, label, segment_start, segment_end);
+}
+
+void write_row_sse4_2(int32_t* restrict line, const int16_t* restrict RLCi,
+		      const int32_t* restrict labels, int16_t len, int16_t width) {
+    int16_t segment_end = 0;
+    for (int er = 1; er < len; er += 2) {
+	int16_t segment_start = RLCi[er - 1];
+	fill_4x32(line, 0, segment_end, segment_start);
+	segment_end = RLCi[er];
+	fill_4x32(line, labels[er / 2], segment_start, segment_end);
+    }
+    fill_4x32(line, 0, segment_end, width);
+}
+
+}
+
+void fill_kernels_sse4_2(Kernels& k) {
+    // sse::STDZ_ER relies on the 1 MB LUT8x16: only built when the SSE4.2 kernels are selected
+    static int lut_init = isa::lut_init_8x16();
+    (void)lut_init;
+
+    k.level = cpu::SIMDLevel::SSE4_2;
+    // sse::STDZ handles both FG = 1 and FG = 0xff
+    k.stdz[0] = &rle_line<isa::STDZ_Unpadded, 1>;
+    k.stdz[1] = &rle_line<isa::STDZ_Unpadded, 0xff>;
+    k.stdz_er[0] = &rle_line<isa::STDZ_ER_Unpadded, 1>;
+    k.stdz_er[1] = &rle_line<isa::STDZ_ER_Unpadded, 0xff>;
+    k.write_segment = &write_segment_sse4_2;
+    k.write_row = &write_row_sse4_2;
+}
+
+}
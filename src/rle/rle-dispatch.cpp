@@ -0,0 +1,77 @@
+#include <lsl3dlib/dispatch.hpp>
+#include <lsl3dlib/rle/rle.hpp>
+
+// Scalar kernels and runtime selection.
+// This TU is compiled with the baseline flags of the library: it must not include any of the
+// SIMD headers.
+
+namespace dispatch {
+
+namespace {
+
+template <typename RLE, uint8_t FG>
+int16_t rle_line(const uint8_t* restrict image_row, int16_t* restrict RLCi,
+		 int16_t* restrict ERi, int16_t width) {
+    return RLE::template Line<FG>(image_row, RLCi, ERi, width);
+}
+
+void write_segment_scalar(int32_t* restrict line, int32_t label,
+			  int segment_start, int segment_end) {
+    for (int i = segment_start; i < segment_end; i++) {
+	line[i] = label;
+    }
+}
+
+void write_row_scalar(int32_t* restrict line, const int16_t* restrict RLCi,
+		      const int32_t* restrict labels, int16_t len, int16_t width) {
+    int16_t segment_end = 0;
+    for (int er = 1; er < len; er += 2) {
+	int16_t segment_start = RLCi[er - 1];
+	write_segment_scalar(line, 0, segment_end, segment_start);
+	segment_end = RLCi[er];
+	write_segment_scalar(line, labels[er / 2], segment_start, segment_end);
+    }
+    write_segment_scalar(line, 0, segment_end, width);
+}
+
+}
+
+// Constant-initialized: valid before the dynamic initialization below
+Kernels kernels = {
+    cpu::SIMDLevel::Scalar,
+    {&rle_line<rle::STDZ, 1>, &rle_line<rle::STDZ, 0xff>},
+    {&rle_line<rle::STDZ_ER, 1>, &rle_line<rle::STDZ_ER, 0xff>},
+    &write_segment_scalar,
+    &write_row_scalar,
+};
+
+void fill_kernels_scalar(Kernels& k) {
+    k.level = cpu::SIMDLevel::Scalar;
+    k.stdz[0] = &rle_line<rle::STDZ, 1>;
+    k.stdz[1] = &rle_line<rle::STDZ, 0xff>;
+    k.stdz_er[0] = &rle_line<rle::STDZ_ER, 1>;
+    k.stdz_er[1] = &rle_line<rle::STDZ_ER, 0xff>;
+    k.write_segment = &write_segment_scalar;
+    k.write_row = &write_row_scalar;
+}
+
+void select(cpu::SIMDLevel level) {
+    Kernels k;
+    fill_kernels_scalar(k);
+    // Only the kernels of the selected level are filled (each level has all of them): the state
+    // of the other levels, e.g. the LUT8x16 of the SSE4.2 kernels, is never initialized
+#ifdef __x86_64__
+    if (level >= cpu::SIMDLevel::AVX512) {
+	fill_kernels_avx512(k);
+    } else if (level >= cpu::SIMDLevel::AVX2) {
+	fill_kernels_avx2(k);
+    } else if (level >= cpu::SIMDLevel::SSE4_2) {
+	fill_kernels_sse4_2(k);
+    }
+#endif // __x86_64__
+    kernels = k;
+}
+
+static int resolved = (select(cpu::level()), 0);
+
+}
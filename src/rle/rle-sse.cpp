@@ -265,18 +265,18 @@ unsigned char LUT16x8[256 * 16] __attribute__ ((aligned (16))) = {
 	0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0x9, 0xa, 0xb, 0xc, 0xd, 0xe, 0xf,
 };
 
-#ifdef __SSE4_2__
-
 namespace sse {
 
+// Always defined (1 MB of bss, untouched until initialized): with LSL_SIMD_DISPATCH, the SSE4.2
+// kernels are compiled in their own TU and the table is only filled if they are selected.
 unsigned char LUT8x16[256 * 256 * 16] __attribute__((aligned(16)));
 
+#if defined(__SSE4_2__) && !LSL_SIMD_DISPATCH
 int init = lut_init_8x16();
+#endif // __SSE4_2__ && !LSL_SIMD_DISPATCH
 
 }
 
-#endif // __SSE4_2__
-
 
 
 }